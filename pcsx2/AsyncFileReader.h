@@ -76,6 +76,13 @@ class FlatFileReader : public AsyncFileReader
 #elif defined(__linux__)
 	int m_fd; // FIXME don't know if overlap as an equivalent on linux
 	io_context_t m_aio_context;
+	// io_uring when the kernel has it, libaio above otherwise
+	class IoUringReader* m_uring;
+	bool m_uring_pending;
+	// The pending uring read, redone with pread if the ring fails it
+	void* m_uring_dst;
+	u64 m_uring_offset;
+	u32 m_uring_size;
 #elif defined(__POSIX__)
 	int m_fd; // TODO OSX don't know if overlap as an equivalent on OSX
 	struct aiocb m_aiocb;
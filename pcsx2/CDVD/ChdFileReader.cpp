@@ -18,6 +18,7 @@
 
 #include "CDVD/CompressedFileReaderUtils.h"
 
+#include <chrono>
 #include <wx/dir.h>
 
 
@@ -119,36 +120,194 @@ bool ChdFileReader::Open(const wxString& fileName)
 	}
 
 	// const chd_header *header = chd_get_header(ChdFile);
+	hunk_bytes = header->hunkbytes;
 	sector_size = header->unitbytes;
 	sector_count = header->unitcount;
-	sectors_per_hunk = header->hunkbytes / sector_size;
-	hunk_buffer = new u8[header->hunkbytes];
-	current_hunk = -1;
+	sectors_per_hunk = hunk_bytes / sector_size;
+	main_decoder.chd = ChdFile;
+	main_decoder.buffer = new u8[hunk_bytes];
+	main_decoder.hunk = -1;
 
 	delete header;
+
+	m_chain.assign(chds, chds + chd_depth + 1);
+	m_cache.SetChunkSize(hunk_bytes);
+	m_lastHunk = -1;
+	m_lastStride = 0;
+	StartWorkers();
+	return true;
+}
+
+// Opens another handle on the file, parents first like Open() does.
+chd_file* ChdFileReader::OpenChain()
+{
+	chd_file* child = NULL;
+
+	for (int d = (int)m_chain.size() - 1; d >= 0; d--)
+	{
+		chd_file* parent = child;
+		child = NULL;
+		chd_error error = chd_open(static_cast<const char*>(m_chain[d]), CHD_OPEN_READ, parent, &child);
+		if (error != CHDERR_NONE)
+		{
+			Console.Error(L"chd_open return error: %s", chd_error_string(error));
+			if (parent != NULL)
+				chd_close(parent);
+			return NULL;
+		}
+	}
+
+	return child;
+}
+
+void ChdFileReader::StartWorkers()
+{
+	m_workerExit = false;
+
+	for (uint i = 0; i < CHD_DECODE_THREADS; i++)
+	{
+		HunkDecoder& decoder = m_workerDecoders[i];
+		decoder.chd = OpenChain();
+		if (decoder.chd == NULL)
+		{
+			Console.Warning(L"CHD: unable to start hunk decode thread %u.", i);
+			continue;
+		}
+		decoder.buffer = new u8[hunk_bytes];
+		decoder.hunk = -1;
+
+		m_workers[i] = std::thread(&ChdFileReader::WorkerThread, this, &decoder);
+		m_workerCount++;
+	}
+}
+
+void ChdFileReader::StopWorkers()
+{
+	{
+		std::lock_guard<std::mutex> lock(m_workerLock);
+		m_workerExit = true;
+		m_prefetchQueue.clear();
+	}
+	m_workerWake.notify_all();
+
+	for (uint i = 0; i < CHD_DECODE_THREADS; i++)
+	{
+		if (m_workers[i].joinable())
+			m_workers[i].join();
+
+		HunkDecoder& decoder = m_workerDecoders[i];
+		if (decoder.buffer != NULL)
+		{
+			delete[] decoder.buffer;
+			decoder.buffer = NULL;
+		}
+		if (decoder.chd != NULL)
+		{
+			chd_close(decoder.chd);
+			decoder.chd = NULL;
+		}
+	}
+	m_workerCount = 0;
+
+	// A read that was never picked up can't complete anymore.
+	m_requestPending = false;
+	m_requestTaken = false;
+	m_prefetchPending.clear();
+}
+
+void ChdFileReader::WorkerThread(HunkDecoder* decoder)
+{
+	std::unique_lock<std::mutex> lock(m_workerLock);
+
+	while (true)
+	{
+		m_workerWake.wait(lock, [&] {
+			return m_workerExit || (m_requestPending && !m_requestTaken) || !m_prefetchQueue.empty();
+		});
+
+		if (m_workerExit)
+			break;
+
+		// The pending read always goes before the prefetching.
+		if (m_requestPending && !m_requestTaken)
+		{
+			m_requestTaken = true;
+			u8* dst = m_requestBuffer;
+			const uint sector = m_requestSector;
+			const uint count = m_requestCount;
+
+			lock.unlock();
+			const int res = ReadSectors(*decoder, dst, sector, count);
+			lock.lock();
+
+			async_read = res;
+			m_requestPending = false;
+			m_requestTaken = false;
+			m_requestDone.notify_all();
+			continue;
+		}
+
+		const u32 hunk = m_prefetchQueue.front();
+		m_prefetchQueue.pop_front();
+
+		lock.unlock();
+		if (!m_cache.Contains((u64)hunk * hunk_bytes))
+			DecodeHunk(*decoder, hunk, true);
+		lock.lock();
+
+		m_prefetchPending.erase(hunk);
+	}
+}
+
+// Decodes a hunk into the decoder buffer, and shares it through the hunk cache.
+bool ChdFileReader::DecodeHunk(HunkDecoder& decoder, u32 hunk, bool prefetch)
+{
+	if (decoder.hunk == hunk)
+		return true;
+
+	const auto start = std::chrono::steady_clock::now();
+	chd_error error = chd_read(decoder.chd, hunk, decoder.buffer);
+	const u64 us = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count();
+
+	if (error != CHDERR_NONE)
+	{
+		Console.Error(L"chd_read return error: %s", chd_error_string(error));
+		decoder.hunk = -1;
+		return false;
+	}
+	decoder.hunk = hunk;
+
+	m_hunksDecoded++;
+	if (prefetch)
+		m_hunksPrefetched++;
+	m_decodeTimeUs += us;
+	u64 max = m_maxDecodeTimeUs;
+	while (us > max && !m_maxDecodeTimeUs.compare_exchange_weak(max, us))
+		;
+
+	m_cache.Insert(decoder.buffer, (u64)hunk * hunk_bytes, hunk_bytes, hunk_bytes);
 	return true;
 }
 
 int ChdFileReader::ReadSync(void* pBuffer, uint sector, uint count)
 {
-	u8* dst = (u8*)pBuffer;
+	return ReadSectors(main_decoder, (u8*)pBuffer, sector, count);
+}
+
+int ChdFileReader::ReadSectors(HunkDecoder& decoder, u8* dst, uint sector, uint count)
+{
 	u32 hunk = sector / sectors_per_hunk;
 	u32 sector_in_hunk = sector % sectors_per_hunk;
-	chd_error error;
 
 	for (uint i = 0; i < count; i++)
 	{
-		if (current_hunk != hunk)
+		// The hunk the decoder just did, else a cached one, else decode it.
+		const u64 pos = (u64)hunk * hunk_bytes + sector_in_hunk * sector_size;
+		if (decoder.hunk == hunk || m_cache.Read(dst + i * m_blocksize, pos, m_blocksize) < 0)
 		{
-			error = chd_read(ChdFile, hunk, hunk_buffer);
-			if (error != CHDERR_NONE)
-			{
-				Console.Error(L"chd_read return error: %s", chd_error_string(error));
-				// return i * m_blocksize;
-			}
-			current_hunk = hunk;
+			DecodeHunk(decoder, hunk, false);
+			memcpy(dst + i * m_blocksize, decoder.buffer + sector_in_hunk * sector_size, m_blocksize);
 		}
-		memcpy(dst + i * m_blocksize, hunk_buffer + sector_in_hunk * sector_size, m_blocksize);
 		sector_in_hunk++;
 		if (sector_in_hunk >= sectors_per_hunk)
 		{
@@ -159,25 +318,160 @@ int ChdFileReader::ReadSync(void* pBuffer, uint sector, uint count)
 	return m_blocksize * count;
 }
 
+// Succeeds only if every sector of the request is in the hunk cache.
+bool ChdFileReader::ReadFromCache(u8* dst, uint sector, uint count)
+{
+	u32 hunk = sector / sectors_per_hunk;
+	u32 sector_in_hunk = sector % sectors_per_hunk;
+
+	for (uint i = 0; i < count; i++)
+	{
+		const u64 pos = (u64)hunk * hunk_bytes + sector_in_hunk * sector_size;
+		if (m_cache.Read(dst + i * m_blocksize, pos, m_blocksize) < 0)
+			return false;
+
+		sector_in_hunk++;
+		if (sector_in_hunk >= sectors_per_hunk)
+		{
+			hunk++;
+			sector_in_hunk = 0;
+		}
+	}
+	return true;
+}
+
+// Follows the hunks touched by the reads. Once the same stride (sequential or a
+// short skip, like interleaved streams) is seen twice in a row, the next hunks
+// along that stride get decoded ahead.
+void ChdFileReader::PredictHunks(uint sector, uint count)
+{
+	const u32 hunk = (sector + count - 1) / sectors_per_hunk;
+	if (hunk == m_lastHunk)
+		return;
+
+	const s64 stride = (s64)hunk - (s64)m_lastHunk;
+	const bool predictable = m_lastHunk != (u32)-1 && stride == m_lastStride && stride > 0 && stride <= CHD_MAX_STRIDE;
+	m_lastStride = m_lastHunk != (u32)-1 ? stride : 0;
+	m_lastHunk = hunk;
+
+	if (!predictable)
+	{
+		DropPrefetch();
+		return;
+	}
+
+	const u32 hunk_count = (sector_count + sectors_per_hunk - 1) / sectors_per_hunk;
+	bool queued = false;
+	{
+		std::lock_guard<std::mutex> lock(m_workerLock);
+		for (uint i = 1; i <= CHD_READAHEAD_HUNKS; i++)
+		{
+			const u64 next = hunk + stride * i;
+			if (next >= hunk_count)
+				break;
+			if (m_prefetchPending.count((u32)next) || m_cache.Contains(next * hunk_bytes))
+				continue;
+
+			m_prefetchPending.insert((u32)next);
+			m_prefetchQueue.push_back((u32)next);
+			queued = true;
+		}
+	}
+
+	if (queued)
+		m_workerWake.notify_all();
+}
+
+// The reader went elsewhere, forget about the hunks nobody started on yet.
+void ChdFileReader::DropPrefetch()
+{
+	std::lock_guard<std::mutex> lock(m_workerLock);
+	for (u32 hunk : m_prefetchQueue)
+		m_prefetchPending.erase(hunk);
+	m_prefetchQueue.clear();
+}
+
 void ChdFileReader::BeginRead(void* pBuffer, uint sector, uint count)
 {
-	// TODO: Check if libchdr can read asynchronously
-	async_read = ReadSync(pBuffer, sector, count);
+	// Only one read in flight, the previous one should have been finished already.
+	CancelRead();
+
+	// Prefetched hunks complete right away, anything else goes to a worker
+	// and FinishRead() picks up the result.
+	if (ReadFromCache((u8*)pBuffer, sector, count))
+	{
+		async_read = m_blocksize * count;
+	}
+	else if (!m_workerCount)
+	{
+		async_read = ReadSync(pBuffer, sector, count);
+	}
+	else
+	{
+		{
+			std::lock_guard<std::mutex> lock(m_workerLock);
+			m_requestBuffer = (u8*)pBuffer;
+			m_requestSector = sector;
+			m_requestCount = count;
+			m_requestTaken = false;
+			m_requestPending = true;
+		}
+		m_workerWake.notify_all();
+	}
+
+	PredictHunks(sector, count);
 }
 
 int ChdFileReader::FinishRead()
 {
+	std::unique_lock<std::mutex> lock(m_workerLock);
+	m_requestDone.wait(lock, [&] { return !m_requestPending; });
 	return async_read;
 }
 
+void ChdFileReader::CancelRead()
+{
+	// A hunk can't be abandoned half decoded, let the worker finish with the buffer.
+	std::unique_lock<std::mutex> lock(m_workerLock);
+	m_requestDone.wait(lock, [&] { return !m_requestPending; });
+}
+
+ChdFileReader::Stats ChdFileReader::GetStats()
+{
+	ChunksCache::Stats cache = m_cache.GetStats();
+
+	Stats stats;
+	stats.hunksDecoded = m_hunksDecoded;
+	stats.hunksPrefetched = m_hunksPrefetched;
+	stats.decodeTimeUs = m_decodeTimeUs;
+	stats.maxDecodeTimeUs = m_maxDecodeTimeUs;
+	stats.cacheHits = cache.hits;
+	stats.cacheMisses = cache.misses;
+	return stats;
+}
+
 void ChdFileReader::Close()
 {
-	if (hunk_buffer != NULL)
+	StopWorkers();
+
+	Stats stats = GetStats();
+	if (stats.hunksDecoded)
+	{
+		DevCon.WriteLn(Color_Gray, L"CHD: %llu hunks decoded (%llu prefetched), %.3f ms avg, %.3f ms max per hunk, cache hits: %llu, misses: %llu",
+					   (unsigned long long)stats.hunksDecoded, (unsigned long long)stats.hunksPrefetched,
+					   (double)stats.decodeTimeUs / stats.hunksDecoded / 1000, (double)stats.maxDecodeTimeUs / 1000,
+					   (unsigned long long)stats.cacheHits, (unsigned long long)stats.cacheMisses);
+	}
+	m_hunksDecoded = m_hunksPrefetched = m_decodeTimeUs = m_maxDecodeTimeUs = 0;
+	m_cache.Clear();
+	m_cache.ResetStats();
+
+	if (main_decoder.buffer != NULL)
 	{
-		//free(hunk_buffer);
-		delete[] hunk_buffer;
-		hunk_buffer = NULL;
+		delete[] main_decoder.buffer;
+		main_decoder.buffer = NULL;
 	}
+	main_decoder.chd = NULL;
 	if (ChdFile != NULL)
 	{
 		chd_close(ChdFile);
@@ -200,7 +494,20 @@ u32 ChdFileReader::GetBlockCount() const
 	return sector_count;
 }
 ChdFileReader::ChdFileReader(void)
+	: m_cache(CHD_HUNKCACHE_SIZE_MB)
+	, m_workerCount(0)
+	, m_workerExit(false)
+	, m_requestPending(false)
+	, m_requestTaken(false)
+	, m_hunksDecoded(0)
+	, m_hunksPrefetched(0)
+	, m_decodeTimeUs(0)
+	, m_maxDecodeTimeUs(0)
 {
 	ChdFile = NULL;
-	hunk_buffer = NULL;
+	m_lastHunk = -1;
+	m_lastStride = 0;
+	main_decoder = {};
+	for (HunkDecoder& decoder : m_workerDecoders)
+		decoder = {};
 };
@@ -14,14 +14,39 @@
  */
 
 #pragma once
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <unordered_set>
 #include "AsyncFileReader.h"
+#include "ChunksCache.h"
 #include "libchdr/chd.h"
 
+static const uint CHD_HUNKCACHE_SIZE_MB = 64;
+// Threads decoding hunks ahead of the reader (they also serve the async reads).
+static const uint CHD_DECODE_THREADS = 2;
+// How many hunks to decode ahead once the access pattern is predictable.
+static const uint CHD_READAHEAD_HUNKS = 8;
+// Largest hunk stride still considered a stream (e.g. interleaved files).
+static const uint CHD_MAX_STRIDE = 4;
+
 class ChdFileReader : public AsyncFileReader
 {
 	DeclareNoncopyableObject(ChdFileReader);
 
 public:
+	struct Stats
+	{
+		u64 hunksDecoded;
+		u64 hunksPrefetched;
+		u64 decodeTimeUs;
+		u64 maxDecodeTimeUs;
+		u64 cacheHits;
+		u64 cacheMisses;
+	};
+
 	virtual ~ChdFileReader(void) { Close(); };
 
 	static bool CanHandle(const wxString& fileName);
@@ -31,7 +56,7 @@ public:
 
 	void BeginRead(void* pBuffer, uint sector, uint count) override;
 	int FinishRead(void) override;
-	void CancelRead(void) override{};
+	void CancelRead(void) override;
 
 	void Close(void) override;
 	void SetBlockSize(uint blocksize);
@@ -39,12 +64,65 @@ public:
 	uint GetBlockCount(void) const override;
 	ChdFileReader(void);
 
+	Stats GetStats();
+
 private:
+	// A chd_file can only decode one hunk at a time, so each worker opens its own.
+	struct HunkDecoder
+	{
+		chd_file* chd;
+		u8* buffer;
+		u32 hunk;
+	};
+
+	chd_file* OpenChain();
+	bool DecodeHunk(HunkDecoder& decoder, u32 hunk, bool prefetch);
+	int ReadSectors(HunkDecoder& decoder, u8* dst, uint sector, uint count);
+	bool ReadFromCache(u8* dst, uint sector, uint count);
+	void PredictHunks(uint sector, uint count);
+
+	void StartWorkers();
+	void StopWorkers();
+	void WorkerThread(HunkDecoder* decoder);
+	void DropPrefetch();
+
 	chd_file* ChdFile;
-	u8* hunk_buffer;
+	// Used by ReadSync(), on the caller's thread.
+	HunkDecoder main_decoder;
+	u32 hunk_bytes;
 	u32 sector_size;
 	u32 sector_count;
 	u32 sectors_per_hunk;
-	u32 current_hunk;
 	u32 async_read;
+
+	// The file and its parents, child first, to open more handles on it.
+	std::vector<wxString> m_chain;
+	ChunksCache m_cache;
+
+	// Hunk stream prediction.
+	u32 m_lastHunk;
+	s64 m_lastStride;
+
+	std::thread m_workers[CHD_DECODE_THREADS];
+	HunkDecoder m_workerDecoders[CHD_DECODE_THREADS];
+	uint m_workerCount;
+	std::mutex m_workerLock;
+	std::condition_variable m_workerWake;
+	std::condition_variable m_requestDone;
+	bool m_workerExit;
+	// Hunks queued for prefetch, and queued or being decoded.
+	std::deque<u32> m_prefetchQueue;
+	std::unordered_set<u32> m_prefetchPending;
+
+	// The read between BeginRead() and FinishRead(), when a worker has to do it.
+	bool m_requestPending;
+	bool m_requestTaken;
+	u8* m_requestBuffer;
+	uint m_requestSector;
+	uint m_requestCount;
+
+	std::atomic<u64> m_hunksDecoded;
+	std::atomic<u64> m_hunksPrefetched;
+	std::atomic<u64> m_decodeTimeUs;
+	std::atomic<u64> m_maxDecodeTimeUs;
 };
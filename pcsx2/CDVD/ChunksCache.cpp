@@ -16,43 +16,320 @@
 #include "PrecompiledHeader.h"
 #include "ChunksCache.h"
 
+ChunksCache::ChunksCache(uint initialLimitMb, uint chunkSize)
+	: m_chunkSize(chunkSize)
+	, m_limit((PX_off_t)initialLimitMb * 1024 * 1024)
+{
+	for (Shard& shard : m_shards)
+	{
+		shard.head = shard.tail = shard.free = nullptr;
+		shard.count = shard.allocated = shard.limit = 0;
+		shard.hits = shard.misses = shard.evictions = 0;
+	}
+	UpdateLimits();
+}
+
+ChunksCache::~ChunksCache()
+{
+	Clear();
+}
+
+void ChunksCache::UpdateLimits()
+{
+	uint perShard = 0;
+	if (m_chunkSize)
+		perShard = std::max<uint>(1, (uint)(m_limit / m_chunkSize / SHARDS));
+
+	for (Shard& shard : m_shards)
+	{
+		std::lock_guard<std::mutex> lock(shard.lock);
+		shard.limit = perShard;
+		while (shard.count > shard.limit)
+			Evict(shard);
+		ReleaseSlabs(shard);
+	}
+}
+
+// Frees the slabs a lowered limit no longer needs. A slab goes when the others can
+// hold all the cached chunks; if that isn't enough, the chunks move to a new slab
+// sized for them and all the old ones go.
+void ChunksCache::ReleaseSlabs(Shard& shard)
+{
+	for (int pass = 0; pass < 2 && shard.allocated > shard.limit; pass++)
+	{
+		if (pass == 1 && (!shard.count || !AddSlab(shard, shard.count)))
+			break;
+
+		// The new slab is the last one, it's never released
+		for (size_t i = shard.slabs.size() - pass; i-- > 0 && shard.allocated > shard.limit;)
+		{
+			if (shard.allocated - shard.slabs[i].entries >= shard.count)
+				ReleaseSlab(shard, i);
+		}
+	}
+}
+
+// The chunks still cached in the slab are moved to free entries of the other ones,
+// in place in the LRU.
+void ChunksCache::ReleaseSlab(Shard& shard, size_t index)
+{
+	const Slab slab = shard.slabs[index];
+	CacheEntry* first = (CacheEntry*)slab.mem;
+	CacheEntry* last = first + slab.entries;
+
+	// Take the slab's entries off the free list
+	CacheEntry** link = &shard.free;
+	while (*link)
+	{
+		if (*link >= first && *link < last)
+			*link = (*link)->next;
+		else
+			link = &(*link)->next;
+	}
+
+	for (CacheEntry* e = first; e < last; e++)
+	{
+		// Evicted (or never used) entries aren't in the map, or the offset maps elsewhere
+		auto it = shard.map.find(e->offset);
+		if (it == shard.map.end() || it->second != e)
+			continue;
+
+		CacheEntry* f = shard.free;
+		shard.free = f->next;
+
+		f->offset = e->offset;
+		f->size = e->size;
+		f->coverage = e->coverage;
+		memcpy(f->data, e->data, e->size);
+
+		f->prev = e->prev;
+		f->next = e->next;
+		if (f->prev)
+			f->prev->next = f;
+		else
+			shard.head = f;
+		if (f->next)
+			f->next->prev = f;
+		else
+			shard.tail = f;
+
+		it->second = f;
+	}
+
+	free(slab.mem);
+	shard.slabs.erase(shard.slabs.begin() + index);
+	shard.allocated -= slab.entries;
+}
+
 void ChunksCache::SetLimit(uint megabytes)
 {
 	m_limit = (PX_off_t)megabytes * 1024 * 1024;
-	MatchLimit();
+	UpdateLimits();
 }
 
-void ChunksCache::MatchLimit(bool removeAll)
+void ChunksCache::SetChunkSize(uint bytes)
 {
-	std::list<CacheEntry*>::reverse_iterator rit;
-	while (!m_entries.empty() && (removeAll || m_size > m_limit))
+	if (bytes == m_chunkSize)
+		return;
+
+	// The slabs are sized for the old chunks, so they have to go too.
+	Clear();
+	m_chunkSize = bytes;
+	UpdateLimits();
+}
+
+void ChunksCache::ClearShard(Shard& shard)
+{
+	for (const Slab& slab : shard.slabs)
+		free(slab.mem);
+	shard.slabs.clear();
+	shard.map.clear();
+	shard.head = shard.tail = shard.free = nullptr;
+	shard.count = shard.allocated = 0;
+}
+
+void ChunksCache::Clear()
+{
+	for (Shard& shard : m_shards)
 	{
-		rit = m_entries.rbegin();
-		m_size -= (*rit)->size;
-		delete (*rit);
-		m_entries.pop_back();
+		std::lock_guard<std::mutex> lock(shard.lock);
+		ClearShard(shard);
 	}
 }
 
-void ChunksCache::Take(void* pMallocedSrc, PX_off_t offset, int length, int coverage)
+void ChunksCache::Unlink(Shard& shard, CacheEntry* e)
+{
+	if (e->prev)
+		e->prev->next = e->next;
+	else
+		shard.head = e->next;
+
+	if (e->next)
+		e->next->prev = e->prev;
+	else
+		shard.tail = e->prev;
+
+	e->prev = e->next = nullptr;
+}
+
+void ChunksCache::PushFront(Shard& shard, CacheEntry* e)
 {
-	m_entries.push_front(new CacheEntry(pMallocedSrc, offset, length, coverage));
-	m_size += length;
-	MatchLimit();
+	e->prev = nullptr;
+	e->next = shard.head;
+	if (shard.head)
+		shard.head->prev = e;
+	else
+		shard.tail = e;
+	shard.head = e;
+}
+
+void ChunksCache::Evict(Shard& shard)
+{
+	CacheEntry* e = shard.tail;
+	if (!e)
+		return;
+
+	Unlink(shard, e);
+	shard.map.erase(e->offset);
+	shard.count--;
+	shard.evictions++;
+
+	e->next = shard.free;
+	shard.free = e;
+}
+
+// Entries are carved out of slabs of SLAB_ENTRIES chunks: the entry headers first,
+// then the chunk data. Slabs are only released by Clear() or a lower limit, evicted
+// entries go to the shard free list and get reused for the next chunk.
+bool ChunksCache::AddSlab(Shard& shard, uint entries)
+{
+	size_t headers = (entries * sizeof(CacheEntry) + 63) & ~(size_t)63;
+	u8* slab = (u8*)malloc(headers + (size_t)entries * m_chunkSize);
+	if (!slab)
+		return false;
+
+	shard.slabs.push_back({slab, entries});
+	shard.allocated += entries;
+
+	CacheEntry* e = (CacheEntry*)slab;
+	for (uint i = 0; i < entries; i++)
+	{
+		e[i].offset = -1; // not cached, see ReleaseSlab
+		e[i].data = slab + headers + (size_t)i * m_chunkSize;
+		e[i].next = shard.free;
+		shard.free = &e[i];
+	}
+	return true;
+}
+
+ChunksCache::CacheEntry* ChunksCache::Allocate(Shard& shard)
+{
+	if (!shard.free && shard.allocated < shard.limit)
+	{
+		uint n = shard.limit - shard.allocated;
+		if (n > SLAB_ENTRIES)
+			n = SLAB_ENTRIES;
+		AddSlab(shard, n);
+	}
+
+	if (!shard.free)
+		Evict(shard);
+
+	CacheEntry* e = shard.free;
+	if (e)
+		shard.free = e->next;
+	return e;
+}
+
+void ChunksCache::Insert(const void* pSrc, PX_off_t offset, int length, int coverage)
+{
+	if (!m_chunkSize || offset % m_chunkSize || length < 0 || length > (int)m_chunkSize || coverage > (int)m_chunkSize)
+		return;
+
+	Shard& shard = GetShard(offset);
+	std::lock_guard<std::mutex> lock(shard.lock);
+
+	CacheEntry* e;
+	auto it = shard.map.find(offset);
+	if (it != shard.map.end())
+	{
+		// Already there (e.g. both prefetched and read), just refresh it.
+		e = it->second;
+		Unlink(shard, e);
+	}
+	else
+	{
+		e = Allocate(shard);
+		if (!e)
+			return;
+
+		e->offset = offset;
+		shard.map[offset] = e;
+		shard.count++;
+	}
+
+	memcpy(e->data, pSrc, length);
+	e->size = length;
+	e->coverage = coverage;
+	PushFront(shard, e);
 }
 
-// By design, succeed only if the entire request is in a single cached chunk
 int ChunksCache::Read(void* pDest, PX_off_t offset, int length)
 {
-	for (auto it = m_entries.begin(); it != m_entries.end(); it++)
+	if (!m_chunkSize)
+		return -1;
+
+	PX_off_t key = offset - offset % m_chunkSize;
+	Shard& shard = GetShard(key);
+	std::lock_guard<std::mutex> lock(shard.lock);
+
+	auto it = shard.map.find(key);
+	if (it == shard.map.end() || (offset + length) > (key + it->second->coverage))
 	{
-		CacheEntry* e = *it;
-		if (e && offset >= e->offset && (offset + length) <= (e->offset + e->coverage))
-		{
-			if (it != m_entries.begin())
-				m_entries.splice(m_entries.begin(), m_entries, it); // Move to top (MRU)
-			return CopyAvailable(e->data, e->offset, e->size, pDest, offset, length);
-		}
+		shard.misses++;
+		return -1;
+	}
+
+	CacheEntry* e = it->second;
+	if (e != shard.head)
+	{
+		Unlink(shard, e); // Move to top (MRU)
+		PushFront(shard, e);
+	}
+	shard.hits++;
+	return CopyAvailable(e->data, e->offset, e->size, pDest, offset, length);
+}
+
+bool ChunksCache::Contains(PX_off_t offset)
+{
+	if (!m_chunkSize)
+		return false;
+
+	PX_off_t key = offset - offset % m_chunkSize;
+	Shard& shard = GetShard(key);
+	std::lock_guard<std::mutex> lock(shard.lock);
+	return shard.map.find(key) != shard.map.end();
+}
+
+ChunksCache::Stats ChunksCache::GetStats()
+{
+	Stats stats = {};
+	for (Shard& shard : m_shards)
+	{
+		std::lock_guard<std::mutex> lock(shard.lock);
+		stats.hits += shard.hits;
+		stats.misses += shard.misses;
+		stats.evictions += shard.evictions;
+		stats.chunks += shard.count;
+	}
+	return stats;
+}
+
+void ChunksCache::ResetStats()
+{
+	for (Shard& shard : m_shards)
+	{
+		std::lock_guard<std::mutex> lock(shard.lock);
+		shard.hits = shard.misses = shard.evictions = 0;
 	}
-	return -1;
 }
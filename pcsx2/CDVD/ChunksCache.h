@@ -15,23 +15,52 @@
 
 #pragma once
 
+#include <mutex>
+#include <unordered_map>
+#include <vector>
 #include "zlib_indexed.h"
 
 #define CLAMP(val, minval, maxval) (std::min(maxval, std::max(minval, val)))
 
+// Cache of decompressed data, usable by any of the compressed file readers.
+//
+// The file is split into fixed size chunks aligned on the chunk size, so a lookup is
+// a single hash probe on the chunk offset instead of a scan of every cached chunk.
+// Chunks are spread over a few shards by offset, each one with its own lock, LRU list
+// and slab allocated chunk storage, so a prefetch thread can fill the cache while the
+// reader is looking it up.
 class ChunksCache
 {
 public:
-	ChunksCache(uint initialLimitMb)
-		: m_entries(0)
-		, m_size(0)
-		, m_limit(initialLimitMb * 1024 * 1024){};
-	~ChunksCache() { Clear(); };
+	struct Stats
+	{
+		u64 hits;
+		u64 misses;
+		u64 evictions;
+		uint chunks;
+	};
+
+	ChunksCache(uint initialLimitMb, uint chunkSize = 0);
+	~ChunksCache();
+
 	void SetLimit(uint megabytes);
-	void Clear() { MatchLimit(true); };
+	// Drops all the cached chunks if the size changes.
+	void SetChunkSize(uint bytes);
+	uint GetChunkSize() const { return m_chunkSize; }
+	// Drops all the cached chunks and releases their memory. Stats are kept.
+	void Clear();
 
-	void Take(void* pMallocedSrc, PX_off_t offset, int length, int coverage);
+	// offset must be on a chunk boundary. length is the amount of data at pSrc and
+	// coverage the range of the file this chunk accounts for, both up to the chunk
+	// size (coverage is larger than length when the chunk hits EOF).
+	void Insert(const void* pSrc, PX_off_t offset, int length, int coverage);
+	// By design, succeed only if the entire request is in a single cached chunk
 	int Read(void* pDest, PX_off_t offset, int length);
+	// Doesn't count as a hit or a miss, nor refreshes the chunk.
+	bool Contains(PX_off_t offset);
+
+	Stats GetStats();
+	void ResetStats();
 
 	static int CopyAvailable(void* pSrc, PX_off_t srcOffset, int srcSize,
 							 void* pDst, PX_off_t dstOffset, int maxCopySize)
@@ -42,30 +71,54 @@ public:
 	};
 
 private:
-	class CacheEntry
+	static const uint SHARDS = 8;
+	static const uint SLAB_ENTRIES = 16;
+
+	struct CacheEntry
 	{
-	public:
-		CacheEntry(void* pMallocedSrc, PX_off_t offset, int length, int coverage)
-			: data(pMallocedSrc)
-			, offset(offset)
-			, coverage(coverage)
-			, size(length){};
-
-		~CacheEntry()
-		{
-			if (data)
-				free(data);
-		};
-
-		void* data;
 		PX_off_t offset;
-		int coverage;
 		int size;
+		int coverage;
+		CacheEntry* prev;
+		CacheEntry* next;
+		u8* data;
 	};
 
-	std::list<CacheEntry*> m_entries;
-	void MatchLimit(bool removeAll = false);
-	PX_off_t m_size;
+	struct Slab
+	{
+		u8* mem;      // entry headers, then the chunk data
+		uint entries;
+	};
+
+	struct Shard
+	{
+		std::mutex lock;
+		std::unordered_map<PX_off_t, CacheEntry*> map;
+		CacheEntry* head; // MRU
+		CacheEntry* tail; // LRU
+		CacheEntry* free;
+		std::vector<Slab> slabs;
+		uint count;
+		uint allocated;
+		uint limit;
+		u64 hits;
+		u64 misses;
+		u64 evictions;
+	};
+
+	Shard& GetShard(PX_off_t offset) { return m_shards[(offset / m_chunkSize) % SHARDS]; }
+	void Unlink(Shard& shard, CacheEntry* e);
+	void PushFront(Shard& shard, CacheEntry* e);
+	CacheEntry* Allocate(Shard& shard);
+	bool AddSlab(Shard& shard, uint entries);
+	void Evict(Shard& shard);
+	void ClearShard(Shard& shard);
+	void ReleaseSlabs(Shard& shard);
+	void ReleaseSlab(Shard& shard, size_t index);
+	void UpdateLimits();
+
+	Shard m_shards[SHARDS];
+	uint m_chunkSize;
 	PX_off_t m_limit;
 };
 
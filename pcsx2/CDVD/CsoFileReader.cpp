@@ -94,6 +94,7 @@ bool CsoFileReader::Open(const wxString& fileName)
 	bool success = false;
 	if (m_src && ReadFileHeader() && InitializeBuffers())
 	{
+		StartWorkers();
 		success = true;
 	}
 
@@ -134,82 +135,247 @@ bool CsoFileReader::ReadFileHeader()
 	m_indexShift = hdr.align;
 	m_totalSize = hdr.total_bytes;
 
+	// Frames are the unit of the cache, each one is decompressed as a whole.
+	m_cache.SetChunkSize(m_frameSize);
+
 	return true;
 }
 
 bool CsoFileReader::InitializeBuffers()
 {
 	// Round up, since part of a frame requires a full frame.
-	u32 numFrames = (u32)((m_totalSize + m_frameSize - 1) / m_frameSize);
+	m_numFrames = (u32)((m_totalSize + m_frameSize - 1) / m_frameSize);
+
+	const u32 indexSize = m_numFrames + 1;
+	m_index = new u32[indexSize];
+	if (fread(m_index, sizeof(u32), indexSize, m_src) != indexSize)
+	{
+		Console.Error(L"Unable to read index data from CSO.");
+		return false;
+	}
+
+	m_decoder.src = m_src;
+	return InitializeDecoder(m_decoder);
+}
 
+bool CsoFileReader::InitializeDecoder(FrameDecoder& decoder)
+{
 	// We might read a bit of alignment too, so be prepared.
 	if (m_frameSize + (1 << m_indexShift) < CSO_READ_BUFFER_SIZE)
 	{
-		m_readBuffer = new u8[CSO_READ_BUFFER_SIZE];
+		decoder.readBuffer = new u8[CSO_READ_BUFFER_SIZE];
 	}
 	else
 	{
-		m_readBuffer = new u8[m_frameSize + (1 << m_indexShift)];
+		decoder.readBuffer = new u8[m_frameSize + (1 << m_indexShift)];
 	}
 
 	// This is a buffer for the most recently decompressed frame.
-	m_zlibBuffer = new u8[m_frameSize + (1 << m_indexShift)];
-	m_zlibBufferFrame = numFrames;
-
-	const u32 indexSize = numFrames + 1;
-	m_index = new u32[indexSize];
-	if (fread(m_index, sizeof(u32), indexSize, m_src) != indexSize)
+	decoder.zlibBuffer = new u8[m_frameSize + (1 << m_indexShift)];
+	decoder.zlibBufferFrame = m_numFrames;
+
+	decoder.stream = new z_stream;
+	decoder.stream->zalloc = Z_NULL;
+	decoder.stream->zfree = Z_NULL;
+	decoder.stream->opaque = Z_NULL;
+	if (inflateInit2(decoder.stream, -15) != Z_OK)
 	{
-		Console.Error(L"Unable to read index data from CSO.");
+		Console.Error("Unable to initialize zlib for CSO decompression.");
+		delete decoder.stream;
+		decoder.stream = NULL;
 		return false;
 	}
 
-	m_z_stream = new z_stream;
-	m_z_stream->zalloc = Z_NULL;
-	m_z_stream->zfree = Z_NULL;
-	m_z_stream->opaque = Z_NULL;
-	if (inflateInit2(m_z_stream, -15) != Z_OK)
+	return true;
+}
+
+void CsoFileReader::ReleaseDecoder(FrameDecoder& decoder)
+{
+	if (decoder.stream)
 	{
-		Console.Error("Unable to initialize zlib for CSO decompression.");
-		return false;
+		inflateEnd(decoder.stream);
+		delete decoder.stream;
+		decoder.stream = NULL;
 	}
 
-	return true;
+	if (decoder.readBuffer)
+	{
+		delete[] decoder.readBuffer;
+		decoder.readBuffer = NULL;
+	}
+	if (decoder.zlibBuffer)
+	{
+		delete[] decoder.zlibBuffer;
+		decoder.zlibBuffer = NULL;
+	}
 }
 
 void CsoFileReader::Close()
 {
+	StopWorkers();
+
 	m_filename.Empty();
-#if CSO_USE_CHUNKSCACHE
 	m_cache.Clear();
-#endif
+	m_nextSector = (uint)-1;
+	m_sequentialReads = 0;
+
+	ReleaseDecoder(m_decoder);
+	m_decoder.src = NULL;
 
 	if (m_src)
 	{
 		fclose(m_src);
 		m_src = NULL;
 	}
-	if (m_z_stream)
+
+	if (m_index)
 	{
-		inflateEnd(m_z_stream);
-		m_z_stream = NULL;
+		delete[] m_index;
+		m_index = NULL;
 	}
+}
 
-	if (m_readBuffer)
+void CsoFileReader::StartWorkers()
+{
+	m_workerExit = false;
+
+	for (uint i = 0; i < CSO_PREFETCH_THREADS; i++)
 	{
-		delete[] m_readBuffer;
-		m_readBuffer = NULL;
+		FrameDecoder& decoder = m_workerDecoders[i];
+		decoder = {};
+
+		// Each worker seeks on its own, so it needs its own handle.
+		decoder.src = PX_fopen_rb(m_filename);
+		if (!decoder.src || !InitializeDecoder(decoder))
+		{
+			Console.Warning(L"CSO: unable to start read-ahead thread %u.", i);
+			ReleaseDecoder(decoder);
+			if (decoder.src)
+				fclose(decoder.src);
+			decoder.src = NULL;
+			continue;
+		}
+
+		m_workers[i] = std::thread(&CsoFileReader::WorkerThread, this, &decoder);
+		m_workerCount++;
 	}
-	if (m_zlibBuffer)
+}
+
+void CsoFileReader::StopWorkers()
+{
 	{
-		delete[] m_zlibBuffer;
-		m_zlibBuffer = NULL;
+		std::lock_guard<std::mutex> lock(m_workerLock);
+		m_workerExit = true;
+		m_prefetchQueue.clear();
 	}
-	if (m_index)
+	m_workerWake.notify_all();
+
+	for (uint i = 0; i < CSO_PREFETCH_THREADS; i++)
 	{
-		delete[] m_index;
-		m_index = NULL;
+		if (m_workers[i].joinable())
+			m_workers[i].join();
+
+		FrameDecoder& decoder = m_workerDecoders[i];
+		ReleaseDecoder(decoder);
+		if (decoder.src)
+		{
+			fclose(decoder.src);
+			decoder.src = NULL;
+		}
 	}
+
+	m_workerCount = 0;
+
+	// A read that was never picked up can't complete anymore.
+	m_requestPending = false;
+	m_requestTaken = false;
+	m_prefetchPending.clear();
+}
+
+void CsoFileReader::WorkerThread(FrameDecoder* decoder)
+{
+	std::unique_lock<std::mutex> lock(m_workerLock);
+
+	while (true)
+	{
+		m_workerWake.wait(lock, [&] {
+			return m_workerExit || (m_requestPending && !m_requestTaken) || !m_prefetchQueue.empty();
+		});
+
+		if (m_workerExit)
+			break;
+
+		// The pending read always goes before the read-ahead.
+		if (m_requestPending && !m_requestTaken)
+		{
+			m_requestTaken = true;
+			u8* dest = m_requestBuffer;
+			const u64 pos = m_requestPos;
+			const int bytes = m_requestBytes;
+
+			lock.unlock();
+			const int res = ReadFrames(*decoder, dest, pos, bytes);
+			lock.lock();
+
+			m_bytesRead = res;
+			m_requestPending = false;
+			m_requestTaken = false;
+			m_requestDone.notify_all();
+			continue;
+		}
+
+		const u32 frame = m_prefetchQueue.front();
+		m_prefetchQueue.pop_front();
+
+		lock.unlock();
+		const u64 framePos = (u64)frame << m_frameShift;
+		if (!m_cache.Contains(framePos) && DecompressFrame(*decoder, frame))
+		{
+			const int frameBytes = GetFrameBytes(frame);
+			m_cache.Insert(decoder->zlibBuffer, framePos, frameBytes, frameBytes);
+		}
+		lock.lock();
+
+		m_prefetchPending.erase(frame);
+	}
+}
+
+// Queue the frames following a sequential read, skipping those already cached or on their way.
+void CsoFileReader::Prefetch(u64 pos)
+{
+	const u32 first = (u32)(pos >> m_frameShift);
+	const u32 count = std::max<u32>(1, CSO_READAHEAD_SIZE >> m_frameShift);
+	bool queued = false;
+
+	{
+		std::lock_guard<std::mutex> lock(m_workerLock);
+		for (u32 frame = first; frame < m_numFrames && frame - first < count; frame++)
+		{
+			if (m_prefetchPending.count(frame) || m_cache.Contains((u64)frame << m_frameShift))
+				continue;
+
+			m_prefetchPending.insert(frame);
+			m_prefetchQueue.push_back(frame);
+			queued = true;
+		}
+	}
+
+	if (queued)
+		m_workerWake.notify_all();
+}
+
+// The reader went elsewhere, forget about the frames nobody started on yet.
+void CsoFileReader::DropPrefetch()
+{
+	std::lock_guard<std::mutex> lock(m_workerLock);
+	for (u32 frame : m_prefetchQueue)
+		m_prefetchPending.erase(frame);
+	m_prefetchQueue.clear();
+}
+
+int CsoFileReader::GetFrameBytes(u32 frame) const
+{
+	return (int)std::min<u64>(m_frameSize, m_totalSize - ((u64)frame << m_frameShift));
 }
 
 int CsoFileReader::ReadSync(void* pBuffer, uint sector, uint count)
@@ -222,37 +388,35 @@ int CsoFileReader::ReadSync(void* pBuffer, uint sector, uint count)
 	// Note that, in practice, count will always be 1.  It seems one sector is read
 	// per interrupt, even if multiple are requested by the application.
 
-	u8* dest = (u8*)pBuffer;
 	// We do it this way in case m_blocksize is not well aligned to our frame size.
-	u64 pos = (u64)sector * (u64)m_blocksize;
-	int remaining = count * m_blocksize;
+	return ReadFrames(m_decoder, (u8*)pBuffer, (u64)sector * (u64)m_blocksize, count * m_blocksize);
+}
+
+int CsoFileReader::ReadFrames(FrameDecoder& decoder, u8* dest, u64 pos, int remaining)
+{
 	int bytes = 0;
 
 	while (remaining > 0)
 	{
-		int readBytes;
-
-#if CSO_USE_CHUNKSCACHE
-		// Try first to read from the cache.
-		readBytes = m_cache.Read(dest + bytes, pos + bytes, remaining);
-#else
-		readBytes = -1;
-#endif
+		// Try first to read from the cache, one frame at a time.
+		const int inFrame = (int)(m_frameSize - ((pos + bytes) & (m_frameSize - 1)));
+		int readBytes = m_cache.Read(dest + bytes, pos + bytes, std::min(remaining, inFrame));
 		if (readBytes < 0)
 		{
-			readBytes = ReadFromFrame(dest + bytes, pos + bytes, remaining);
+			readBytes = ReadFromFrame(decoder, dest + bytes, pos + bytes, remaining);
 			if (readBytes == 0)
 			{
 				// We hit EOF.
 				break;
 			}
 
-#if CSO_USE_CHUNKSCACHE
-			// Add the bytes into the cache.  We need to allocate a buffer for it.
-			void* cached = malloc(readBytes);
-			memcpy(cached, dest + bytes, readBytes);
-			m_cache.Take(cached, pos + bytes, readBytes, readBytes);
-#endif
+			// Add the whole frame into the cache, it was just decompressed.
+			const u32 frame = (u32)((pos + bytes) >> m_frameShift);
+			if (decoder.zlibBufferFrame == frame)
+			{
+				const int frameBytes = GetFrameBytes(frame);
+				m_cache.Insert(decoder.zlibBuffer, (u64)frame << m_frameShift, frameBytes, frameBytes);
+			}
 		}
 
 		bytes += readBytes;
@@ -262,7 +426,30 @@ int CsoFileReader::ReadSync(void* pBuffer, uint sector, uint count)
 	return bytes;
 }
 
-int CsoFileReader::ReadFromFrame(u8* dest, u64 pos, int maxBytes)
+// Returns -1 unless the whole request (up to EOF) is cached.
+int CsoFileReader::ReadFromCache(u8* dest, u64 pos, int remaining)
+{
+	if (pos >= m_totalSize)
+		return 0;
+
+	remaining = (int)std::min<u64>(remaining, m_totalSize - pos);
+	int bytes = 0;
+
+	while (remaining > 0)
+	{
+		const int inFrame = (int)(m_frameSize - ((pos + bytes) & (m_frameSize - 1)));
+		const int readBytes = m_cache.Read(dest + bytes, pos + bytes, std::min(remaining, inFrame));
+		if (readBytes <= 0)
+			return -1;
+
+		bytes += readBytes;
+		remaining -= readBytes;
+	}
+
+	return bytes;
+}
+
+int CsoFileReader::ReadFromFrame(FrameDecoder& decoder, u8* dest, u64 pos, int maxBytes)
 {
 	if (pos >= m_totalSize)
 	{
@@ -271,10 +458,30 @@ int CsoFileReader::ReadFromFrame(u8* dest, u64 pos, int maxBytes)
 	}
 
 	const u32 frame = (u32)(pos >> m_frameShift);
-	const u32 offset = (u32)(pos - (frame << m_frameShift));
+	const u32 offset = (u32)(pos - ((u64)frame << m_frameShift));
 	// This is how many bytes we will actually be reading from this frame.
 	const u32 bytes = (u32)(std::min(m_blocksize, static_cast<uint>(m_frameSize - offset)));
 
+	// We don't need to decompress if we already did this same frame last time.
+	if (decoder.zlibBufferFrame != frame && !DecompressFrame(decoder, frame))
+	{
+		return 0;
+	}
+
+	// Now we just copy the offset data from the frame buffer.
+	const u32 available = (u32)std::min<u64>(bytes, m_totalSize - pos);
+	memcpy(dest, decoder.zlibBuffer + offset, available);
+	return available;
+}
+
+// Loads a whole frame into decoder.zlibBuffer, stored or compressed.
+bool CsoFileReader::DecompressFrame(FrameDecoder& decoder, u32 frame)
+{
+	if (decoder.zlibBufferFrame == frame)
+	{
+		return true;
+	}
+
 	// Grab the index data for the frame we're about to read.
 	const bool compressed = (m_index[frame + 0] & 0x80000000) == 0;
 	const u32 index0 = m_index[frame + 0] & 0x7FFFFFFF;
@@ -284,74 +491,109 @@ int CsoFileReader::ReadFromFrame(u8* dest, u64 pos, int maxBytes)
 	const u64 frameRawPos = (u64)index0 << m_indexShift;
 	const u64 frameRawSize = (u64)(index1 - index0) << m_indexShift;
 
-	if (!compressed)
+	if (PX_fseeko(decoder.src, m_dataoffset + frameRawPos, SEEK_SET) != 0)
 	{
-		// Just read directly, easy.
-		if (PX_fseeko(m_src, m_dataoffset + frameRawPos + offset, SEEK_SET) != 0)
-		{
-			Console.Error("Unable to seek to uncompressed CSO data.");
-			return 0;
-		}
-		return fread(dest, 1, bytes, m_src);
+		Console.Error("Unable to seek to CSO data.");
+		decoder.zlibBufferFrame = (u32)-1;
+		return false;
 	}
-	else
+
+	if (!compressed)
 	{
-		// We don't need to decompress if we already did this same frame last time.
-		if (m_zlibBufferFrame != frame)
+		// Just read directly, easy.
+		const u32 frameBytes = GetFrameBytes(frame);
+		if (fread(decoder.zlibBuffer, 1, frameBytes, decoder.src) != frameBytes)
 		{
-			if (PX_fseeko(m_src, m_dataoffset + frameRawPos, SEEK_SET) != 0)
-			{
-				Console.Error("Unable to seek to compressed CSO data.");
-				return 0;
-			}
-			// This might be less bytes than frameRawSize in case of padding on the last frame.
-			// This is because the index positions must be aligned.
-			const u32 readRawBytes = fread(m_readBuffer, 1, frameRawSize, m_src);
-			if (!DecompressFrame(frame, readRawBytes))
-			{
-				return 0;
-			}
+			Console.Error("Unable to read uncompressed CSO data.");
+			decoder.zlibBufferFrame = (u32)-1;
+			return false;
 		}
-
-		// Now we just copy the offset data from the cache.
-		memcpy(dest, m_zlibBuffer + offset, bytes);
+		decoder.zlibBufferFrame = frame;
+		return true;
 	}
 
-	return bytes;
-}
+	// This might be less bytes than frameRawSize in case of padding on the last frame.
+	// This is because the index positions must be aligned.
+	const u32 readRawBytes = fread(decoder.readBuffer, 1, frameRawSize, decoder.src);
 
-bool CsoFileReader::DecompressFrame(u32 frame, u32 readBufferSize)
-{
-	m_z_stream->next_in = m_readBuffer;
-	m_z_stream->avail_in = readBufferSize;
-	m_z_stream->next_out = m_zlibBuffer;
-	m_z_stream->avail_out = m_frameSize;
+	z_stream* stream = decoder.stream;
+	stream->next_in = decoder.readBuffer;
+	stream->avail_in = readRawBytes;
+	stream->next_out = decoder.zlibBuffer;
+	stream->avail_out = m_frameSize;
 
-	int status = inflate(m_z_stream, Z_FINISH);
-	bool success = status == Z_STREAM_END && m_z_stream->total_out == m_frameSize;
+	int status = inflate(stream, Z_FINISH);
+	bool success = status == Z_STREAM_END && stream->total_out == m_frameSize;
 	if (success)
 	{
 		// Our buffer now contains this frame.
-		m_zlibBufferFrame = frame;
+		decoder.zlibBufferFrame = frame;
 	}
 	else
 	{
 		Console.Error("Unable to decompress CSO frame using zlib.");
-		m_zlibBufferFrame = (u32)-1;
+		decoder.zlibBufferFrame = (u32)-1;
 	}
 
-	inflateReset(m_z_stream);
+	inflateReset(stream);
 	return success;
 }
 
 void CsoFileReader::BeginRead(void* pBuffer, uint sector, uint count)
 {
-	// TODO: No async support yet, implement as sync.
-	m_bytesRead = ReadSync(pBuffer, sector, count);
+	if (!m_src)
+	{
+		m_bytesRead = 0;
+		return;
+	}
+
+	// Only one read in flight, the previous one should have been finished already.
+	CancelRead();
+
+	const u64 pos = (u64)sector * (u64)m_blocksize;
+	const int bytes = count * m_blocksize;
+
+	if (sector == m_nextSector)
+	{
+		if (m_sequentialReads < CSO_SEQUENTIAL_THRESHOLD)
+			m_sequentialReads++;
+	}
+	else
+	{
+		m_sequentialReads = 0;
+		DropPrefetch();
+	}
+	m_nextSector = sector + count;
+
+	// Prefetched frames complete right away, anything else goes to a worker
+	// and FinishRead() picks up the result.
+	const int cached = ReadFromCache((u8*)pBuffer, pos, bytes);
+	if (cached >= 0 || !m_workerCount)
+	{
+		m_bytesRead = cached >= 0 ? cached : ReadSync(pBuffer, sector, count);
+	}
+	else
+	{
+		{
+			std::lock_guard<std::mutex> lock(m_workerLock);
+			m_requestBuffer = (u8*)pBuffer;
+			m_requestPos = pos;
+			m_requestBytes = bytes;
+			m_requestTaken = false;
+			m_requestPending = true;
+		}
+		m_workerWake.notify_all();
+	}
+
+	if (m_sequentialReads >= CSO_SEQUENTIAL_THRESHOLD)
+		Prefetch(pos + bytes);
 }
 
 int CsoFileReader::FinishRead()
 {
+	std::unique_lock<std::mutex> lock(m_workerLock);
+	m_requestDone.wait(lock, [&] { return !m_requestPending; });
+
 	int res = m_bytesRead;
 	m_bytesRead = -1;
 	return res;
@@ -359,5 +601,8 @@ int CsoFileReader::FinishRead()
 
 void CsoFileReader::CancelRead()
 {
-	// TODO: No async read support yet.
+	// A frame can't be abandoned half inflated, let the worker finish with the buffer.
+	std::unique_lock<std::mutex> lock(m_workerLock);
+	m_requestDone.wait(lock, [&] { return !m_requestPending; });
+	m_bytesRead = -1;
 }
@@ -15,15 +15,11 @@
 
 #pragma once
 
-// Based on testing, the overhead of using this cache is high.
-//
-// The test was done with CSO files using a block size of 16KB.
-// Cache hit rates were observed in the range of 25%.
-// Cache overhead added 35% to the overall read time.
-//
-// For this reason, it's currently disabled.
-#define CSO_USE_CHUNKSCACHE 0
-
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <unordered_set>
 #include "AsyncFileReader.h"
 #include "ChunksCache.h"
 
@@ -31,6 +27,12 @@ struct CsoHeader;
 typedef struct z_stream_s z_stream;
 
 static const uint CSO_CHUNKCACHE_SIZE_MB = 200;
+// Threads inflating frames ahead of the reader (they also serve the async reads).
+static const uint CSO_PREFETCH_THREADS = 2;
+// Back to back reads needed before the access is considered sequential.
+static const uint CSO_SEQUENTIAL_THRESHOLD = 2;
+// How far ahead of a sequential read the frames get prefetched.
+static const uint CSO_READAHEAD_SIZE = 512 * 1024;
 
 class CsoFileReader : public AsyncFileReader
 {
@@ -41,21 +43,26 @@ public:
 		: m_frameSize(0)
 		, m_frameShift(0)
 		, m_indexShift(0)
-		, m_readBuffer(0)
-		, m_zlibBuffer(0)
-		, m_zlibBufferFrame(0)
+		, m_numFrames(0)
 		, m_index(0)
 		, m_totalSize(0)
 		, m_src(0)
-		, m_z_stream(0)
-		,
-#if CSO_USE_CHUNKSCACHE
-		m_cache(CSO_CHUNKCACHE_SIZE_MB)
-		,
-#endif
-		m_bytesRead(0)
+		, m_cache(CSO_CHUNKCACHE_SIZE_MB)
+		, m_nextSector((uint)-1)
+		, m_sequentialReads(0)
+		, m_workerCount(0)
+		, m_workerExit(false)
+		, m_requestPending(false)
+		, m_requestTaken(false)
+		, m_requestBuffer(0)
+		, m_requestPos(0)
+		, m_requestBytes(0)
+		, m_bytesRead(0)
 	{
 		m_blocksize = 2048;
+		m_decoder = {};
+		for (FrameDecoder& decoder : m_workerDecoders)
+			decoder = {};
 	};
 
 	virtual ~CsoFileReader(void) { Close(); };
@@ -80,27 +87,69 @@ public:
 	virtual void SetDataOffset(int bytes) { m_dataoffset = bytes; }
 
 private:
+	// Everything needed to get a frame out of the file. The reading thread and each
+	// worker own one, so they never share a file position or a z_stream.
+	struct FrameDecoder
+	{
+		FILE* src;
+		z_stream* stream;
+		u8* readBuffer;
+		u8* zlibBuffer;
+		u32 zlibBufferFrame;
+	};
+
 	static bool ValidateHeader(const CsoHeader& hdr);
 	bool ReadFileHeader();
 	bool InitializeBuffers();
-	int ReadFromFrame(u8* dest, u64 pos, int maxBytes);
-	bool DecompressFrame(u32 frame, u32 readBufferSize);
+	bool InitializeDecoder(FrameDecoder& decoder);
+	void ReleaseDecoder(FrameDecoder& decoder);
+	int ReadFrames(FrameDecoder& decoder, u8* dest, u64 pos, int bytes);
+	int ReadFromCache(u8* dest, u64 pos, int bytes);
+	int ReadFromFrame(FrameDecoder& decoder, u8* dest, u64 pos, int maxBytes);
+	bool DecompressFrame(FrameDecoder& decoder, u32 frame);
+	int GetFrameBytes(u32 frame) const;
+
+	void StartWorkers();
+	void StopWorkers();
+	void WorkerThread(FrameDecoder* decoder);
+	void Prefetch(u64 pos);
+	void DropPrefetch();
 
 	u32 m_frameSize;
 	u8 m_frameShift;
 	u8 m_indexShift;
-	u8* m_readBuffer;
-	u8* m_zlibBuffer;
-	u32 m_zlibBufferFrame;
+	u32 m_numFrames;
 	u32* m_index;
 	u64 m_totalSize;
 	// The actual source cso file handle.
 	FILE* m_src;
-	z_stream* m_z_stream;
+	// Used by ReadSync(), on the caller's thread.
+	FrameDecoder m_decoder;
 
-#if CSO_USE_CHUNKSCACHE
+	// Whole decompressed frames, filled by whoever decodes them.
 	ChunksCache m_cache;
-#endif
+
+	// Sequential access detection.
+	uint m_nextSector;
+	uint m_sequentialReads;
+
+	std::thread m_workers[CSO_PREFETCH_THREADS];
+	FrameDecoder m_workerDecoders[CSO_PREFETCH_THREADS];
+	std::mutex m_workerLock;
+	std::condition_variable m_workerWake;
+	std::condition_variable m_requestDone;
+	uint m_workerCount;
+	bool m_workerExit;
+	// Frames queued for prefetch, and queued or being decoded.
+	std::deque<u32> m_prefetchQueue;
+	std::unordered_set<u32> m_prefetchPending;
+
+	// The read between BeginRead() and FinishRead(), when a worker has to do it.
+	bool m_requestPending;
+	bool m_requestTaken;
+	u8* m_requestBuffer;
+	u64 m_requestPos;
+	int m_requestBytes;
 
 	// The result of a read is stored here between BeginRead() and FinishRead().
 	int m_bytesRead;
@@ -16,6 +16,12 @@
 #include "PrecompiledHeader.h"
 #include <fstream>
 #include <wx/stdpaths.h>
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
 #include "AppConfig.h"
 #include "ChunksCache.h"
 #include "CompressedFileReaderUtils.h"
@@ -37,79 +43,280 @@ static s64 fsize(const wxString& filename)
 	return size;
 }
 
-#define GZIP_ID "PCSX2.index.gzip.v1|"
+// Read-only view of a whole file, so that a complete index costs nothing to load
+// and only the access points which are actually used get paged in.
+class GzIndexMapping
+{
+public:
+	GzIndexMapping()
+		: m_data(NULL)
+		, m_size(0)
+#ifdef _WIN32
+		, m_file(INVALID_HANDLE_VALUE)
+		, m_mapping(NULL)
+#endif
+	{
+	}
+
+	~GzIndexMapping() { Unmap(); }
+
+	bool Map(const wxString& filename)
+	{
+#ifdef _WIN32
+		m_file = CreateFile(filename.wc_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+		if (m_file == INVALID_HANDLE_VALUE)
+			return false;
+
+		LARGE_INTEGER size;
+		if (!GetFileSizeEx(m_file, &size) || size.QuadPart == 0)
+		{
+			Unmap();
+			return false;
+		}
+		m_size = size.QuadPart;
+
+		m_mapping = CreateFileMapping(m_file, NULL, PAGE_READONLY, 0, 0, NULL);
+		if (m_mapping)
+			m_data = (const u8*)MapViewOfFile(m_mapping, FILE_MAP_READ, 0, 0, 0);
+#else
+		int fd = open(filename.ToUTF8(), O_RDONLY);
+		if (fd == -1)
+			return false;
+
+		struct stat st;
+		if (fstat(fd, &st) == 0 && st.st_size > 0)
+		{
+			m_size = st.st_size;
+			void* data = mmap(NULL, m_size, PROT_READ, MAP_PRIVATE, fd, 0);
+			if (data != MAP_FAILED)
+				m_data = (const u8*)data;
+		}
+		close(fd);
+#endif
+		if (!m_data)
+		{
+			Unmap();
+			return false;
+		}
+		return true;
+	}
+
+	void Unmap()
+	{
+#ifdef _WIN32
+		if (m_data)
+			UnmapViewOfFile(m_data);
+		if (m_mapping)
+			CloseHandle(m_mapping);
+		if (m_file != INVALID_HANDLE_VALUE)
+			CloseHandle(m_file);
+		m_mapping = NULL;
+		m_file = INVALID_HANDLE_VALUE;
+#else
+		if (m_data)
+			munmap((void*)m_data, m_size);
+#endif
+		m_data = NULL;
+		m_size = 0;
+	}
+
+	const u8* GetData() const { return m_data; }
+	s64 GetSize() const { return m_size; }
+
+private:
+	const u8* m_data;
+	s64 m_size;
+#ifdef _WIN32
+	HANDLE m_file;
+	HANDLE m_mapping;
+#endif
+};
+
+#define GZIP_ID "PCSX2.index.gzip.v2|"
 #define GZIP_ID_LEN (sizeof(GZIP_ID) - 1) /* sizeof includes the \0 terminator */
+#define GZIP_INDEX_COMPLETE 1             /* the whole file was scanned */
 
 // File format is:
-// - [GZIP_ID_LEN] GZIP_ID (no \0)
-// - [sizeof(Access)] index (should be allocated, contains various sizes)
-// - [rest] the indexed data points (should be allocated, index->list should then point to it)
-static Access* ReadIndexFromFile(const wxString& filename)
+// - [sizeof(GzIndexHeader)] header, starting with GZIP_ID (no \0)
+// - [rest] header.have access points, as in memory
+// An index is only valid for the gzip file with the same size and modification time.
+// A partial index (the scan didn't finish) is resumed from its last access point.
+struct GzIndexHeader
+{
+	char id[GZIP_ID_LEN];
+	u32 flags;
+	s32 span;
+	s32 have;
+	s64 gzSize;
+	s64 gzMtime;
+	s64 uncompressedSize; // only meaningful with GZIP_INDEX_COMPLETE
+	u32 checksum;         // crc32 of the access points
+	u32 reserved;
+};
+
+static u32 IndexChecksum(const Point* list, int have)
 {
-	s64 size = fsize(filename);
-	if (size <= 0)
+	uLong crc = crc32(0L, Z_NULL, 0);
+	const Bytef* data = (const Bytef*)list;
+	size_t size = sizeof(Point) * have;
+	while (size)
+	{
+		uInt len = (uInt)std::min<size_t>(size, 1024 * 1024 * 1024);
+		crc = crc32(crc, data, len);
+		data += len;
+		size -= len;
+	}
+	return (u32)crc;
+}
+
+// Returns the index if it's valid for this gzip file. A complete index stays mapped
+// (list points into the mapping), a partial one is copied since it will grow.
+static Access* ReadIndexFromFile(const wxString& filename, s64 gzSize, s64 gzMtime,
+								 GzIndexMapping*& mapping, bool& complete)
+{
+	GzIndexMapping* map = new GzIndexMapping;
+	if (!map->Map(filename))
 	{
 		Console.Error(L"Error: Can't open index file: '%s'", WX_STR(filename));
+		delete map;
 		return 0;
 	}
-	std::ifstream infile(PX_wfilename(filename), std::ifstream::binary);
 
-	char fileId[GZIP_ID_LEN + 1] = {0};
-	infile.read(fileId, GZIP_ID_LEN);
-	if (wxString::From8BitData(GZIP_ID) != wxString::From8BitData(fileId))
+	const GzIndexHeader* hdr = (const GzIndexHeader*)map->GetData();
+	if (map->GetSize() < (s64)sizeof(GzIndexHeader) || memcmp(hdr->id, GZIP_ID, GZIP_ID_LEN))
 	{
-		Console.Error(L"Error: Incompatible gzip index, please delete it manually: '%s'", WX_STR(filename));
-		infile.close();
+		Console.Warning(L"Gzip index is from another version, it will be rebuilt: '%s'", WX_STR(filename));
+		delete map;
 		return 0;
 	}
 
-	Access* index = (Access*)malloc(sizeof(Access));
-	infile.read((char*)index, sizeof(Access));
+	if (hdr->gzSize != gzSize || hdr->gzMtime != gzMtime)
+	{
+		Console.Warning(L"Gzip index doesn't match the file anymore, it will be rebuilt: '%s'", WX_STR(filename));
+		delete map;
+		return 0;
+	}
 
-	s64 datasize = size - GZIP_ID_LEN - sizeof(Access);
-	if (datasize != (s64)index->have * sizeof(Point))
+	const Point* list = (const Point*)(map->GetData() + sizeof(GzIndexHeader));
+	if (hdr->have <= 0 || map->GetSize() != (s64)sizeof(GzIndexHeader) + (s64)hdr->have * sizeof(Point) ||
+		IndexChecksum(list, hdr->have) != hdr->checksum)
 	{
-		Console.Error(L"Error: unexpected size of gzip index, please delete it manually: '%s'.", WX_STR(filename));
-		infile.close();
-		free(index);
+		Console.Warning(L"Gzip index is corrupted, it will be rebuilt: '%s'", WX_STR(filename));
+		delete map;
 		return 0;
 	}
 
-	char* buffer = (char*)malloc(datasize);
-	infile.read(buffer, datasize);
-	infile.close();
-	index->list = (Point*)buffer; // adjust list pointer
-	return index;
-}
+	Access* index = (Access*)malloc(sizeof(Access));
+	index->have = index->size = hdr->have;
+	index->span = hdr->span;
+	index->uncompressed_size = hdr->uncompressedSize;
+	complete = (hdr->flags & GZIP_INDEX_COMPLETE) != 0;
 
-static void WriteIndexToFile(Access* index, const wxString filename)
-{
-	if (wxFileName::FileExists(filename))
+	if (complete)
 	{
-		Console.Warning(L"WARNING: Won't write index - file name exists (please delete it manually): '%s'", WX_STR(filename));
-		return;
+		index->list = (Point*)list;
+		mapping = map;
+		return index;
 	}
 
-	std::ofstream outfile(PX_wfilename(filename), std::ofstream::binary);
-	outfile.write(GZIP_ID, GZIP_ID_LEN);
-
-	Point* tmp = index->list;
-	index->list = 0; // current pointer is useless on disk, normalize it as 0.
-	outfile.write((char*)index, sizeof(Access));
-	index->list = tmp;
+	index->list = (Point*)malloc(sizeof(Point) * std::max(hdr->have, 1));
+	memcpy(index->list, list, sizeof(Point) * hdr->have);
+	delete map;
+	return index;
+}
 
+static void WriteIndexToFile(Access* index, const wxString filename, s64 gzSize, s64 gzMtime, bool complete)
+{
+	wxFileName(filename).Mkdir(0777, wxPATH_MKDIR_FULL);
+
+	GzIndexHeader hdr = {};
+	memcpy(hdr.id, GZIP_ID, GZIP_ID_LEN);
+	hdr.flags = complete ? GZIP_INDEX_COMPLETE : 0;
+	hdr.span = index->span;
+	hdr.have = index->have;
+	hdr.gzSize = gzSize;
+	hdr.gzMtime = gzMtime;
+	hdr.uncompressedSize = complete ? index->uncompressed_size : 0;
+	hdr.checksum = IndexChecksum(index->list, index->have);
+
+	// Written aside and renamed, so an index is never seen half written.
+	wxString tmpname = filename + L".tmp";
+	std::ofstream outfile(PX_wfilename(tmpname), std::ofstream::binary);
+	outfile.write((char*)&hdr, sizeof(hdr));
 	outfile.write((char*)index->list, sizeof(Point) * index->have);
 	outfile.close();
 
 	// Verify
-	if (fsize(filename) != (s64)GZIP_ID_LEN + sizeof(Access) + sizeof(Point) * index->have)
+	if (fsize(tmpname) != (s64)sizeof(hdr) + sizeof(Point) * index->have || !wxRenameFile(tmpname, filename, true))
 	{
 		Console.Warning(L"Warning: Can't write index file to disk: '%s'", WX_STR(filename));
+		wxRemoveFile(tmpname);
 	}
-	else
+	else if (complete)
 	{
 		Console.WriteLn(Color_Green, L"OK: Gzip quick access index file saved to disk: '%s'", WX_STR(filename));
 	}
+	else
+	{
+		Console.WriteLn(Color_Green, L"OK: Partial gzip index saved to disk, it will be resumed next time: '%s'", WX_STR(filename));
+	}
+}
+
+static u32 ReadLE32(const u8* p)
+{
+	return p[0] | (p[1] << 8) | (p[2] << 16) | ((u32)p[3] << 24);
+}
+
+// Until the index is complete, the size comes from the gzip trailer, which only has it
+// modulo 4 GB. The ISO9660 primary volume descriptor (sector 16) tells which 4 GB it is.
+static PX_off_t EstimateUncompressedSize(FILE* in, s64 gzSize)
+{
+	u8 trailer[4];
+	if (gzSize < 18 || PX_fseeko(in, gzSize - 4, SEEK_SET) != 0 || fread(trailer, 1, 4, in) != 4)
+		return 0;
+	const PX_off_t isize = ReadLE32(trailer);
+
+	// Enough for sector 16 with 2048 or 2352 bytes sectors.
+	std::vector<u8> head(17 * 2352);
+	z_stream strm = {};
+	uInt have = 0;
+	if (PX_fseeko(in, 0, SEEK_SET) == 0 && inflateInit2(&strm, 47) == Z_OK)
+	{
+		unsigned char input[16 * 1024];
+		strm.next_out = head.data();
+		strm.avail_out = (uInt)head.size();
+		int ret = Z_OK;
+		while (ret == Z_OK && strm.avail_out)
+		{
+			strm.avail_in = fread(input, 1, sizeof(input), in);
+			if (!strm.avail_in)
+				break;
+			strm.next_in = input;
+			ret = inflate(&strm, Z_NO_FLUSH);
+		}
+		have = (uInt)head.size() - strm.avail_out;
+		inflateEnd(&strm);
+	}
+
+	// { descriptor offset, bytes per sector in the file }
+	static const int layouts[][2] = {{16 * 2048, 2048}, {16 * 2352 + 24, 2352}, {16 * 2352 + 16, 2352}};
+	PX_off_t pvdSize = 0;
+	for (const auto& layout : layouts)
+	{
+		const u8* pvd = head.data() + layout[0];
+		if (have >= (uInt)layout[0] + 132 && pvd[0] == 1 && !memcmp(pvd + 1, "CD001", 5))
+		{
+			pvdSize = (PX_off_t)ReadLE32(pvd + 80) * layout[1];
+			break;
+		}
+	}
+
+	if (pvdSize <= isize)
+		return isize;
+
+	// The nearest size matching the trailer, the image may have some padding.
+	const PX_off_t range = (PX_off_t)1 << 32;
+	return isize + (pvdSize - isize + range / 2) / range * range;
 }
 
 static wxString INDEX_TEMPLATE_KEY(L"$(f)");
@@ -179,39 +386,78 @@ static void TestTemplate(const wxDirName &base, const wxString &fname, bool canE
 }
 */
 
+// Relative templates (the default one is "cache/$(f).pindex") end up in the
+// documents folder, with the rest of the user data.
 static wxString iso2indexname(const wxString& isoname)
 {
 	//testTemplate(isoname);
-	wxDirName appRoot = // TODO: have only one of this in PCSX2. Right now have few...
-		(wxDirName)(wxFileName(wxStandardPaths::Get().GetExecutablePath()).GetPath());
-	//TestTemplate(appRoot, isoname, false);
-	return ApplyTemplate(L"gzip index", appRoot, g_Conf->GzipIsoIndexTemplate, isoname, false);
+	//TestTemplate(PathDefs::GetDocuments(), isoname, false);
+	return ApplyTemplate(L"gzip index", PathDefs::GetDocuments(), g_Conf->GzipIsoIndexTemplate, isoname, false);
 }
 
 GzippedFileReader::GzippedFileReader(void)
 	: mBytesRead(0)
 	, m_pIndex(0)
+	, m_indexMapping(0)
 	, m_zstates(0)
+	, m_zstatesCount(0)
 	, m_src(0)
-	, m_cache(GZFILE_CACHE_SIZE_MB)
+	, m_cache(GZFILE_CACHE_SIZE_MB, GZFILE_READ_CHUNK_SIZE)
+	, m_gzSize(0)
+	, m_gzMtime(0)
+	, m_indexComplete(false)
+	, m_indexFailed(false)
+	, m_indexAbort(false)
+	, m_readBuffer(0)
+	, m_readSector(0)
+	, m_readCount(0)
+	, m_readPending(false)
+	, m_readExit(false)
 {
 	m_blocksize = 2048;
 	AsyncPrefetchReset();
 };
 
-void GzippedFileReader::InitZstates()
+void GzippedFileReader::InitZstates(PX_off_t minSize)
 {
 	if (m_zstates)
 	{
 		delete[] m_zstates;
 		m_zstates = 0;
+		m_zstatesCount = 0;
 	}
 	if (!m_pIndex)
 		return;
 
+	// The index thread replaces the estimated size once the scan is done
+	PX_off_t size;
+	{
+		std::lock_guard<std::mutex> lock(m_indexLock);
+		size = m_pIndex->uncompressed_size;
+	}
+
 	// having another extra element helps avoiding logic for last (so 2+ instead of 1+)
-	int size = 2 + m_pIndex->uncompressed_size / m_pIndex->span;
-	m_zstates = new Czstate[size]();
+	m_zstatesCount = 2 + std::max(size, minSize) / m_pIndex->span;
+	m_zstates = new Czstate[m_zstatesCount]();
+}
+
+void GzippedFileReader::ReleaseIndex()
+{
+	if (!m_pIndex)
+		return;
+
+	if (m_indexMapping)
+	{
+		// The list is in the mapping
+		free(m_pIndex);
+		delete m_indexMapping;
+		m_indexMapping = 0;
+	}
+	else
+	{
+		free_index((Access*)m_pIndex);
+	}
+	m_pIndex = 0;
 }
 
 #ifndef _WIN32
@@ -301,19 +547,28 @@ bool GzippedFileReader::CanHandle(const wxString& fileName)
 	return wxFileName::FileExists(fileName) && fileName.Lower().EndsWith(L".gz");
 }
 
+// Verifies that we have an index: a complete one from the disk, or a partial one
+// (possibly empty) which the background scan completes while the game runs.
 bool GzippedFileReader::OkIndex()
 {
 	if (m_pIndex)
 		return true;
 
 	// Try to read index from disk
-	wxString indexfile = iso2indexname(m_filename);
-	if (indexfile.length() == 0)
+	m_indexFile = iso2indexname(m_filename);
+	if (m_indexFile.length() == 0)
 		return false; // iso2indexname(...) will print errors if it can't apply the template
 
-	if (wxFileName::FileExists(indexfile) && (m_pIndex = ReadIndexFromFile(indexfile)))
+	m_gzSize = fsize(m_filename);
+	m_gzMtime = wxFileModificationTime(m_filename);
+
+	bool complete = false;
+	if (wxFileName::FileExists(m_indexFile))
+		m_pIndex = ReadIndexFromFile(m_indexFile, m_gzSize, m_gzMtime, m_indexMapping, complete);
+
+	if (m_pIndex && complete)
 	{
-		Console.WriteLn(Color_Green, L"OK: Gzip quick access index read from disk: '%s'", WX_STR(indexfile));
+		Console.WriteLn(Color_Green, L"OK: Gzip quick access index read from disk: '%s'", WX_STR(m_indexFile));
 		if (m_pIndex->span != GZFILE_SPAN_DEFAULT)
 		{
 			Console.Warning(L"Note: This index has %1.1f MB intervals, while the current default for new indexes is %1.1f MB.",
@@ -321,36 +576,138 @@ bool GzippedFileReader::OkIndex()
 			Console.Warning(L"It will work fine, but if you want to generate a new index with default intervals, delete this index file.");
 			Console.Warning(L"(smaller intervals mean bigger index file and quicker but more frequent decompressions)");
 		}
+		m_indexComplete = true;
 		InitZstates();
 		return true;
 	}
 
-	// No valid index file. Generate an index
-	Console.Warning(L"This may take a while (but only once). Scanning compressed file to generate a quick access index...");
-
-	Access* index;
-	FILE* infile = PX_fopen_rb(m_filename);
-	int len = build_index(infile, GZFILE_SPAN_DEFAULT, &index);
-	printf("\n"); // build_index prints progress without \n's
-	fclose(infile);
-
-	if (len >= 0)
+	if (m_pIndex)
 	{
-		m_pIndex = index;
-		WriteIndexToFile((Access*)m_pIndex, indexfile);
+		Console.WriteLn(Color_Green, L"Resuming the gzip quick access index from %d%%: '%s'",
+						(int)(m_pIndex->list[m_pIndex->have - 1].in * 100 / std::max<s64>(m_gzSize, 1)), WX_STR(m_indexFile));
 	}
 	else
 	{
-		Console.Error(L"ERROR (%d): index could not be generated for file '%s'", len, WX_STR(m_filename));
-		free_index(index);
-		InitZstates();
-		return false;
+		Console.WriteLn(Color_Green, L"Scanning the compressed file in the background to generate a quick access index...");
+		m_pIndex = (Access*)malloc(sizeof(Access));
+		m_pIndex->have = m_pIndex->size = 0;
+		m_pIndex->list = 0;
+		m_pIndex->span = GZFILE_SPAN_DEFAULT;
 	}
 
+	m_pIndex->uncompressed_size = EstimateUncompressedSize(m_src, m_gzSize);
+	m_indexComplete = false;
+	m_indexFailed = false;
+	m_indexAbort = false;
+	m_indexThread = std::thread(&GzippedFileReader::BuildIndexThread, this);
+
 	InitZstates();
 	return true;
 }
 
+void GzippedFileReader::BuildIndexThread()
+{
+	Access* built = 0;
+	int res = Z_ERRNO;
+
+	FILE* infile = PX_fopen_rb(m_filename);
+	if (infile)
+	{
+		// Only this thread adds points, no need to lock for reading them.
+		std::unique_ptr<Point> resume;
+		if (m_pIndex->have)
+		{
+			resume.reset(new Point);
+			*resume = m_pIndex->list[m_pIndex->have - 1];
+		}
+
+		res = build_index_ex(infile, m_pIndex->span, &built, resume.get(), &IndexProgress, this);
+		fclose(infile);
+	}
+
+	if (built)
+		PublishPoints(built);
+
+	{
+		std::lock_guard<std::mutex> lock(m_indexLock);
+		if (res >= 0 && built && m_pIndex->have)
+		{
+			m_pIndex->uncompressed_size = built->uncompressed_size;
+			m_indexComplete = true;
+		}
+		else if (res != INDEX_ABORTED)
+		{
+			m_indexFailed = true;
+		}
+	}
+	m_indexProgress.notify_all();
+
+	if (m_indexComplete)
+		WriteIndexToFile((Access*)m_pIndex, m_indexFile, m_gzSize, m_gzMtime, true);
+	else if (m_indexFailed)
+		Console.Error(L"ERROR (%d): index could not be generated for file '%s'", res, WX_STR(m_filename));
+
+	if (built)
+		free_index(built);
+}
+
+int GzippedFileReader::IndexProgress(Access* index, PX_off_t totin, void* opaque)
+{
+	GzippedFileReader* reader = (GzippedFileReader*)opaque;
+	reader->PublishPoints(index);
+	return reader->m_indexAbort;
+}
+
+// Moves the points the scan just found to the index the reads use.
+void GzippedFileReader::PublishPoints(Access* built)
+{
+	{
+		std::lock_guard<std::mutex> lock(m_indexLock);
+		for (int i = 0; i < built->have; i++)
+		{
+			if (m_pIndex->have == m_pIndex->size)
+			{
+				int size = m_pIndex->size ? m_pIndex->size * 2 : 8;
+				Point* list = (Point*)realloc(m_pIndex->list, sizeof(Point) * size);
+				if (!list)
+				{
+					m_indexFailed = true;
+					m_indexAbort = true;
+					break;
+				}
+				m_pIndex->list = list;
+				m_pIndex->size = size;
+			}
+			m_pIndex->list[m_pIndex->have++] = built->list[i];
+		}
+	}
+	built->have = 0;
+	m_indexProgress.notify_all();
+}
+
+// With a partial index, a read past its last access point has to inflate from there.
+// When that's far, let the scan get there instead of inflating the same data twice.
+void GzippedFileReader::WaitForIndex(std::unique_lock<std::mutex>& lock, PX_off_t offset)
+{
+	m_indexProgress.wait(lock, [&] {
+		return m_indexComplete || m_indexFailed ||
+			   (m_pIndex->have && offset - m_pIndex->list[m_pIndex->have - 1].out <= GZFILE_INDEX_WAIT_DISTANCE);
+	});
+}
+
+void GzippedFileReader::StopIndexThread()
+{
+	if (!m_indexThread.joinable())
+		return;
+
+	m_indexAbort = true;
+	m_indexThread.join();
+
+	// Keep what was scanned so far for the next time.
+	if (!m_indexComplete && !m_indexFailed && m_pIndex && m_pIndex->have)
+		WriteIndexToFile((Access*)m_pIndex, m_indexFile, m_gzSize, m_gzMtime, false);
+}
+
 bool GzippedFileReader::Open(const wxString& fileName)
 {
 	Close();
@@ -367,22 +724,105 @@ bool GzippedFileReader::Open(const wxString& fileName)
 
 void GzippedFileReader::BeginRead(void* pBuffer, uint sector, uint count)
 {
-	// No a-sync support yet, implement as sync
-	mBytesRead = ReadSync(pBuffer, sector, count);
-	return;
+	std::unique_lock<std::mutex> lock(m_readLock);
+	while (m_readPending)
+		m_readCond.wait(lock);
+
+	if (!m_readThread.joinable())
+		m_readThread = std::thread(&GzippedFileReader::ReadThread, this);
+
+	m_readBuffer = pBuffer;
+	m_readSector = sector;
+	m_readCount = count;
+	m_readPending = true;
+
+	lock.unlock();
+	m_readCond.notify_all();
 };
 
+uint GzippedFileReader::GetBlockCount(void) const
+{
+	if (!m_pIndex)
+		return 0;
+
+	// The index thread replaces the estimated size once the scan is done
+	std::lock_guard<std::mutex> lock(m_indexLock);
+
+	// type and formula copied from FlatFileReader
+	// FIXME? : Shouldn't it be uint and (size - m_dataoffset) / m_blocksize ?
+	return (int)(m_pIndex->uncompressed_size / m_blocksize);
+}
+
 int GzippedFileReader::FinishRead(void)
 {
+	WaitForRead();
+
 	int res = mBytesRead;
 	mBytesRead = -1;
 	return res;
 };
 
+void GzippedFileReader::ReadThread()
+{
+	std::unique_lock<std::mutex> lock(m_readLock);
+
+	while (true)
+	{
+		while (!m_readPending && !m_readExit)
+			m_readCond.wait(lock);
+
+		if (m_readExit)
+			return;
+
+		lock.unlock();
+
+		int res = ReadSectors(m_readBuffer, m_readSector, m_readCount);
+
+		lock.lock();
+
+		mBytesRead = res;
+		m_readPending = false;
+		m_readCond.notify_all();
+	}
+}
+
+void GzippedFileReader::WaitForRead()
+{
+	std::unique_lock<std::mutex> lock(m_readLock);
+	while (m_readPending)
+		m_readCond.wait(lock);
+}
+
+void GzippedFileReader::StopReadThread()
+{
+	if (!m_readThread.joinable())
+		return;
+
+	{
+		// A read that didn't start yet is dropped, one that runs completes first
+		std::lock_guard<std::mutex> lock(m_readLock);
+		m_readExit = true;
+	}
+	m_readCond.notify_all();
+
+	m_readThread.join();
+
+	m_readPending = false;
+	m_readExit = false;
+}
+
 #define PTT clock_t
 #define NOW() (clock() / (CLOCKS_PER_SEC / 1000))
 
 int GzippedFileReader::ReadSync(void* pBuffer, uint sector, uint count)
+{
+	// The decompression state belongs to the read thread while it runs
+	WaitForRead();
+
+	return ReadSectors(pBuffer, sector, count);
+}
+
+int GzippedFileReader::ReadSectors(void* pBuffer, uint sector, uint count)
 {
 	PX_off_t offset = (s64)sector * m_blocksize + m_dataoffset;
 	int bytesToRead = count * m_blocksize;
@@ -438,6 +878,10 @@ int GzippedFileReader::_ReadSync(void* pBuffer, PX_off_t offset, uint bytesToRea
 	if (res >= 0)
 		return res;
 
+	// The uncompressed size is only an estimate until the index is complete
+	if ((offset + GZFILE_READ_CHUNK_SIZE) / m_pIndex->span + 2 > m_zstatesCount)
+		InitZstates(offset + GZFILE_READ_CHUNK_SIZE);
+
 	// Not available from cache. Decompress from optimal starting
 	// point in GZFILE_READ_CHUNK_SIZE chunks and cache each chunk.
 	PTT s = NOW();
@@ -448,7 +892,37 @@ int GzippedFileReader::_ReadSync(void* pBuffer, PX_off_t offset, uint bytesToRea
 	int span = m_pIndex->span;
 	int spanix = extractOffset / span;
 	AsyncPrefetchCancel();
-	res = extract(m_src, m_pIndex, extractOffset, extracted, size, &(m_zstates[spanix].state));
+
+	// The index grows (and its list moves) while it's being scanned, so the lock is only
+	// held to copy the access point the extraction starts from. A valid state doesn't
+	// need one.
+	Zstate& state = m_zstates[spanix].state;
+	const bool resume = state.isValid && state.out_offset == extractOffset;
+	Access access;
+	Point point;
+	{
+		std::unique_lock<std::mutex> lock(m_indexLock);
+		if (!m_indexComplete && !resume)
+			WaitForIndex(lock, extractOffset);
+
+		access = *m_pIndex;
+		if (access.have && !resume)
+		{
+			// Same lookup as extract()
+			const Point* here = m_pIndex->list;
+			for (int ret = m_pIndex->have; --ret && here[1].out <= extractOffset;)
+				here++;
+
+			point = *here;
+			access.have = 1;
+			access.list = &point;
+		}
+	}
+
+	if (access.have)
+		res = extract(m_src, &access, extractOffset, extracted, size, &state);
+	else
+		res = Z_DATA_ERROR;
 	if (res < 0)
 	{
 		free(extracted);
@@ -473,20 +947,13 @@ int GzippedFileReader::_ReadSync(void* pBuffer, PX_off_t offset, uint bytesToRea
 		m_zstates[spanix].Kill();
 	}
 
-	if (size <= GZFILE_READ_CHUNK_SIZE)
-		m_cache.Take(extracted, extractOffset, res, size);
-	else
-	{ // split into cacheable chunks
-		for (int i = 0; i < size; i += GZFILE_READ_CHUNK_SIZE)
-		{
-			int available = CLAMP(res - i, 0, GZFILE_READ_CHUNK_SIZE);
-			void* chunk = available ? malloc(available) : 0;
-			if (available)
-				memcpy(chunk, extracted + i, available);
-			m_cache.Take(chunk, extractOffset + i, available, std::min(size - i, GZFILE_READ_CHUNK_SIZE));
-		}
-		free(extracted);
+	// split into cacheable chunks
+	for (int i = 0; i < size; i += GZFILE_READ_CHUNK_SIZE)
+	{
+		int available = CLAMP(res - i, 0, GZFILE_READ_CHUNK_SIZE);
+		m_cache.Insert(extracted + i, extractOffset + i, available, std::min(size - i, GZFILE_READ_CHUNK_SIZE));
 	}
+	free(extracted);
 
 	int duration = NOW() - s;
 	if (duration > 10)
@@ -501,15 +968,20 @@ int GzippedFileReader::_ReadSync(void* pBuffer, PX_off_t offset, uint bytesToRea
 
 void GzippedFileReader::Close()
 {
+	StopReadThread();
+	StopIndexThread();
+
 	m_filename.Empty();
-	if (m_pIndex)
-	{
-		free_index((Access*)m_pIndex);
-		m_pIndex = 0;
-	}
+	ReleaseIndex();
 
 	InitZstates(); // results in delete because no index
+
+	ChunksCache::Stats stats = m_cache.GetStats();
+	if (stats.hits + stats.misses)
+		DevCon.WriteLn(Color_Gray, L"gunzip: cache hits: %llu, misses: %llu, evictions: %llu",
+					   (unsigned long long)stats.hits, (unsigned long long)stats.misses, (unsigned long long)stats.evictions);
 	m_cache.Clear();
+	m_cache.ResetStats();
 
 	if (m_src)
 	{
@@ -17,6 +17,10 @@
 
 typedef struct zstate Zstate;
 
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
 #include "AsyncFileReader.h"
 #include "ChunksCache.h"
 #include "zlib_indexed.h"
@@ -24,6 +28,9 @@ typedef struct zstate Zstate;
 #define GZFILE_SPAN_DEFAULT (1048576L * 4)  /* distance between direct access points when creating a new index */
 #define GZFILE_READ_CHUNK_SIZE (256 * 1024) /* zlib extraction chunks size (at 0-based boundaries) */
 #define GZFILE_CACHE_SIZE_MB 200            /* cache size for extracted data. must be at least GZFILE_READ_CHUNK_SIZE (in MB)*/
+#define GZFILE_INDEX_WAIT_DISTANCE (1048576L * 32) /* reads further than this past a partial index wait for the scan */
+
+class GzIndexMapping;
 
 class GzippedFileReader : public AsyncFileReader
 {
@@ -45,12 +52,7 @@ public:
 
 	virtual void Close(void);
 
-	virtual uint GetBlockCount(void) const
-	{
-		// type and formula copied from FlatFileReader
-		// FIXME? : Shouldn't it be uint and (size - m_dataoffset) / m_blocksize ?
-		return (int)((m_pIndex ? m_pIndex->uncompressed_size : 0) / m_blocksize);
-	};
+	virtual uint GetBlockCount(void) const;
 
 	virtual void SetBlockSize(uint bytes) { m_blocksize = bytes; }
 	virtual void SetDataOffset(int bytes) { m_dataoffset = bytes; }
@@ -73,15 +75,55 @@ private:
 	bool OkIndex(); // Verifies that we have an index, or try to create one
 	PX_off_t GetOptimalExtractionStart(PX_off_t offset);
 	int _ReadSync(void* pBuffer, PX_off_t offset, uint bytesToRead);
-	void InitZstates();
-
-	int mBytesRead;   // Temp sync read result when simulating async read
+	void InitZstates(PX_off_t minSize = 0);
+	void ReleaseIndex();
+
+	// Background index scan
+	void BuildIndexThread();
+	static int IndexProgress(Access* index, PX_off_t totin, void* opaque);
+	void PublishPoints(Access* built);
+	void WaitForIndex(std::unique_lock<std::mutex>& lock, PX_off_t offset);
+	void StopIndexThread();
+
+	// Async reads
+	int ReadSectors(void* pBuffer, uint sector, uint count);
+	void ReadThread();
+	void WaitForRead();
+	void StopReadThread();
+
+	int mBytesRead;   // Result of the last read done by m_readThread
 	Access* m_pIndex; // Quick access index
+	GzIndexMapping* m_indexMapping; // Set when the index list is mapped from the disk
 	Czstate* m_zstates;
+	int m_zstatesCount;
 	FILE* m_src;
 
 	ChunksCache m_cache;
 
+	// The index file is only valid for this exact gzip file
+	wxString m_indexFile;
+	s64 m_gzSize;
+	s64 m_gzMtime;
+
+	// Until m_indexComplete, the scan appends to m_pIndex under m_indexLock
+	std::thread m_indexThread;
+	mutable std::mutex m_indexLock;
+	std::condition_variable m_indexProgress;
+	bool m_indexComplete;
+	bool m_indexFailed;
+	std::atomic<bool> m_indexAbort;
+
+	// BeginRead hands the read to m_readThread so the decompression doesn't block
+	// the caller, FinishRead waits for it. One read at a time, like the other readers.
+	std::thread m_readThread;
+	std::mutex m_readLock;
+	std::condition_variable m_readCond;
+	void* m_readBuffer;
+	uint m_readSector;
+	uint m_readCount;
+	bool m_readPending; // queued or running
+	bool m_readExit;
+
 #ifdef _WIN32
 	// Used by async prefetch
 	HANDLE hOverlappedFile;
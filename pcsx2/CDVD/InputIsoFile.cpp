@@ -51,6 +51,9 @@ int InputIsoFile::ReadSync(u8* dst, uint lsn)
 		return -1;
 	}
 
+	// The readers only handle one read at a time.
+	DropReadAhead();
+
 	return m_reader->ReadSync(dst + m_blockofs, lsn, 1);
 }
 
@@ -66,24 +69,113 @@ void InputIsoFile::BeginRead2(uint lsn)
 		return;
 	}
 
+	m_stats.requests++;
+
+	// Small forward skips still count as streaming, re-reads don't break a stream.
+	if (lsn > m_last_lsn && lsn - m_last_lsn <= 2)
+		m_sequential++;
+	else if (lsn != m_last_lsn)
+		m_sequential = 0;
+	m_last_lsn = lsn;
+
 	if (lsn >= m_read_lsn && lsn < (m_read_lsn + m_read_count))
 	{
 		// Already buffered
+		m_stats.hits++;
+		QueueReadAhead();
+		return;
+	}
+
+	if (m_readahead_count && lsn >= m_readahead_lsn && lsn < (m_readahead_lsn + m_readahead_count) && FinishReadAhead())
+	{
+		// The stream caught up with the read ahead, which becomes the current window
+		std::swap(m_readbuffer, m_readahead_buffer);
+		m_read_lsn = m_readahead_lsn;
+		m_read_count = m_readahead_count;
+		m_readahead_count = 0;
+		m_stats.readAheadHits++;
+
+		m_window = std::min(m_window * 2, ReadUnit);
+		QueueReadAhead();
 		return;
 	}
 
+	DropReadAhead();
+	if (m_read_inprogress)
+		m_reader->FinishRead();
+
+	m_stats.misses++;
+	if (m_sequential)
+		m_window = std::min(m_window * 2, ReadUnit);
+	else
+		m_window = std::max(m_window / 2, m_min_window);
+
 	m_read_lsn = lsn;
-	m_read_count = 1;
+	m_read_count = std::min(m_window, m_blocks - m_read_lsn);
+
+	m_reader->BeginRead(m_readbuffer, m_read_lsn, m_read_count);
+	m_read_inprogress = true;
+}
+
+// Starts reading the window after the current one, if the stream looks sequential.
+void InputIsoFile::QueueReadAhead()
+{
+	if (m_read_inprogress || m_readahead_count || m_sequential < ReadAheadThreshold || ReadUnit <= 1)
+		return;
+
+	const uint lsn = m_read_lsn + m_read_count;
+	if (lsn >= m_blocks)
+		return;
+
+	m_readahead_lsn = lsn;
+	m_readahead_count = std::min(m_window, m_blocks - lsn);
+
+	m_reader->BeginRead(m_readahead_buffer, m_readahead_lsn, m_readahead_count);
+	m_readahead_inprogress = true;
+	m_stats.readAheads++;
+}
+
+// Waits for the read ahead, returns false (and forgets it) if it failed.
+bool InputIsoFile::FinishReadAhead()
+{
+	if (!m_readahead_inprogress)
+		return true;
+
+	m_readahead_inprogress = false;
+	if (m_reader->FinishRead() < 0)
+	{
+		m_readahead_count = 0;
+		return false;
+	}
+	return true;
+}
 
-	if (ReadUnit > 1)
+void InputIsoFile::DropReadAhead()
+{
+	// Not all readers can really cancel, let it complete instead of leaving it in flight.
+	if (m_readahead_inprogress)
 	{
-		//m_read_lsn   = lsn - (lsn % ReadUnit);
+		m_reader->FinishRead();
+		m_readahead_inprogress = false;
+	}
 
-		m_read_count = std::min(ReadUnit, m_blocks - m_read_lsn);
+	if (m_readahead_count)
+	{
+		m_readahead_count = 0;
+		m_stats.readAheadsWasted++;
 	}
+}
 
-	m_reader->BeginRead(m_readbuffer, m_read_lsn, m_read_count);
-	m_read_inprogress = true;
+InputIsoFile::ReadStats InputIsoFile::GetReadStats() const
+{
+	ReadStats stats = m_stats;
+	stats.window = m_window;
+	return stats;
+}
+
+void InputIsoFile::ResetReadStats()
+{
+	memset(&m_stats, 0, sizeof(m_stats));
 }
 
 int InputIsoFile::FinishRead3(u8* dst, uint mode)
@@ -105,7 +197,13 @@ int InputIsoFile::FinishRead3(u8* dst, uint mode)
 		m_read_inprogress = false;
 
 		if (ret < 0)
+		{
+			m_read_count = 0;
 			return ret;
+		}
+
+		// Get the next window going while this one is consumed
+		QueueReadAhead();
 	}
 
 	switch (mode)
@@ -160,6 +258,7 @@ int InputIsoFile::FinishRead3(u8* dst, uint mode)
 }
 
 InputIsoFile::InputIsoFile()
+	: m_readbuffers(new u8[2 * MaxReadUnit * CD_FRAMESIZE_RAW])
 {
 	_init();
 }
@@ -185,6 +284,19 @@ void InputIsoFile::_init()
 	m_current_lsn = -1;
 	m_read_lsn = -1;
 	m_reader = NULL;
+
+	m_readbuffer = m_readbuffers.get();
+	m_readahead_buffer = m_readbuffers.get() + MaxReadUnit * CD_FRAMESIZE_RAW;
+	m_readahead_inprogress = false;
+	m_readahead_lsn = 0;
+	m_readahead_count = 0;
+
+	m_min_window = 1;
+	m_window = 1;
+	m_last_lsn = -1;
+	m_sequential = 0;
+
+	ResetReadStats();
 }
 
 // Tests the specified filename to see if it is a supported ISO type.  This function typically
@@ -241,8 +353,15 @@ bool InputIsoFile::Open(const wxString& srcfile, bool testOnly)
 
 		m_reader = bdr;
 
+		// Blockdumps are looked up a sector at a time
 		ReadUnit = 1;
 	}
+	else
+	{
+		// Compressed readers keep their own caches, random reads stay as small as they were.
+		ReadUnit = MaxReadUnit;
+		m_min_window = m_window = isCompressed ? 1 : MinReadUnit;
+	}
 
 	bool detected = Detect();
 
@@ -256,7 +375,7 @@ bool InputIsoFile::Open(const wxString& srcfile, bool testOnly)
 
 	if (!isBlockdump && !isCompressed)
 	{
-		ReadUnit = MaxReadUnit;
+		m_window = DefaultReadUnit;
 
 		m_reader->SetDataOffset(m_offset);
 		m_reader->SetBlockSize(m_blocksize);
@@ -286,6 +405,18 @@ bool InputIsoFile::Open(const wxString& srcfile, bool testOnly)
 
 void InputIsoFile::Close()
 {
+	if (m_reader)
+	{
+		DropReadAhead();
+
+		if (m_stats.requests)
+		{
+			DevCon.WriteLn("isoFile: %llu reads, %llu hits, %llu read ahead hits, %llu misses, %llu/%llu read aheads wasted, window %u",
+				(unsigned long long)m_stats.requests, (unsigned long long)m_stats.hits, (unsigned long long)m_stats.readAheadHits,
+				(unsigned long long)m_stats.misses, (unsigned long long)m_stats.readAheadsWasted, (unsigned long long)m_stats.readAheads, m_window);
+		}
+	}
+
 	delete m_reader;
 	m_reader = NULL;
 
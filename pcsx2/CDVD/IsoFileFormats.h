@@ -39,7 +39,30 @@ class InputIsoFile
 {
 	DeclareNoncopyableObject(InputIsoFile);
 
-	static const uint MaxReadUnit = 128;
+	// Read window bounds, in sectors. The window starts at DefaultReadUnit, doubles on
+	// sequential streams (movies, audio) up to MaxReadUnit and halves on random seeks
+	// down to MinReadUnit.
+	static const uint MinReadUnit = 16;
+	static const uint DefaultReadUnit = 128;
+	static const uint MaxReadUnit = 512;
+
+	// Sequential reads in a row before the next window is read ahead
+	static const uint ReadAheadThreshold = 2;
+
+public:
+	// Largest single read handed to the AsyncFileReader, in bytes
+	static const uint MaxReadSize = MaxReadUnit * CD_FRAMESIZE_RAW;
+
+	struct ReadStats
+	{
+		u64 requests;         // BeginRead2 calls
+		u64 hits;             // served from the current window
+		u64 readAheadHits;    // served from the window read ahead
+		u64 misses;           // needed a read of their own
+		u64 readAheads;       // windows read ahead
+		u64 readAheadsWasted; // windows read ahead but never used
+		uint window;          // current window size
+	};
 
 protected:
 	uint ReadUnit;
@@ -60,10 +83,28 @@ protected:
 	// total number of blocks in the ISO image (including all parts)
 	u32 m_blocks;
 
+	// Current window, read into m_readbuffer.
 	bool m_read_inprogress;
 	uint m_read_lsn;
 	uint m_read_count;
-	u8 m_readbuffer[MaxReadUnit * CD_FRAMESIZE_RAW];
+	u8* m_readbuffer;
+
+	// Next window, read into m_readahead_buffer while the current one is consumed.
+	// The buffers swap when the stream gets there.
+	bool m_readahead_inprogress;
+	uint m_readahead_lsn;
+	uint m_readahead_count;
+	u8* m_readahead_buffer;
+
+	std::unique_ptr<u8[]> m_readbuffers;
+
+	// Access pattern tracking
+	uint m_min_window;
+	uint m_window;
+	u32 m_last_lsn;
+	uint m_sequential;
+
+	ReadStats m_stats;
 
 public:
 	InputIsoFile();
@@ -90,11 +131,18 @@ public:
 	void BeginRead2(uint lsn);
 	int FinishRead3(u8* dest, uint mode);
 
+	ReadStats GetReadStats() const;
+	void ResetReadStats();
+
 protected:
 	void _init();
 
 	bool tryIsoType(u32 _size, s32 _offset, s32 _blockofs);
 	void FindParts();
+
+	void QueueReadAhead();
+	bool FinishReadAhead();
+	void DropReadAhead();
 };
 
 class OutputIsoFile
@@ -49,6 +49,7 @@ Comments) 1950 to 1952 in the files http://tools.ietf.org/html/rfc1950
       (Thanks to Mark Adler for suggesting the approach)
   - build_index(...) - added progress prints
   - CHUNK changed from 16k to 512k
+  - build_index_ex(...) - resumable build with a progress callback, for building in the background
  */
 
 /* Illustrate the use of Z_BLOCK, inflatePrime(), and inflateSetDictionary()
@@ -216,6 +217,14 @@ local struct access* addpoint(struct access* index, int bits,
 	return index;
 }
 
+/* Returned by build_index_ex() when the progress callback asked to stop */
+#define INDEX_ABORTED (-100)
+
+/* Called by build_index_ex() after each new access point, with the points
+   added so far and the compressed bytes consumed. It may take the points out
+   of the index by resetting index->have to 0. Return non-zero to abort. */
+typedef int (*index_progress)(struct access* index, PX_off_t totin, void* opaque);
+
 /* Make one entire pass through the compressed stream and build an index, with
    access points about every span bytes of uncompressed output -- span is
    chosen to balance the speed of random access against the memory requirements
@@ -223,8 +232,14 @@ local struct access* addpoint(struct access* index, int bits,
    of the first zlib or gzip stream in the file is ignored.  build_index()
    returns the number of access points on success (>= 1), Z_MEM_ERROR for out
    of memory, Z_DATA_ERROR for an error in the input file, or Z_ERRNO for a
-   file read error.  On success, *built points to the resulting index. */
-local int build_index(FILE* in, PX_off_t span, struct access** built)
+   file read error.  On success, *built points to the resulting index.
+
+   build_index_ex() can also continue from the last access point of a partial
+   index (resume), in which case only the following points are added, and
+   returns INDEX_ABORTED with the partial *built when progress() asks to stop.
+   Without progress(), it prints the progress to stdout like build_index(). */
+local int build_index_ex(FILE* in, PX_off_t span, struct access** built,
+						 struct point* resume, index_progress progress, void* opaque)
 {
 	int ret;
 	PX_off_t totin, totout, totPrinted; /* our own total counters to avoid 4GB limit */
@@ -240,15 +255,62 @@ local int build_index(FILE* in, PX_off_t span, struct access** built)
 	strm.opaque = Z_NULL;
 	strm.avail_in = 0;
 	strm.next_in = Z_NULL;
-	ret = inflateInit2(&strm, 47); /* automatic zlib or gzip decoding */
-	if (ret != Z_OK)
-		return ret;
+	totin = totout = last = totPrinted = 0;
+	index = NULL; /* will be allocated by first addpoint() */
+
+	if (resume == NULL)
+	{
+		ret = inflateInit2(&strm, 47); /* automatic zlib or gzip decoding */
+		if (ret != Z_OK)
+			return ret;
+	}
+	else
+	{
+		/* same as extract(): raw inflate from the access point */
+		ret = inflateInit2(&strm, -15);
+		if (ret != Z_OK)
+			return ret;
+		if (PX_fseeko(in, resume->in - (resume->bits ? 1 : 0), SEEK_SET) == -1)
+		{
+			ret = Z_ERRNO;
+			goto build_index_error;
+		}
+		if (resume->bits)
+		{
+			ret = getc(in);
+			if (ret == -1)
+			{
+				ret = ferror(in) ? Z_ERRNO : Z_DATA_ERROR;
+				goto build_index_error;
+			}
+			inflatePrime(&strm, resume->bits, ret >> (8 - resume->bits));
+		}
+		inflateSetDictionary(&strm, resume->window, WINSIZE);
+		totin = totPrinted = resume->in;
+		totout = last = resume->out;
+
+		/* the caller already has the points up to here, start with an empty list */
+		index = (Access*)malloc(sizeof(struct access));
+		if (index == NULL)
+		{
+			ret = Z_MEM_ERROR;
+			goto build_index_error;
+		}
+		index->list = (Point*)malloc(sizeof(struct point) << 3);
+		if (index->list == NULL)
+		{
+			free(index);
+			index = NULL;
+			ret = Z_MEM_ERROR;
+			goto build_index_error;
+		}
+		index->size = 8;
+		index->have = 0;
+	}
 
 	/* inflate the input, maintain a sliding window, and build an index -- this
        also validates the integrity of the compressed data using the check
        information at the end of the gzip or zlib stream */
-	totin = totout = last = totPrinted = 0;
-	index = NULL; /* will be allocated by first addpoint() */
 	strm.avail_out = 0;
 	do
 	{
@@ -310,9 +372,16 @@ local int build_index(FILE* in, PX_off_t span, struct access** built)
 					goto build_index_error;
 				}
 				last = totout;
+
+				if (progress && progress(index, totin, opaque))
+				{
+					(void)inflateEnd(&strm);
+					*built = index;
+					return INDEX_ABORTED;
+				}
 			}
 		} while (strm.avail_in != 0);
-		if (totin / (50 * 1024 * 1024) != totPrinted / (50 * 1024 * 1024))
+		if (!progress && totin / (50 * 1024 * 1024) != totPrinted / (50 * 1024 * 1024))
 		{
 			printf("%dMB ", (int)(totin / (1024 * 1024)));
 			totPrinted = totin;
@@ -327,8 +396,11 @@ local int build_index(FILE* in, PX_off_t span, struct access** built)
 
 	/* clean up and return index (release unused entries in list) */
 	(void)inflateEnd(&strm);
-	index->list = (Point*)realloc(index->list, sizeof(struct point) * index->have);
-	index->size = index->have;
+	if (index->have)
+	{
+		index->list = (Point*)realloc(index->list, sizeof(struct point) * index->have);
+		index->size = index->have;
+	}
 	index->span = span;
 	index->uncompressed_size = totout;
 	*built = index;
@@ -342,6 +414,11 @@ build_index_error:
 	return ret;
 }
 
+local int build_index(FILE* in, PX_off_t span, struct access** built)
+{
+	return build_index_ex(in, span, built, NULL, NULL, NULL);
+}
+
 typedef struct zstate
 {
 	PX_off_t out_offset;
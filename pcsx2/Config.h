@@ -289,6 +289,7 @@ struct Pcsx2Config
 		bool	SynchronousMTGS;
 
 		int		VsyncQueueSize;
+		int		MTGSRingSizeFactor;	// log2 of the MTGS ring size in qwords, read when the MTGS thread starts
 
 		bool		FrameLimitEnable;
 		bool		FrameSkipEnable;
@@ -311,6 +312,7 @@ struct Pcsx2Config
 			return
 				OpEqu( SynchronousMTGS )		&&
 				OpEqu( VsyncQueueSize )			&&
+				OpEqu( MTGSRingSizeFactor )		&&
 				
 				OpEqu( FrameSkipEnable )		&&
 				OpEqu( FrameLimitEnable )		&&
@@ -445,6 +447,7 @@ struct Pcsx2Config
 			CdvdVerboseReads	:1,		// enables cdvd read activity verbosely dumped to the console
 			CdvdDumpBlocks		:1,		// enables cdvd block dumping
 			CdvdShareWrite		:1,		// allows the iso to be modified while it's loaded
+			CdvdDirectIO		:1,		// reads the iso with O_DIRECT, bypassing the page cache (Linux io_uring reader)
 			EnablePatches		:1,		// enables patch detection and application
 			EnableCheats		:1,		// enables cheat detection and application
 			EnableIPC		    :1,		// enables inter-process communication 
@@ -305,6 +305,27 @@ struct MTGS_FreezeData
 	s32			retval;		// value returned from the call, valid only after an mtgsWaitGS()
 };
 
+// Frame pacing telemetry of the MTGS ring (see SysMtgsThread::GetStats).
+struct MTGS_Stats
+{
+	// Times are bucketed by log2 of microseconds: [0] is under 1us, [n] is under 2^n us
+	// and the last bucket takes everything longer.
+	static const uint TimeBuckets = 20;
+	// Ring occupancy is sampled on every vsync, in 1/16ths of the ring.
+	static const uint OccupancyBuckets = 16;
+
+	u64 eeWait[TimeBuckets];			// EE (or MTVU) time stalled on a full ring or in WaitGS
+	u64 gsIdle[TimeBuckets];			// MTGS time spent waiting for packets
+	u64 occupancy[OccupancyBuckets];	// Ring fill level at vsync
+	u64 eeSpinWaits;					// EE stalls that ended while spinning
+	u64 eeSleepWaits;					// EE stalls that had to sleep
+
+	u64 gsPackets;						// GIF path packets sent to the MTGS
+	u64 gsPacketBytes;					// Total size of those packets
+	u64 gsSubmissions;					// Ring commands they took after coalescing
+	u64 ticks;							// CPU ticks covered by the counters above
+};
+
 // --------------------------------------------------------------------------------------
 //  SysMtgsThread
 // --------------------------------------------------------------------------------------
@@ -315,10 +336,12 @@ class SysMtgsThread : public SysThreadBase
 public:
 	// note: when m_ReadPos == m_WritePos, the fifo is empty
 	// Threading info: m_ReadPos is updated by the MTGS thread. m_WritePos is updated by the EE thread
-	std::atomic<unsigned int> m_ReadPos;  // cur pos gs is reading from
-	std::atomic<unsigned int> m_WritePos; // cur pos ee thread is writing to
+	// Each position has its own cache line, so polling one side doesn't bounce the other's line.
+	__aligned(64) std::atomic<unsigned int> m_ReadPos;  // cur pos gs is reading from
+	__aligned(64) std::atomic<unsigned int> m_WritePos; // cur pos ee thread is writing to
+	unsigned int		m_CachedReadPos;	// EE copy of m_ReadPos, only refreshed when the ring looks full
 
-	std::atomic<bool>	m_RingBufferIsBusy;
+	__aligned(64) std::atomic<bool>	m_RingBufferIsBusy;
 	std::atomic<bool>	m_SignalRingEnable;
 	std::atomic<int>	m_SignalRingPosition;
 
@@ -349,10 +372,25 @@ public:
 	uint			m_packet_size;		// size of the packet (data only, ie. not including the 16 byte command!)
 	uint			m_packet_writepos;	// index of the data location in the ringbuffer.
 
+	// A GS packet command is left unpublished at m_WritePos while the packets that follow
+	// it can still be merged into it (see SendSimpleGSPacket).  EE thread only.
+	bool			m_PendingGSPacket;
+
 #ifdef RINGBUF_DEBUG_STACK
 	Threading::Mutex m_lock_Stack;
 #endif
 
+	// Telemetry, see MTGS_Stats
+	std::atomic<u64>	m_StatEEWait[MTGS_Stats::TimeBuckets];
+	std::atomic<u64>	m_StatGSIdle[MTGS_Stats::TimeBuckets];
+	std::atomic<u64>	m_StatOccupancy[MTGS_Stats::OccupancyBuckets];
+	std::atomic<u64>	m_StatEESpinWaits;
+	std::atomic<u64>	m_StatEESleepWaits;
+	std::atomic<u64>	m_StatStartTicks;
+	std::atomic<u64>	m_StatGSPackets;		// Counted by the EE, logged by the MTGS on close
+	std::atomic<u64>	m_StatGSPacketBytes;
+	std::atomic<u64>	m_StatGSSubmissions;
+
 public:
 	SysMtgsThread();
 	virtual ~SysMtgsThread();
@@ -373,11 +411,14 @@ public:
 	void SendPointerPacket( MTGS_RingCommand type, u32 data0, void* data1 );
 
 	u8* GetDataPacketPtr() const;
-	void SetEvent();
+	void SetEvent(bool isMTVU = false);
 	void PostVsyncStart();
 
 	bool IsGSOpened() const { return m_Opened; }
 
+	MTGS_Stats GetStats() const;
+	void ResetStats();
+
 protected:
 	void OpenGS();
 	void CloseGS();
@@ -391,9 +432,11 @@ protected:
 	void OnCleanupInThread();
 
 	void GenericStall( uint size );
+	void LogStats() const;
 
 	// Used internally by SendSimplePacket type functions
 	void _FinishSimplePacket();
+	void FlushGSPacket();
 	void ExecuteTaskInThread();
 };
 
@@ -459,24 +502,27 @@ extern int g_nLeftGSFrames;
 #endif
 
 // Size of the ringbuffer as a power of 2 -- size is a multiple of simd128s.
-// (actual size is 1<<m_RingBufferSizeFactor simd vectors [128-bit values])
+// (actual size is 1<<GSOptions::MTGSRingSizeFactor simd vectors [128-bit values], read
+// when the MTGS thread starts)
 // A value of 19 is a 8meg ring buffer.  18 would be 4 megs, and 20 would be 16 megs.
 // Default was 2mb, but some games with lots of MTGS activity want 8mb to run fast (rama)
-static const uint RingBufferSizeFactor = 19;
+static const uint RingBufferSizeFactorDefault = 19;
+static const uint RingBufferSizeFactorMin = 16;
+static const uint RingBufferSizeFactorMax = 23;
 
 // size of the ringbuffer in simd128's.
-static const uint RingBufferSize = 1<<RingBufferSizeFactor;
+extern uint RingBufferSize;
 
 // Mask to apply to ring buffer indices to wrap the pointer from end to
 // start (the wrapping is what makes it a ringbuffer, yo!)
-static const uint RingBufferMask = RingBufferSize - 1;
+extern uint RingBufferMask;
 
 struct MTGS_BufferedData
 {
-	u128		m_Ring[RingBufferSize];
+	u128*		m_Ring;
 	u8			Regs[Ps2MemSize::GSregs];
 
-	MTGS_BufferedData() {}
+	MTGS_BufferedData() : m_Ring(NULL) {}
 
 	u128& operator[]( uint idx )
 	{
@@ -18,6 +18,7 @@
 #include "GSUtil.h"
 #include "Renderers/SW/GSRendererSW.h"
 #include "Renderers/Null/GSRendererNull.h"
+#include "Renderers/Null/GSRendererHWNull.h"
 #include "Renderers/Null/GSDeviceNull.h"
 #include "Renderers/OpenGL/GSDeviceOGL.h"
 #include "Renderers/OpenGL/GSRendererOGL.h"
@@ -51,6 +52,7 @@ extern bool RunLinuxDialog();
 #endif
 
 #include <fstream>
+#include <chrono>
 
 // do NOT undefine this/put it above includes, as x11 people love to redefine
 // things that make obscure compiler bugs, unless you want to run around and
@@ -866,6 +868,404 @@ void GSsetExclusive(int enabled)
 	}
 }
 
+// Opens a .gs, .gs.xz or indexed .gsi dump. Indexed dumps are moved to the last
+// keyframe at or before first_frame, the other formats always start at frame 0.
+// Returns the number of frames to replay before first_frame is reached.
+static GSDumpFile* GSReplayOpen(char* filename, bool repack_dump, uint32 first_frame, uint32& skip)
+{
+	std::string f(filename);
+	bool is_xz = (f.size() >= 4) && (f.compare(f.size() - 3, 3, ".xz") == 0);
+	bool is_indexed = (f.size() >= 4) && (f.compare(f.size() - 4, 4, ".gsi") == 0);
+	if (is_xz)
+		f.replace(f.end() - 6, f.end(), "_repack.gs");
+	else if (is_indexed)
+		f.replace(f.end() - 4, f.end(), "_repack.gs");
+	else
+		f.replace(f.end() - 3, f.end(), "_repack.gs");
+
+	skip = first_frame;
+
+	if (is_indexed)
+	{
+		GSDumpIndexedFile* file = new GSDumpIndexedFile(filename, repack_dump ? f.c_str() : nullptr);
+
+		if (first_frame > 0)
+			skip = first_frame - file->Seek(first_frame);
+
+		return file;
+	}
+
+	return is_xz ? (GSDumpFile*)new GSDumpLzma(filename, repack_dump ? f.c_str() : nullptr) : (GSDumpFile*)new GSDumpRaw(filename, repack_dump ? f.c_str() : nullptr);
+}
+
+// Reads the dump header: crc, frozen GS state and privileged registers
+static uint32 GSReplayReadHeader(GSDumpFile* file, uint8* regs, std::vector<char>& state)
+{
+	uint32 crc;
+	file->Read(&crc, 4);
+
+	int size;
+	file->Read(&size, 4);
+	state.resize(size);
+	file->Read(state.data(), size);
+
+	file->Read(regs, 0x2000);
+
+	return crc;
+}
+
+static void GSReplayRestore(uint32 crc, std::vector<char>& state)
+{
+	GSsetGameCRC(crc, 0);
+
+	freezeData fd = {(int)state.size(), state.data()};
+	GSfreeze(FREEZE_LOAD, &fd);
+}
+
+// Loads the packets of the dump in memory, the whole range is decompressed upfront
+static long GSReplayLoad(char* filename, uint32 first_frame, uint32 frames, uint8* regs, std::vector<char>& state, std::list<GSDumpPacket*>& packets, uint32& skip)
+{
+	long frame_number = 0;
+
+	std::unique_ptr<GSDumpFile> file(GSReplayOpen(filename, false, first_frame, skip));
+
+	GSReplayRestore(GSReplayReadHeader(file.get(), regs, state), state);
+
+	while (frames == 0 || frame_number < (long)(skip + frames))
+	{
+		GSDumpPacket* p = new GSDumpPacket();
+
+		if (!file->ReadPacket(*p))
+		{
+			delete p;
+			break;
+		}
+
+		if (p->type == 1)
+			frame_number++;
+
+		packets.push_back(p);
+	}
+
+	return frame_number;
+}
+
+static void GSReplayExecute(const GSDumpPacket* p, uint8* regs, std::vector<uint8>& buff)
+{
+	switch (p->type)
+	{
+		case 0:
+
+			switch (p->param)
+			{
+				case 0:
+					GSgifTransfer1(const_cast<uint8*>(&p->buff[0]), p->addr);
+					break;
+				case 1:
+					GSgifTransfer2(const_cast<uint8*>(&p->buff[0]), p->size / 16);
+					break;
+				case 2:
+					GSgifTransfer3(const_cast<uint8*>(&p->buff[0]), p->size / 16);
+					break;
+				case 3:
+					GSgifTransfer(&p->buff[0], p->size / 16);
+					break;
+			}
+
+			break;
+
+		case 1:
+
+			GSvsync(p->param);
+
+			break;
+
+		case 2:
+
+			if (buff.size() < p->size)
+				buff.resize(p->size);
+
+			GSreadFIFO2(&buff[0], p->size / 16);
+
+			break;
+
+		case 3:
+
+			memcpy(regs, &p->buff[0], 0x2000);
+
+			break;
+	}
+}
+
+static void GSReplayRelease(std::list<GSDumpPacket*>& packets)
+{
+	for (auto i = packets.begin(); i != packets.end(); i++)
+	{
+		delete *i;
+	}
+
+	packets.clear();
+}
+
+// Software renderer, or the hardware one with replay_hw, on top of the null
+// device. Nothing is presented so no window (and no X/EGL/WGL context) is required.
+static int _GSopenHeadless(int threads)
+{
+	if (threads == -1)
+	{
+		threads = theApp.GetConfigI("extrathreads");
+	}
+
+	try
+	{
+		delete s_gs;
+
+		if (theApp.GetConfigB("replay_hw"))
+		{
+			s_gs = new GSRendererHWNull();
+			s_renderer_name = "HW";
+
+			theApp.SetCurrentRendererType(GSRendererType::Null);
+		}
+		else
+		{
+			s_gs = new GSRendererSW(threads);
+			s_renderer_name = "SW";
+
+			theApp.SetCurrentRendererType(GSRendererType::OGL_SW);
+		}
+	}
+	catch (std::exception& ex)
+	{
+		printf("GS error: Exception caught in GSopen: %s", ex.what());
+		return -1;
+	}
+
+	s_gs->SetRegsMem(s_basemem);
+	s_gs->SetIrqCallback(s_irq);
+	s_gs->SetVSync(0);
+
+	if (!s_gs->CreateDevice(new GSDeviceNull()))
+	{
+		GSclose();
+
+		return -1;
+	}
+
+	return 0;
+}
+
+static double GSReplayPercentile(const std::vector<double>& sorted, double p)
+{
+	if (sorted.empty())
+		return 0;
+
+	size_t i = std::min<size_t>((size_t)(p * (sorted.size() - 1) + 0.5), sorted.size() - 1);
+
+	return sorted[i];
+}
+
+// Quotes a string for the JSON report
+static std::string GSReplayJsonString(const std::string& str)
+{
+	std::string out = "\"";
+
+	for (char c : str)
+	{
+		switch (c)
+		{
+			case '"': out += "\\\""; break;
+			case '\\': out += "\\\\"; break;
+			case '\b': out += "\\b"; break;
+			case '\f': out += "\\f"; break;
+			case '\n': out += "\\n"; break;
+			case '\r': out += "\\r"; break;
+			case '\t': out += "\\t"; break;
+			default:
+				if ((unsigned char)c < 0x20)
+				{
+					char buff[8];
+					snprintf(buff, sizeof(buff), "\\u%04x", (unsigned char)c);
+					out += buff;
+				}
+				else
+				{
+					out += c;
+				}
+				break;
+		}
+	}
+
+	return out + "\"";
+}
+
+void GSReplayBenchmark(char* lpszCmdLine, int loops, int threads, const char* report)
+{
+	GLLoader::in_replayer = true;
+
+	if (GSinit() != 0)
+	{
+		fprintf(stderr, "GS: replay benchmark failed to init\n");
+		return;
+	}
+
+	std::list<GSDumpPacket*> packets;
+	std::vector<uint8> buff;
+	std::vector<char> state;
+	uint8 regs[0x2000];
+
+	GSsetBaseMem(regs);
+
+	if (_GSopenHeadless(threads) != 0)
+	{
+		fprintf(stderr, "GS: replay benchmark failed to open the renderer\n");
+		GSshutdown();
+		return;
+	}
+
+	// Unlike GSReplay, the dump is preloaded so decompression doesn't compete
+	// with the rasterizer threads during the measured loops. Frames between the
+	// keyframe and replay_first_frame are replayed but not measured.
+	uint32 skip = 0;
+	GSReplayLoad(lpszCmdLine, theApp.GetConfigI("replay_first_frame"), theApp.GetConfigI("replay_frames"), regs, state, packets, skip);
+
+	std::vector<uint8> initial_regs(regs, regs + sizeof(regs));
+
+	loops = std::max(loops, 1);
+
+	struct LoopStats
+	{
+		long frames;
+		double ms;
+	};
+
+	std::vector<LoopStats> loop_stats;
+	std::vector<double> frame_ms;
+
+	// Init vsync stuff
+	GSvsync(1);
+
+	s_gs->m_perfmon.ResetTotals();
+
+	for (int loop = 0; loop < loops; loop++)
+	{
+		// Every loop starts from the same GS state so the runs are comparable
+		freezeData fd = {(int)state.size(), state.data()};
+		GSfreeze(FREEZE_LOAD, &fd);
+		memcpy(regs, initial_regs.data(), sizeof(regs));
+
+		LoopStats ls = {0, 0};
+
+		auto i = packets.begin();
+
+		for (uint32 frame = 0; frame < skip && i != packets.end(); i++)
+		{
+			GSReplayExecute(*i, regs, buff);
+
+			if ((*i)->type == 1)
+				frame++;
+		}
+
+		auto loop_start = std::chrono::steady_clock::now();
+		auto frame_start = loop_start;
+
+		for (; i != packets.end(); i++)
+		{
+			GSReplayExecute(*i, regs, buff);
+
+			if ((*i)->type == 1)
+			{
+				auto now = std::chrono::steady_clock::now();
+				frame_ms.push_back(std::chrono::duration<double, std::milli>(now - frame_start).count());
+				frame_start = now;
+				ls.frames++;
+			}
+		}
+
+		ls.ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - loop_start).count();
+		loop_stats.push_back(ls);
+	}
+
+	GSPerfMon& pm = s_gs->m_perfmon;
+
+	FILE* fp = report ? fopen(report, "w") : stdout;
+	if (fp == nullptr)
+	{
+		fprintf(stderr, "GS: failed to open %s, the report goes to stdout\n", report);
+		fp = stdout;
+	}
+
+	long total_frames = 0;
+	double total_ms = 0;
+
+	for (const auto& ls : loop_stats)
+	{
+		total_frames += ls.frames;
+		total_ms += ls.ms;
+	}
+
+	std::vector<double> sorted(frame_ms);
+	std::sort(sorted.begin(), sorted.end());
+
+	double frame_avg = total_frames > 0 ? total_ms / total_frames : 0;
+
+	fprintf(fp, "{\n");
+	fprintf(fp, "\t\"dump\": %s,\n", GSReplayJsonString(lpszCmdLine).c_str());
+	fprintf(fp, "\t\"renderer\": \"%s\",\n", s_renderer_name.c_str());
+	// The hardware renderer has no rasterizer threads
+	if (s_renderer_name == "SW")
+		fprintf(fp, "\t\"threads\": %d,\n", threads == -1 ? theApp.GetConfigI("extrathreads") : threads);
+	fprintf(fp, "\t\"loops\": [");
+	for (size_t i = 0; i < loop_stats.size(); i++)
+	{
+		const LoopStats& ls = loop_stats[i];
+		fprintf(fp, "%s\n\t\t{\"frames\": %ld, \"ms\": %.3f, \"fps\": %.3f}", i ? "," : "",
+			ls.frames, ls.ms, ls.ms > 0 ? ls.frames * 1000.0 / ls.ms : 0.0);
+	}
+	fprintf(fp, "\n\t],\n");
+	fprintf(fp, "\t\"frames\": %ld,\n", total_frames);
+	fprintf(fp, "\t\"ms\": %.3f,\n", total_ms);
+	fprintf(fp, "\t\"fps\": %.3f,\n", total_ms > 0 ? total_frames * 1000.0 / total_ms : 0.0);
+	fprintf(fp, "\t\"frame_ms\": {\"avg\": %.4f, \"min\": %.4f, \"p50\": %.4f, \"p95\": %.4f, \"p99\": %.4f, \"max\": %.4f},\n",
+		frame_avg,
+		sorted.empty() ? 0.0 : sorted.front(),
+		GSReplayPercentile(sorted, 0.50),
+		GSReplayPercentile(sorted, 0.95),
+		GSReplayPercentile(sorted, 0.99),
+		sorted.empty() ? 0.0 : sorted.back());
+
+	static const char* counter_names[GSPerfMon::CounterLast] = {
+		"Frame", "Prim", "Draw", "Swizzle", "Unswizzle", "Fillrate", "Quad", "SyncPoint", "Steal", "PageWait",
+		"TextureHashHit", "TextureHashMiss", "TextureUpload"};
+
+	fprintf(fp, "\t\"counters\": {");
+	for (int i = 0; i < GSPerfMon::CounterLast; i++)
+	{
+		double total = pm.GetTotal((GSPerfMon::counter_t)i);
+		fprintf(fp, "%s\n\t\t\"%s\": {\"total\": %.0f, \"per_frame\": %.3f}", i ? "," : "",
+			counter_names[i], total, total_frames > 0 ? total / total_frames : 0.0);
+	}
+	fprintf(fp, "\n\t},\n");
+
+	fprintf(fp, "\t\"timers\": {\"Main\": %llu, \"Sync\": %llu, \"WorkerDraw\": [",
+		(unsigned long long)pm.GetTicks(GSPerfMon::Main),
+		(unsigned long long)pm.GetTicks(GSPerfMon::Sync));
+	for (int i = GSPerfMon::WorkerDraw0; i <= GSPerfMon::WorkerDraw31; i++)
+	{
+		fprintf(fp, "%s%llu", i != GSPerfMon::WorkerDraw0 ? ", " : "", (unsigned long long)pm.GetTicks(i));
+	}
+	fprintf(fp, "]}\n");
+	fprintf(fp, "}\n");
+
+	if (fp != stdout)
+		fclose(fp);
+
+	GSReplayRelease(packets);
+
+	GSclose();
+	GSshutdown();
+}
+
 #if defined(__unix__) || defined(__APPLE__)
 
 inline unsigned long timeGetTime()
@@ -896,15 +1296,8 @@ void GSReplay(char* lpszCmdLine, int renderer)
 		return;
 	}
 
-	struct Packet
-	{
-		uint8 type, param;
-		uint32 size, addr;
-		std::vector<uint8> buff;
-	};
-
-	std::list<Packet*> packets;
 	std::vector<uint8> buff;
+	std::vector<char> state;
 	uint8 regs[0x2000];
 
 	GSsetBaseMem(regs);
@@ -931,146 +1324,57 @@ void GSReplay(char* lpszCmdLine, int renderer)
 	if (s_gs->m_wnd == NULL)
 		return;
 
-	{ // Read .gs content
-		std::string f(lpszCmdLine);
-		bool is_xz = (f.size() >= 4) && (f.compare(f.size() - 3, 3, ".xz") == 0);
-		if (is_xz)
-			f.replace(f.end() - 6, f.end(), "_repack.gs");
-		else
-			f.replace(f.end() - 3, f.end(), "_repack.gs");
-
-		GSDumpFile* file = is_xz ? (GSDumpFile*)new GSDumpLzma(lpszCmdLine, repack_dump ? f.c_str() : nullptr) : (GSDumpFile*)new GSDumpRaw(lpszCmdLine, repack_dump ? f.c_str() : nullptr);
-
-		uint32 crc;
-		file->Read(&crc, 4);
-		GSsetGameCRC(crc, 0);
-
-		freezeData fd;
-		file->Read(&fd.size, 4);
-		fd.data = new char[fd.size];
-		file->Read(fd.data, fd.size);
-
-		GSfreeze(FREEZE_LOAD, &fd);
-		delete[] fd.data;
-
-		file->Read(regs, 0x2000);
-
-		uint8 type;
-		while (file->Read(&type, 1))
-		{
-			Packet* p = new Packet();
-
-			p->type = type;
-
-			switch (type)
-			{
-				case 0:
-					file->Read(&p->param, 1);
-					file->Read(&p->size, 4);
-
-					switch (p->param)
-					{
-						case 0:
-							p->buff.resize(0x4000);
-							p->addr = 0x4000 - p->size;
-							file->Read(&p->buff[p->addr], p->size);
-							break;
-						case 1:
-						case 2:
-						case 3:
-							p->buff.resize(p->size);
-							file->Read(&p->buff[0], p->size);
-							break;
-					}
-
-					break;
-
-				case 1:
-					file->Read(&p->param, 1);
-					frame_number++;
-
-					break;
-
-				case 2:
-					file->Read(&p->size, 4);
+	// Packets are decoded on a separate thread while they are replayed. The
+	// dump is decoded again on each loop, so memory stays bounded whatever its size.
+	const size_t stream_capacity = 4096;
 
-					break;
-
-				case 3:
-					p->buff.resize(0x2000);
-
-					file->Read(&p->buff[0], 0x2000);
-
-					break;
-			}
+	uint32 skip = 0;
+	uint32 first_frame = theApp.GetConfigI("replay_first_frame");
+	uint32 frames = theApp.GetConfigI("replay_frames");
 
-			packets.push_back(p);
+	if (repack_dump)
+	{
+		std::unique_ptr<GSDumpFile> file(GSReplayOpen(lpszCmdLine, true, 0, skip));
+		GSReplayReadHeader(file.get(), regs, state);
 
-			if (repack_dump && frame_number > -finished)
-				break;
-		}
+		GSDumpStream stream(file.release(), stream_capacity, -finished + 1);
 
-		delete file;
+		while (stream.Front())
+			stream.Pop();
 	}
 
 	sleep(2);
 
-
-	frame_number = 0;
-
 	// Init vsync stuff
-	GSvsync(1);
+	bool init_vsync = true;
 
 	while (finished > 0)
 	{
-		for (auto i = packets.begin(); i != packets.end(); i++)
-		{
-			Packet* p = *i;
+		// Indexed dumps start at the closest keyframe, so several replays can
+		// share the frame ranges of a single dump
+		std::unique_ptr<GSDumpFile> file(GSReplayOpen(lpszCmdLine, false, first_frame, skip));
+		uint32 crc = GSReplayReadHeader(file.get(), regs, state);
 
-			switch (p->type)
-			{
-				case 0:
+		// A range always restarts from its keyframe
+		if (init_vsync || first_frame > 0)
+			GSReplayRestore(crc, state);
 
-					switch (p->param)
-					{
-						case 0:
-							GSgifTransfer1(&p->buff[0], p->addr);
-							break;
-						case 1:
-							GSgifTransfer2(&p->buff[0], p->size / 16);
-							break;
-						case 2:
-							GSgifTransfer3(&p->buff[0], p->size / 16);
-							break;
-						case 3:
-							GSgifTransfer(&p->buff[0], p->size / 16);
-							break;
-					}
-
-					break;
-
-				case 1:
-
-					GSvsync(p->param);
-					frame_number++;
-
-					break;
-
-				case 2:
-
-					if (buff.size() < p->size)
-						buff.resize(p->size);
-
-					GSreadFIFO2(&buff[0], p->size / 16);
+		if (init_vsync)
+		{
+			GSvsync(1);
+			init_vsync = false;
+		}
 
-					break;
+		GSDumpStream stream(file.release(), stream_capacity, frames > 0 ? skip + frames : 0);
 
-				case 3:
+		while (const GSDumpPacket* p = stream.Front())
+		{
+			GSReplayExecute(p, regs, buff);
 
-					memcpy(regs, &p->buff[0], 0x2000);
+			if (p->type == 1)
+				frame_number++;
 
-					break;
-			}
+			stream.Pop();
 		}
 
 		if (finished >= 200)
@@ -1097,13 +1401,6 @@ void GSReplay(char* lpszCmdLine, int renderer)
 		(float)g_uniform_upload_byte / (float)total_frame_nb);
 #endif
 
-	for (auto i = packets.begin(); i != packets.end(); i++)
-	{
-		delete *i;
-	}
-
-	packets.clear();
-
 	sleep(2);
 
 	GSclose();
@@ -1622,13 +1919,17 @@ void GSApp::Init()
 	m_default_configuration["disable_hw_gl_draw"]                         = "0";
 	m_default_configuration["dithering_ps2"]                              = "2";
 	m_default_configuration["dump"]                                       = "0";
+	m_default_configuration["dump_keyframe_interval"]                     = "0";
 	m_default_configuration["extrathreads"]                               = "2";
 	m_default_configuration["extrathreads_height"]                        = "4";
+	m_default_configuration["extrathreads_steal"]                         = "0";
+	m_default_configuration["extrathreads_tiled"]                         = "0";
 	m_default_configuration["filter"]                                     = std::to_string(static_cast<int8>(BiFiltering::PS2));
 	m_default_configuration["force_texture_clear"]                        = "0";
 	m_default_configuration["fxaa"]                                       = "0";
 	m_default_configuration["interlace"]                                  = "7";
 	m_default_configuration["conservative_framebuffer"]                   = "1";
+	m_default_configuration["jit_warmup_sw"]                              = "1";
 	m_default_configuration["linear_present"]                             = "1";
 	m_default_configuration["MaxAnisotropy"]                              = "0";
 	m_default_configuration["mipmap"]                                     = "1";
@@ -1671,6 +1972,9 @@ void GSApp::Init()
 	m_default_configuration["png_compression_level"]                      = std::to_string(Z_BEST_SPEED);
 	m_default_configuration["preload_frame_with_gs_data"]                 = "0";
 	m_default_configuration["Renderer"]                                   = std::to_string(static_cast<int>(GSRendererType::Default));
+	m_default_configuration["replay_first_frame"]                         = "0";
+	m_default_configuration["replay_frames"]                              = "0";
+	m_default_configuration["replay_hw"]                                  = "0";
 	m_default_configuration["resx"]                                       = "1024";
 	m_default_configuration["resy"]                                       = "1024";
 	m_default_configuration["save"]                                       = "0";
@@ -1686,6 +1990,7 @@ void GSApp::Init()
 	m_default_configuration["shaderfx"]                                   = "0";
 	m_default_configuration["shaderfx_conf"]                              = "shaders/GS_FX_Settings.ini";
 	m_default_configuration["shaderfx_glsl"]                              = "shaders/GS.fx";
+	m_default_configuration["texture_hash_cache"]                         = "0";
 	m_default_configuration["TVShader"]                                   = "0";
 	m_default_configuration["upscale_multiplier"]                         = "1";
 	m_default_configuration["UserHacks"]                                  = "0";
@@ -1784,6 +2089,15 @@ void GSApp::SetConfigDir()
 	m_ini = GetSettingsFolder().Combine(iniName).GetFullPath();
 }
 
+std::string GSApp::GetCachePath(const std::string& name)
+{
+	// created on first use, most sessions never write to it
+	wxDirName dir = GetSettingsFolder() + wxDirName(L"GS_cache");
+	dir.Mkdir();
+
+	return (dir + name.c_str()).GetFullPath().ToStdString();
+}
+
 std::string GSApp::GetConfigS(const char* entry)
 {
 	char buff[4096] = {0};
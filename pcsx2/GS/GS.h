@@ -1840,6 +1840,7 @@ void GSgetTitleInfo2(char* dest, size_t length);
 void GSsetFrameSkip(int frameskip);
 void GSsetVsync(int vsync);
 void GSsetExclusive(int enabled);
+void GSReplayBenchmark(char* lpszCmdLine, int loops, int threads, const char* report);
 
 class GSApp
 {
@@ -1891,6 +1892,7 @@ public:
 	GSRendererType GetCurrentRendererType() const;
 
 	void SetConfigDir();
+	std::string GetCachePath(const std::string& name);
 
 	std::vector<GSSetting> m_gs_renderers;
 	std::vector<GSSetting> m_gs_interlace;
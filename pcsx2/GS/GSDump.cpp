@@ -107,65 +107,174 @@ void GSDump::AppendRawData(uint8 c)
 	Write(&c, 1);
 }
 
+//////////////////////////////////////////////////////////////////////
+// GSDumpQueue implementation
+//////////////////////////////////////////////////////////////////////
+
+GSDumpQueue::GSDumpQueue()
+	: m_queued_size(0)
+	, m_exit(false)
+{
+}
+
+GSDumpQueue::~GSDumpQueue()
+{
+	Stop();
+}
+
+void GSDumpQueue::Start(Consumer consumer)
+{
+	m_consumer = std::move(consumer);
+	m_exit = false;
+	m_thread = std::thread(&GSDumpQueue::ThreadProc, this);
+}
+
+void GSDumpQueue::Push(std::vector<uint8>&& buff, int chunk_frame)
+{
+	{
+		std::unique_lock<std::mutex> l(m_lock);
+
+		// Only wait when the compressor is really late, memory use would grow
+		// without limit otherwise
+		while (m_queued_size > 256 * 1024 * 1024)
+			m_notfull.wait(l);
+
+		m_queued_size += buff.size();
+		m_queue.push(Entry{std::move(buff), chunk_frame});
+	}
+	m_notempty.notify_one();
+}
+
+void GSDumpQueue::Stop()
+{
+	if (!m_thread.joinable())
+		return;
+
+	{
+		std::lock_guard<std::mutex> l(m_lock);
+		m_exit = true;
+	}
+	m_notempty.notify_one();
+
+	m_thread.join();
+}
+
+void GSDumpQueue::ThreadProc()
+{
+	std::unique_lock<std::mutex> l(m_lock);
+
+	while (true)
+	{
+		while (m_queue.empty() && !m_exit)
+			m_notempty.wait(l);
+
+		if (m_queue.empty())
+			break;
+
+		Entry entry = std::move(m_queue.front());
+		m_queue.pop();
+
+		l.unlock();
+
+		m_consumer(entry.buff, entry.chunk_frame);
+
+		l.lock();
+
+		m_queued_size -= entry.buff.size();
+		m_notfull.notify_one();
+	}
+}
+
 //////////////////////////////////////////////////////////////////////
 // GSDumpXz implementation
 //////////////////////////////////////////////////////////////////////
 
 GSDumpXz::GSDumpXz(const std::string& fn, uint32 crc, const freezeData& fd, const GSPrivRegSet* regs)
 	: GSDumpBase(fn + ".gs.xz")
+	, m_failed(false)
 {
 	m_strm = LZMA_STREAM_INIT;
-	lzma_ret ret = lzma_easy_encoder(&m_strm, 6 /*level*/, LZMA_CHECK_CRC64);
+
+	// The multithreaded encoder splits the stream in independent blocks, the
+	// output is still a single regular xz stream that GSDumpLzma can read.
+	lzma_mt mt;
+	memset(&mt, 0, sizeof(mt));
+	mt.threads = std::min(std::max(std::thread::hardware_concurrency() / 2, 1u), 8u);
+	mt.block_size = 8 * 1024 * 1024;
+	mt.preset = 6 /*level*/;
+	mt.check = LZMA_CHECK_CRC64;
+
+	lzma_ret ret = lzma_stream_encoder_mt(&m_strm, &mt);
+	if (ret != LZMA_OK)
+	{
+		fprintf(stderr, "GSDumpXz: multithreaded encoder unavailable (error code %u), using a single thread\n", ret);
+		ret = lzma_easy_encoder(&m_strm, 6 /*level*/, LZMA_CHECK_CRC64);
+	}
+
 	if (ret != LZMA_OK)
 	{
 		fprintf(stderr, "GSDumpXz: Error initializing LZMA encoder ! (error code %u)\n", ret);
+		m_failed = true;
 		return;
 	}
 
+	m_queue.Start([this](const std::vector<uint8>& buff, int) {
+		m_strm.next_in = buff.data();
+		m_strm.avail_in = buff.size();
+
+		Compress(LZMA_RUN, LZMA_OK);
+	});
+
 	AddHeader(crc, fd, regs);
 }
 
 GSDumpXz::~GSDumpXz()
 {
-	Flush();
+	if (m_queue.IsRunning())
+	{
+		Flush();
+
+		m_queue.Stop();
 
-	// Finish the stream
-	m_strm.avail_in = 0;
-	Compress(LZMA_FINISH, LZMA_STREAM_END);
+		// Finish the stream
+		m_strm.avail_in = 0;
+		Compress(LZMA_FINISH, LZMA_STREAM_END);
+	}
 
 	lzma_end(&m_strm);
 }
 
 void GSDumpXz::AppendRawData(const void* data, size_t size)
 {
+	if (m_failed)
+		return;
+
 	size_t old_size = m_in_buff.size();
 	m_in_buff.resize(old_size + size);
 	memcpy(&m_in_buff[old_size], data, size);
 
-	// Enough data was accumulated, time to write/compress it.  If compression
-	// is enabled, it will freeze PCSX2. 1GB should be enough for long dump.
-	//
-	// Note: long dumps are currently not supported so this path won't be executed
-	if (m_in_buff.size() > 1024 * 1024 * 1024)
+	// Enough data was accumulated, hand it over to the compression thread
+	if (m_in_buff.size() > 4 * 1024 * 1024)
 		Flush();
 }
 
 void GSDumpXz::AppendRawData(uint8 c)
 {
+	if (m_failed)
+		return;
+
 	m_in_buff.push_back(c);
 }
 
 void GSDumpXz::Flush()
 {
-	if (m_in_buff.empty())
+	if (m_failed || m_in_buff.empty())
 		return;
 
-	m_strm.next_in = m_in_buff.data();
-	m_strm.avail_in = m_in_buff.size();
+	m_queue.Push(std::move(m_in_buff));
 
-	Compress(LZMA_RUN, LZMA_OK);
-
-	m_in_buff.clear();
+	m_in_buff = std::vector<uint8>();
+	m_in_buff.reserve(4 * 1024 * 1024 + 0x4000);
 }
 
 void GSDumpXz::Compress(lzma_action action, lzma_ret expected_status)
@@ -178,7 +287,8 @@ void GSDumpXz::Compress(lzma_action action, lzma_ret expected_status)
 
 		lzma_ret ret = lzma_code(&m_strm, action);
 
-		if (ret != expected_status)
+		// LZMA_OK only means that more output is pending when finishing
+		if (ret != expected_status && !(ret == LZMA_OK && m_strm.avail_out == 0))
 		{
 			fprintf(stderr, "GSDumpXz: Error %d\n", (int)ret);
 			return;
@@ -187,5 +297,195 @@ void GSDumpXz::Compress(lzma_action action, lzma_ret expected_status)
 		size_t write_size = out_buff.size() - m_strm.avail_out;
 		Write(out_buff.data(), write_size);
 
-	} while (m_strm.avail_out == 0);
+		if (ret == LZMA_STREAM_END)
+			break;
+
+	} while (m_strm.avail_out == 0 || m_strm.avail_in > 0);
+}
+
+//////////////////////////////////////////////////////////////////////
+// GSDumpIndexed implementation
+//////////////////////////////////////////////////////////////////////
+
+GSDumpIndexed::GSDumpIndexed(const std::string& fn, uint32 crc, const freezeData& fd, const GSPrivRegSet* regs, int keyframe_interval)
+	: GSDumpBase(fn + ".gsi")
+	, m_keyframe_interval(std::max(keyframe_interval, 1))
+	, m_chunk_frame(0)
+	, m_offset(0)
+	, m_chunk_open(false)
+	, m_chunk_failed(false)
+	, m_chunk_size(0)
+{
+	m_strm = LZMA_STREAM_INIT;
+
+	uint32 magic = GSDUMP_INDEXED_MAGIC;
+	uint32 version = GSDUMP_INDEXED_VERSION;
+
+	Put(&magic, 4);
+	Put(&version, 4);
+
+	// From here on the file belongs to the compression thread until it is stopped
+	m_queue.Start([this](const std::vector<uint8>& buff, int chunk_frame) {
+		CompressChunk(buff, chunk_frame);
+	});
+
+	AddHeader(crc, fd, regs);
+}
+
+GSDumpIndexed::~GSDumpIndexed()
+{
+	Flush(m_chunk_frame);
+
+	m_queue.Stop();
+
+	uint64 index_offset = m_offset;
+	uint32 count = m_index.size();
+
+	Put(&count, 4);
+
+	for (const auto& entry : m_index)
+	{
+		Put(&entry.first, 4);
+		Put(&entry.second, 8);
+	}
+
+	uint32 magic = GSDUMP_INDEXED_MAGIC;
+
+	Put(&index_offset, 8);
+	Put(&magic, 4);
+}
+
+void GSDumpIndexed::Put(const void* data, size_t size)
+{
+	Write(data, size);
+	m_offset += size;
+}
+
+void GSDumpIndexed::AppendRawData(const void* data, size_t size)
+{
+	size_t old_size = m_in_buff.size();
+	m_in_buff.resize(old_size + size);
+	memcpy(&m_in_buff[old_size], data, size);
+
+	// Enough data was accumulated, hand it over to the compression thread
+	if (m_in_buff.size() > 4 * 1024 * 1024)
+		Flush();
+}
+
+void GSDumpIndexed::AppendRawData(uint8 c)
+{
+	m_in_buff.push_back(c);
+}
+
+bool GSDumpIndexed::NeedsKeyframe() const
+{
+	return GetFrames() - m_chunk_frame >= m_keyframe_interval;
+}
+
+void GSDumpIndexed::AddKeyframe(uint32 crc, const freezeData& fd, const GSPrivRegSet* regs)
+{
+	Flush(m_chunk_frame);
+
+	m_chunk_frame = GetFrames();
+
+	// Every chunk starts with a full header so it can be replayed on its own
+	AddHeader(crc, fd, regs);
+}
+
+void GSDumpIndexed::Flush(int chunk_frame)
+{
+	// The end of a chunk is queued even without data, it closes the stream
+	if (m_in_buff.empty() && chunk_frame < 0)
+		return;
+
+	m_queue.Push(std::move(m_in_buff), chunk_frame);
+
+	m_in_buff = std::vector<uint8>();
+	m_in_buff.reserve(4 * 1024 * 1024 + 0x4000);
+}
+
+void GSDumpIndexed::CompressChunk(const std::vector<uint8>& buff, int chunk_frame)
+{
+	if (!m_chunk_open)
+	{
+		m_chunk_open = true;
+		m_chunk_failed = false;
+		m_chunk_size = 0;
+		m_out_buff.clear();
+
+		m_strm = LZMA_STREAM_INIT;
+
+		lzma_ret ret = lzma_easy_encoder(&m_strm, 6 /*level*/, LZMA_CHECK_CRC64);
+		if (ret != LZMA_OK)
+		{
+			fprintf(stderr, "GSDumpIndexed: Error initializing LZMA encoder ! (error code %u)\n", ret);
+			m_chunk_failed = true;
+		}
+	}
+
+	if (!m_chunk_failed && !buff.empty())
+	{
+		m_strm.next_in = buff.data();
+		m_strm.avail_in = buff.size();
+		m_chunk_size += buff.size();
+
+		m_chunk_failed = !Compress(LZMA_RUN, LZMA_OK);
+	}
+
+	if (chunk_frame < 0)
+		return;
+
+	// The chunk is complete, finish its stream and write it out
+	if (!m_chunk_failed)
+	{
+		m_strm.avail_in = 0;
+		m_chunk_failed = !Compress(LZMA_FINISH, LZMA_STREAM_END);
+	}
+
+	lzma_end(&m_strm);
+	m_chunk_open = false;
+
+	// A failed chunk is left out, the index only references complete ones
+	if (m_chunk_failed || m_chunk_size == 0)
+		return;
+
+	m_index.push_back(std::make_pair((uint32)chunk_frame, m_offset));
+
+	uint32 frame = chunk_frame;
+	uint64 size = m_chunk_size;
+	uint64 compressed_size = m_out_buff.size();
+
+	Put(&frame, 4);
+	Put(&size, 8);
+	Put(&compressed_size, 8);
+	Put(m_out_buff.data(), m_out_buff.size());
+}
+
+bool GSDumpIndexed::Compress(lzma_action action, lzma_ret expected_status)
+{
+	do
+	{
+		size_t old_size = m_out_buff.size();
+		m_out_buff.resize(old_size + 1024 * 1024);
+
+		m_strm.next_out = &m_out_buff[old_size];
+		m_strm.avail_out = 1024 * 1024;
+
+		lzma_ret ret = lzma_code(&m_strm, action);
+
+		m_out_buff.resize(m_out_buff.size() - m_strm.avail_out);
+
+		// LZMA_OK only means that more output is pending when finishing
+		if (ret != expected_status && !(ret == LZMA_OK && m_strm.avail_out == 0))
+		{
+			fprintf(stderr, "GSDumpIndexed: Error %d\n", (int)ret);
+			return false;
+		}
+
+		if (ret == LZMA_STREAM_END)
+			break;
+
+	} while (m_strm.avail_out == 0 || m_strm.avail_in > 0);
+
+	return true;
 }
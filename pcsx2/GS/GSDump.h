@@ -36,8 +36,20 @@ ReadFIFO2 data (id == 2)
 Regs data (id == 3)
 - [PMODE/0x2000]
 
+Indexed dump file format (.gsi):
+- [magic/4] [version/4] [chunk] .. [chunk] [index] [index offset/8] [magic/4]
+
+Chunk, an independent xz stream that decompresses to a regular dump starting at a keyframe
+- [first frame/4] [uncompressed size/8] [compressed size/8] [xz data/compressed size]
+
+Index
+- [count/4] [first frame/4] [chunk offset/8] .. [first frame/4] [chunk offset/8]
+
 */
 
+#define GSDUMP_INDEXED_MAGIC 0x49445347 // "GSDI"
+#define GSDUMP_INDEXED_VERSION 2
+
 class GSDumpBase
 {
 	int m_frames;
@@ -47,6 +59,7 @@ class GSDumpBase
 protected:
 	void AddHeader(uint32 crc, const freezeData& fd, const GSPrivRegSet* regs);
 	void Write(const void* data, size_t size);
+	int GetFrames() const { return m_frames; }
 
 	virtual void AppendRawData(const void* data, size_t size) = 0;
 	virtual void AppendRawData(uint8 c) = 0;
@@ -58,6 +71,9 @@ public:
 	void ReadFIFO(uint32 size);
 	void Transfer(int index, const uint8* mem, size_t size);
 	bool VSync(int field, bool last, const GSPrivRegSet* regs);
+
+	virtual bool NeedsKeyframe() const { return false; }
+	virtual void AddKeyframe(uint32 crc, const freezeData& fd, const GSPrivRegSet* regs) {}
 };
 
 class GSDump final : public GSDumpBase
@@ -70,11 +86,49 @@ public:
 	virtual ~GSDump() = default;
 };
 
+// Filled buffers are handed over to a compression thread, the emulation side
+// only copies data. A buffer can close a chunk of an indexed dump, the consumer
+// then also gets the first frame of that chunk (-1 otherwise).
+class GSDumpQueue
+{
+public:
+	using Consumer = std::function<void(const std::vector<uint8>& buff, int chunk_frame)>;
+
+private:
+	struct Entry
+	{
+		std::vector<uint8> buff;
+		int chunk_frame;
+	};
+
+	Consumer m_consumer;
+	std::queue<Entry> m_queue;
+	size_t m_queued_size;
+	bool m_exit;
+	std::mutex m_lock;
+	std::condition_variable m_notempty;
+	std::condition_variable m_notfull;
+	std::thread m_thread;
+
+	void ThreadProc();
+
+public:
+	GSDumpQueue();
+	~GSDumpQueue();
+
+	void Start(Consumer consumer);
+	void Push(std::vector<uint8>&& buff, int chunk_frame = -1);
+	void Stop(); // Consumes what is left and joins the thread
+	bool IsRunning() const { return m_thread.joinable(); }
+};
+
 class GSDumpXz final : public GSDumpBase
 {
 	lzma_stream m_strm;
 
 	std::vector<uint8> m_in_buff;
+	GSDumpQueue m_queue;
+	bool m_failed; // No encoder, data is dropped
 
 	void Flush();
 	void Compress(lzma_action action, lzma_ret expected_status);
@@ -85,3 +139,35 @@ public:
 	GSDumpXz(const std::string& fn, uint32 crc, const freezeData& fd, const GSPrivRegSet* regs);
 	virtual ~GSDumpXz();
 };
+
+class GSDumpIndexed final : public GSDumpBase
+{
+	int m_keyframe_interval;
+	int m_chunk_frame;
+	uint64 m_offset;
+	std::vector<uint8> m_in_buff;
+	GSDumpQueue m_queue;
+
+	// Compression thread side, every chunk is its own xz stream. Only the
+	// compressed data is kept until the chunk is complete and its sizes known.
+	lzma_stream m_strm;
+	bool m_chunk_open;
+	bool m_chunk_failed;
+	uint64 m_chunk_size;
+	std::vector<uint8> m_out_buff;
+	std::vector<std::pair<uint32, uint64>> m_index;
+
+	void Flush(int chunk_frame = -1);
+	void CompressChunk(const std::vector<uint8>& buff, int chunk_frame);
+	bool Compress(lzma_action action, lzma_ret expected_status);
+	void Put(const void* data, size_t size);
+	void AppendRawData(const void* data, size_t size) final;
+	void AppendRawData(uint8 c) final;
+
+public:
+	GSDumpIndexed(const std::string& fn, uint32 crc, const freezeData& fd, const GSPrivRegSet* regs, int keyframe_interval);
+	virtual ~GSDumpIndexed();
+
+	bool NeedsKeyframe() const final;
+	void AddKeyframe(uint32 crc, const freezeData& fd, const GSPrivRegSet* regs) final;
+};
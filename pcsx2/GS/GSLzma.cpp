@@ -15,6 +15,13 @@
 
 #include "PrecompiledHeader.h"
 #include "GSLzma.h"
+#include "GSDump.h"
+
+#ifdef _WIN32
+#define gs_fseek64 _fseeki64
+#else
+#define gs_fseek64 fseeko
+#endif
 
 GSDumpFile::GSDumpFile(char* filename, const char* repack_filename)
 {
@@ -52,6 +59,60 @@ GSDumpFile::~GSDumpFile()
 		fclose(m_repack_fp);
 }
 
+bool GSDumpFile::ReadPacket(GSDumpPacket& p)
+{
+	if (!Read(&p.type, 1))
+		return false;
+
+	p.param = 0;
+	p.size = 0;
+	p.addr = 0;
+
+	// Note: resize keeps the capacity so a recycled packet doesn't reallocate
+	switch (p.type)
+	{
+		case 0:
+			Read(&p.param, 1);
+			Read(&p.size, 4);
+
+			switch (p.param)
+			{
+				case 0:
+					p.buff.resize(0x4000);
+					p.addr = 0x4000 - p.size;
+					Read(&p.buff[p.addr], p.size);
+					break;
+				case 1:
+				case 2:
+				case 3:
+					p.buff.resize(p.size);
+					Read(&p.buff[0], p.size);
+					break;
+			}
+
+			break;
+
+		case 1:
+			Read(&p.param, 1);
+
+			break;
+
+		case 2:
+			Read(&p.size, 4);
+
+			break;
+
+		case 3:
+			p.buff.resize(0x2000);
+
+			Read(&p.buff[0], 0x2000);
+
+			break;
+	}
+
+	return true;
+}
+
 /******************************************************************/
 GSDumpLzma::GSDumpLzma(char* filename, const char* repack_filename)
 	: GSDumpFile(filename, repack_filename)
@@ -195,3 +256,250 @@ bool GSDumpRaw::Read(void* ptr, size_t size)
 
 	return false;
 }
+
+/******************************************************************/
+
+GSDumpIndexedFile::GSDumpIndexedFile(char* filename, const char* repack_filename)
+	: GSDumpFile(filename, repack_filename)
+	, m_next_chunk(0)
+	, m_start(0)
+{
+	uint32 magic = 0, version = 0;
+	uint64 index_offset = 0;
+
+	if (fread(&magic, 4, 1, m_fp) != 1 || fread(&version, 4, 1, m_fp) != 1 || magic != GSDUMP_INDEXED_MAGIC || version != GSDUMP_INDEXED_VERSION)
+	{
+		fprintf(stderr, "GSDumpIndexedFile: %s isn't an indexed dump\n", filename);
+		throw "BAD"; // Just exit the program
+	}
+
+	if (gs_fseek64(m_fp, -12, SEEK_END) != 0 || fread(&index_offset, 8, 1, m_fp) != 1 || fread(&magic, 4, 1, m_fp) != 1 || magic != GSDUMP_INDEXED_MAGIC)
+	{
+		fprintf(stderr, "GSDumpIndexedFile: %s has no index, the capture was probably interrupted\n", filename);
+		throw "BAD"; // Just exit the program
+	}
+
+	uint32 count = 0;
+
+	if (gs_fseek64(m_fp, index_offset, SEEK_SET) != 0 || fread(&count, 4, 1, m_fp) != 1)
+	{
+		fprintf(stderr, "GSDumpIndexedFile: failed to read the index of %s\n", filename);
+		throw "BAD"; // Just exit the program
+	}
+
+	m_index.resize(count);
+
+	for (auto& chunk : m_index)
+	{
+		if (fread(&chunk.frame, 4, 1, m_fp) != 1 || fread(&chunk.offset, 8, 1, m_fp) != 1)
+		{
+			fprintf(stderr, "GSDumpIndexedFile: failed to read the index of %s\n", filename);
+			throw "BAD"; // Just exit the program
+		}
+	}
+
+	if (!m_index.empty())
+		LoadChunk(0, false);
+}
+
+void GSDumpIndexedFile::LoadChunk(size_t i, bool skip_header)
+{
+	uint32 frame;
+	uint64 size, compressed_size;
+
+	if (gs_fseek64(m_fp, m_index[i].offset, SEEK_SET) != 0
+		|| fread(&frame, 4, 1, m_fp) != 1 || fread(&size, 8, 1, m_fp) != 1 || fread(&compressed_size, 8, 1, m_fp) != 1)
+	{
+		fprintf(stderr, "GSDumpIndexedFile: Read error: %s\n", strerror(errno));
+		throw "BAD"; // Just exit the program
+	}
+
+	if ((size_t)size != size || (size_t)compressed_size != compressed_size)
+	{
+		fprintf(stderr, "GSDumpIndexedFile: chunk %zu is too large for this build\n", i);
+		throw "BAD"; // Just exit the program
+	}
+
+	m_inbuf.resize(compressed_size);
+	m_area.resize(size);
+
+	if (fread(m_inbuf.data(), 1, compressed_size, m_fp) != compressed_size)
+	{
+		fprintf(stderr, "GSDumpIndexedFile: Read error: %s\n", strerror(errno));
+		throw "BAD"; // Just exit the program
+	}
+
+	uint64 memlimit = UINT64_MAX;
+	size_t in_pos = 0;
+	size_t out_pos = 0;
+
+	lzma_ret ret = lzma_stream_buffer_decode(&memlimit, 0, nullptr, m_inbuf.data(), &in_pos, compressed_size, m_area.data(), &out_pos, size);
+
+	if (ret != LZMA_OK || out_pos != size)
+	{
+		fprintf(stderr, "Decoder error: (error code %u)\n", ret);
+		throw "BAD"; // Just exit the program
+	}
+
+	m_start = 0;
+	m_next_chunk = i + 1;
+
+	// When playing through, the keyframe at the start of the chunk is redundant:
+	// skip [crc/4] [state size/4] [state data/size] [PMODE/0x2000]
+	if (skip_header)
+	{
+		uint32 state_size;
+		memcpy(&state_size, &m_area[4], 4);
+
+		m_start = std::min<size_t>(8 + state_size + 0x2000, m_area.size());
+	}
+}
+
+uint32 GSDumpIndexedFile::Seek(uint32 frame)
+{
+	if (m_index.empty())
+		return 0;
+
+	auto it = std::upper_bound(m_index.begin(), m_index.end(), frame,
+		[](uint32 f, const Chunk& chunk) { return f < chunk.frame; });
+
+	size_t i = it == m_index.begin() ? 0 : (it - m_index.begin()) - 1;
+
+	LoadChunk(i, false);
+
+	return m_index[i].frame;
+}
+
+bool GSDumpIndexedFile::IsEof()
+{
+	return m_start == m_area.size() && m_next_chunk >= m_index.size();
+}
+
+bool GSDumpIndexedFile::Read(void* ptr, size_t size)
+{
+	size_t off = 0;
+	uint8_t* dst = (uint8_t*)ptr;
+	size_t full_size = size;
+	while (size && !IsEof())
+	{
+		if (m_start == m_area.size())
+		{
+			LoadChunk(m_next_chunk, true);
+		}
+
+		size_t l = std::min(size, m_area.size() - m_start);
+		memcpy(dst + off, &m_area[m_start], l);
+		size    -= l;
+		m_start += l;
+		off     += l;
+	}
+
+	if (size == 0)
+	{
+		Repack(ptr, full_size);
+		return true;
+	}
+
+	return false;
+}
+
+/******************************************************************/
+
+GSDumpStream::GSDumpStream(GSDumpFile* file, size_t capacity, long max_frames)
+	: m_file(file)
+	, m_ring(std::max<size_t>(capacity, 2))
+	, m_head(0)
+	, m_tail(0)
+	, m_count(0)
+	, m_frames(0)
+	, m_max_frames(max_frames)
+	, m_eof(false)
+	, m_exit(false)
+{
+	m_thread = std::thread(&GSDumpStream::ThreadProc, this);
+}
+
+GSDumpStream::~GSDumpStream()
+{
+	{
+		std::lock_guard<std::mutex> l(m_lock);
+		m_exit = true;
+	}
+	m_notfull.notify_one();
+
+	m_thread.join();
+}
+
+void GSDumpStream::ThreadProc()
+{
+	while (true)
+	{
+		size_t slot;
+
+		{
+			std::unique_lock<std::mutex> l(m_lock);
+
+			while (m_count == m_ring.size() && !m_exit)
+				m_notfull.wait(l);
+
+			if (m_exit)
+				return;
+
+			slot = m_tail;
+		}
+
+		// The slot is owned by this thread until m_count is incremented
+		bool valid;
+
+		try
+		{
+			valid = m_file->ReadPacket(m_ring[slot]);
+		}
+		catch (...)
+		{
+			// Corrupted stream, replay whatever was decoded so far
+			valid = false;
+		}
+
+		bool last = !valid || (m_ring[slot].type == 1 && m_max_frames > 0 && ++m_frames >= m_max_frames);
+
+		{
+			std::lock_guard<std::mutex> l(m_lock);
+
+			if (valid)
+			{
+				m_tail = (m_tail + 1) % m_ring.size();
+				m_count++;
+			}
+
+			m_eof = last;
+		}
+		m_notempty.notify_one();
+
+		if (last)
+			return;
+	}
+}
+
+const GSDumpPacket* GSDumpStream::Front()
+{
+	std::unique_lock<std::mutex> l(m_lock);
+
+	while (m_count == 0 && !m_eof)
+		m_notempty.wait(l);
+
+	return m_count > 0 ? &m_ring[m_head] : nullptr;
+}
+
+void GSDumpStream::Pop()
+{
+	{
+		std::lock_guard<std::mutex> l(m_lock);
+
+		ASSERT(m_count > 0);
+
+		m_head = (m_head + 1) % m_ring.size();
+		m_count--;
+	}
+	m_notfull.notify_one();
+}
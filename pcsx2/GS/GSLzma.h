@@ -15,6 +15,13 @@
 
 #include <lzma.h>
 
+struct GSDumpPacket
+{
+	uint8 type, param;
+	uint32 size, addr;
+	std::vector<uint8> buff;
+};
+
 class GSDumpFile
 {
 	FILE* m_repack_fp;
@@ -28,6 +35,8 @@ public:
 	virtual bool IsEof() = 0;
 	virtual bool Read(void* ptr, size_t size) = 0;
 
+	bool ReadPacket(GSDumpPacket& p);
+
 	GSDumpFile(char* filename, const char* repack_filename);
 	virtual ~GSDumpFile();
 };
@@ -69,3 +78,67 @@ public:
 	bool IsEof() final;
 	bool Read(void* ptr, size_t size) final;
 };
+
+// Reader for the indexed dump format written by GSDumpIndexed. Every chunk is
+// decompressed on its own, so Seek() only decodes the chunk holding the keyframe.
+class GSDumpIndexedFile : public GSDumpFile
+{
+	struct Chunk
+	{
+		uint32 frame;
+		uint64 offset;
+	};
+
+	std::vector<Chunk> m_index;
+	size_t m_next_chunk;
+
+	std::vector<uint8_t> m_inbuf;
+	std::vector<uint8_t> m_area;
+	size_t m_start;
+
+	void LoadChunk(size_t i, bool skip_header);
+
+public:
+	GSDumpIndexedFile(char* filename, const char* repack_filename);
+	virtual ~GSDumpIndexedFile() = default;
+
+	// Moves to the last keyframe at or before frame and returns its frame
+	// number. The dump header is read again from there.
+	uint32 Seek(uint32 frame);
+
+	bool IsEof() final;
+	bool Read(void* ptr, size_t size) final;
+};
+
+// Decodes the packets of a dump on a worker thread into a bounded ring, so the
+// replay can start on the first frame and memory use doesn't depend on the dump
+// size. Packet buffers are recycled once the consumer pops them.
+class GSDumpStream
+{
+	std::unique_ptr<GSDumpFile> m_file;
+	std::vector<GSDumpPacket> m_ring;
+	size_t m_head;
+	size_t m_tail;
+	size_t m_count;
+	long m_frames;
+	long m_max_frames;
+	bool m_eof;
+	bool m_exit;
+
+	std::mutex m_lock;
+	std::condition_variable m_notempty;
+	std::condition_variable m_notfull;
+	std::thread m_thread;
+
+	void ThreadProc();
+
+public:
+	// Takes ownership of file, the dump header must already have been read.
+	// Decoding stops after max_frames vsyncs when it isn't 0.
+	GSDumpStream(GSDumpFile* file, size_t capacity, long max_frames = 0);
+	~GSDumpStream();
+
+	// Blocks until the next packet is decoded, returns nullptr at the end of the dump
+	const GSDumpPacket* Front();
+	void Pop();
+};
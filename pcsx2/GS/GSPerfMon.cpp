@@ -26,6 +26,15 @@ GSPerfMon::GSPerfMon()
 	memset(m_stats, 0, sizeof(m_stats));
 	memset(m_total, 0, sizeof(m_total));
 	memset(m_begin, 0, sizeof(m_begin));
+	memset(m_start, 0, sizeof(m_start));
+
+	ResetTotals();
+}
+
+void GSPerfMon::ResetTotals()
+{
+	memset(m_totals, 0, sizeof(m_totals));
+	memset(m_ticks, 0, sizeof(m_ticks));
 }
 
 void GSPerfMon::Put(counter_t c, double val)
@@ -51,10 +60,12 @@ void GSPerfMon::Put(counter_t c, double val)
 		m_lastframe = now;
 		m_frame++;
 		m_count++;
+		m_totals[c] += 1;
 	}
 	else
 	{
 		m_counters[c] += val;
+		m_totals[c] += val;
 	}
 #endif
 }
@@ -93,7 +104,9 @@ void GSPerfMon::Stop(int timer)
 #ifndef DISABLE_PERF_MON
 	if (m_start[timer] > 0)
 	{
-		m_total[timer] += __rdtsc() - m_start[timer];
+		uint64 ticks = __rdtsc() - m_start[timer];
+		m_total[timer] += ticks;
+		m_ticks[timer] += ticks;
 		m_start[timer] = 0;
 	}
 #endif
@@ -26,9 +26,13 @@ public:
 		Sync,
 		WorkerDraw0, WorkerDraw1, WorkerDraw2, WorkerDraw3, WorkerDraw4, WorkerDraw5, WorkerDraw6, WorkerDraw7,
 		WorkerDraw8, WorkerDraw9, WorkerDraw10, WorkerDraw11, WorkerDraw12, WorkerDraw13, WorkerDraw14, WorkerDraw15,
+		WorkerDraw16, WorkerDraw17, WorkerDraw18, WorkerDraw19, WorkerDraw20, WorkerDraw21, WorkerDraw22, WorkerDraw23,
+		WorkerDraw24, WorkerDraw25, WorkerDraw26, WorkerDraw27, WorkerDraw28, WorkerDraw29, WorkerDraw30, WorkerDraw31,
 		TimerLast,
 	};
 
+	static const int WorkerDrawCount = WorkerDraw31 - WorkerDraw0 + 1;
+
 	enum counter_t
 	{
 		Frame,
@@ -39,13 +43,20 @@ public:
 		Fillrate,
 		Quad,
 		SyncPoint,
+		Steal,
+		PageWait,
+		TextureHashHit,
+		TextureHashMiss,
+		TextureUpload, // bytes sent to the device by the HW texture cache
 		CounterLast,
 	};
 
 protected:
 	double m_counters[CounterLast];
 	double m_stats[CounterLast];
+	double m_totals[CounterLast]; // never reset by Update(), used by the replay benchmark
 	uint64 m_begin[TimerLast], m_total[TimerLast], m_start[TimerLast];
+	uint64 m_ticks[TimerLast]; // never reset by CPU()
 	uint64 m_frame;
 	clock_t m_lastframe;
 	int m_count;
@@ -60,6 +71,9 @@ public:
 
 	void Put(counter_t c, double val = 0);
 	double Get(counter_t c) { return m_stats[c]; }
+	double GetTotal(counter_t c) { return m_totals[c]; }
+	uint64 GetTicks(int timer) { return m_ticks[timer]; }
+	void ResetTotals();
 	void Update();
 
 	void Start(int timer = Main);
@@ -24,7 +24,9 @@ class GSJobQueue final
 private:
 	std::thread m_thread;
 	std::function<void(T&)> m_func;
+	std::function<bool()> m_idle; // called when the queue runs dry, returns true if it did some work
 	bool m_exit;
+	bool m_wake;
 	ringbuffer_base<T, CAPACITY> m_queue;
 
 	std::mutex m_lock;
@@ -44,6 +46,20 @@ private:
 				if (m_exit)
 					return;
 
+				if (m_idle)
+				{
+					m_wake = false;
+
+					l.unlock();
+
+					bool worked = m_idle();
+
+					l.lock();
+
+					if (worked || m_wake || m_exit || !m_queue.empty())
+						continue;
+				}
+
 				m_notempty.wait(l);
 			}
 
@@ -62,9 +78,11 @@ private:
 	}
 
 public:
-	GSJobQueue(std::function<void(T&)> func)
+	GSJobQueue(std::function<void(T&)> func, std::function<bool()> idle = nullptr)
 		: m_func(func)
+		, m_idle(idle)
 		, m_exit(false)
+		, m_wake(false)
 	{
 		m_thread = std::thread(&GSJobQueue::ThreadProc, this);
 	}
@@ -96,6 +114,16 @@ public:
 		m_notempty.notify_one();
 	}
 
+	// Gives an idle thread another look at its idle function.
+	void Wake()
+	{
+		{
+			std::lock_guard<std::mutex> l(m_lock);
+			m_wake = true;
+		}
+		m_notempty.notify_one();
+	}
+
 	void Wait()
 	{
 		if (IsEmpty())
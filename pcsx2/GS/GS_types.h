@@ -106,9 +106,9 @@ extern void vmfree(void* ptr, size_t size);
 #define ASSERT assert
 
 // sse
-#if defined(__GNUC__)
+#if defined(__GNUC__) && !defined(_M_SSE)
 
-	// Convert gcc see define into GS (windows) define
+	// Convert gcc see define into GS (windows) define, unless the build already picked the level
 	#if defined(__AVX2__)
 		#if defined(__x86_64__)
 			#define _M_SSE 0x500 // TODO
@@ -31,6 +31,7 @@ protected:
 		uint64 frame, frames;
 		uint64 ticks, actual, total;
 		VALUE f;
+		bool warm; // compiled ahead of its first use
 	};
 
 	std::unordered_map<KEY, VALUE> m_map;
@@ -39,6 +40,7 @@ protected:
 	ActivePtr* m_active;
 
 	virtual VALUE GetDefaultFunction(KEY key) = 0;
+	virtual bool IsPrepared(KEY key) { return false; }
 
 public:
 	GSFunctionMap()
@@ -72,6 +74,8 @@ public:
 
 			p->frame = (uint64)-1;
 
+			p->warm = IsPrepared(key);
+
 			p->f = i != m_map.end() ? i->second : GetDefaultFunction(key);
 
 			m_map_active[key] = p;
@@ -82,6 +86,12 @@ public:
 		return m_active->f;
 	}
 
+	// Whether the function of the last lookup was compiled ahead of time.
+	bool IsWarm() const
+	{
+		return m_active != NULL && m_active->warm;
+	}
+
 	void UpdateStats(uint64 frame, uint64 ticks, int actual, int total)
 	{
 		if (m_active)
@@ -158,9 +168,13 @@ class GSCodeGeneratorFunctionMap : public GSFunctionMap<KEY, VALUE>
 	std::unordered_map<uint64, VALUE> m_cgmap;
 	GSCodeBuffer m_cb;
 	size_t m_total_code_size;
+	std::mutex m_lock; // m_cgmap, m_cb and m_prepared, Prepare may run on another thread
+	std::unordered_set<uint64> m_prepared; // keys compiled by Prepare
 
 	enum { MAX_SIZE = 8192 };
 
+	VALUE Compile(KEY key);
+
 public:
 	GSCodeGeneratorFunctionMap(const char* name, void* param)
 		: m_name(name)
@@ -178,78 +192,115 @@ public:
 
 	VALUE GetDefaultFunction(KEY key)
 	{
-		VALUE ret = NULL;
+		std::lock_guard<std::mutex> l(m_lock);
 
 		auto i = m_cgmap.find(key);
 
 		if (i != m_cgmap.end())
 		{
-			ret = i->second;
+			return i->second;
 		}
-		else
+
+		return Compile(key);
+	}
+
+	bool IsPrepared(KEY key)
+	{
+		std::lock_guard<std::mutex> l(m_lock);
+
+		return m_prepared.find(key) != m_prepared.end();
+	}
+
+	// Compiles the function of a key ahead of its first draw, thread safe.
+
+	void Prepare(KEY key)
+	{
+		std::lock_guard<std::mutex> l(m_lock);
+
+		if (m_cgmap.find(key) == m_cgmap.end())
 		{
-			void* code_ptr = m_cb.GetBuffer(MAX_SIZE);
+			Compile(key);
 
-			CG* cg = new CG(m_param, key, code_ptr, MAX_SIZE);
-			ASSERT(cg->getSize() < MAX_SIZE);
+			m_prepared.insert(key);
+		}
+	}
+
+	// Keys used by the draws so far, only call it while the owner is not drawing.
+
+	void GetKeys(std::set<uint64>& keys) const
+	{
+		for (const auto& i : this->m_map_active)
+		{
+			keys.insert((uint64)i.first);
+		}
+	}
+};
+
+template <class CG, class KEY, class VALUE>
+VALUE GSCodeGeneratorFunctionMap<CG, KEY, VALUE>::Compile(KEY key)
+{
+	VALUE ret = NULL;
+
+	void* code_ptr = m_cb.GetBuffer(MAX_SIZE);
+
+	CG* cg = new CG(m_param, key, code_ptr, MAX_SIZE);
+	ASSERT(cg->getSize() < MAX_SIZE);
 
 #if 0
-			fprintf(stderr, "%s Location:%p Size:%zu Key:%llx\n", m_name.c_str(), code_ptr, cg->getSize(), (uint64)key);
-			GSScanlineSelector sel(key);
-			sel.Print();
+	fprintf(stderr, "%s Location:%p Size:%zu Key:%llx\n", m_name.c_str(), code_ptr, cg->getSize(), (uint64)key);
+	GSScanlineSelector sel(key);
+	sel.Print();
 #endif
 
-			m_total_code_size += cg->getSize();
+	m_total_code_size += cg->getSize();
 
-			m_cb.ReleaseBuffer(cg->getSize());
+	m_cb.ReleaseBuffer(cg->getSize());
 
-			ret = (VALUE)cg->getCode();
+	ret = (VALUE)cg->getCode();
 
-			m_cgmap[key] = ret;
+	m_cgmap[key] = ret;
 
 #ifdef ENABLE_VTUNE
 
-			// vtune method registration
+	// vtune method registration
 
-			// if(iJIT_IsProfilingActive()) // always > 0
-			{
-				std::string name = format("%s<%016llx>()", m_name.c_str(), (uint64)key);
+	// if(iJIT_IsProfilingActive()) // always > 0
+	{
+		std::string name = format("%s<%016llx>()", m_name.c_str(), (uint64)key);
 
-				iJIT_Method_Load ml;
+		iJIT_Method_Load ml;
 
-				memset(&ml, 0, sizeof(ml));
+		memset(&ml, 0, sizeof(ml));
 
-				ml.method_id = iJIT_GetNewMethodID();
-				ml.method_name = (char*)name.c_str();
-				ml.method_load_address = (void*)cg->getCode();
-				ml.method_size = (unsigned int)cg->getSize();
+		ml.method_id = iJIT_GetNewMethodID();
+		ml.method_name = (char*)name.c_str();
+		ml.method_load_address = (void*)cg->getCode();
+		ml.method_size = (unsigned int)cg->getSize();
 
-				iJIT_NotifyEvent(iJVM_EVENT_TYPE_METHOD_LOAD_FINISHED, &ml);
+		iJIT_NotifyEvent(iJVM_EVENT_TYPE_METHOD_LOAD_FINISHED, &ml);
 /*
-				name = format("c:/temp1/%s_%016llx.bin", m_name.c_str(), (uint64)key);
+		name = format("c:/temp1/%s_%016llx.bin", m_name.c_str(), (uint64)key);
 
-				if(FILE* fp = fopen(name.c_str(), "wb"))
-				{
-					fputc(0x0F, fp); fputc(0x0B, fp);
-					fputc(0xBB, fp); fputc(0x6F, fp); fputc(0x00, fp); fputc(0x00, fp); fputc(0x00, fp);
-					fputc(0x64, fp); fputc(0x67, fp); fputc(0x90, fp);
+		if(FILE* fp = fopen(name.c_str(), "wb"))
+		{
+			fputc(0x0F, fp); fputc(0x0B, fp);
+			fputc(0xBB, fp); fputc(0x6F, fp); fputc(0x00, fp); fputc(0x00, fp); fputc(0x00, fp);
+			fputc(0x64, fp); fputc(0x67, fp); fputc(0x90, fp);
 
-					fwrite(cg->getCode(), cg->getSize(), 1, fp);
+			fwrite(cg->getCode(), cg->getSize(), 1, fp);
 
-					fputc(0xBB, fp); fputc(0xDE, fp); fputc(0x00, fp); fputc(0x00, fp); fputc(0x00, fp);
-					fputc(0x64, fp); fputc(0x67, fp); fputc(0x90, fp);
-					fputc(0x0F, fp); fputc(0x0B, fp);
+			fputc(0xBB, fp); fputc(0xDE, fp); fputc(0x00, fp); fputc(0x00, fp); fputc(0x00, fp);
+			fputc(0x64, fp); fputc(0x67, fp); fputc(0x90, fp);
+			fputc(0x0F, fp); fputc(0x0B, fp);
 
-					fclose(fp);
-				}
+			fclose(fp);
+		}
 */
-			}
+	}
 
 #endif
 
-			delete cg;
-		}
+	delete cg;
 
-		return ret;
-	}
-};
+	return ret;
+}
@@ -352,7 +352,7 @@ void GSRenderer::VSync(int field)
 #ifdef GSTITLEINFO_API_FORCE_VERBOSE
 		if (1) //force verbose reply
 #else
-		if (m_wnd->IsManaged())
+		if (m_wnd && m_wnd->IsManaged())
 #endif
 		{
 			//GS owns the window's title, be verbose.
@@ -380,7 +380,7 @@ void GSRenderer::VSync(int field)
 
 				int sum = 0;
 
-				for (int i = 0; i < 16; i++)
+				for (int i = 0; i < GSPerfMon::WorkerDrawCount; i++)
 				{
 					sum += m_perfmon.CPU(GSPerfMon::WorkerDraw0 + i);
 				}
@@ -400,7 +400,7 @@ void GSRenderer::VSync(int field)
 			s += " | Recording...";
 		}
 
-		if (m_wnd->IsManaged())
+		if (m_wnd && m_wnd->IsManaged())
 		{
 			m_wnd->SetWindowText(s.c_str());
 		}
@@ -425,7 +425,9 @@ void GSRenderer::VSync(int field)
 		// so let's use actual OSD!
 	}
 
-	if (m_frameskip)
+	// Headless replay has nothing to present to
+
+	if (m_frameskip || !m_wnd)
 	{
 		return;
 	}
@@ -451,8 +453,12 @@ void GSRenderer::VSync(int field)
 			fd.data = new char[fd.size];
 			Freeze(&fd, false);
 
+			int keyframe_interval = theApp.GetConfigI("dump_keyframe_interval");
+
 			if (m_control_key)
 				m_dump = std::unique_ptr<GSDumpBase>(new GSDump(m_snapshot, m_crc, fd, m_regs));
+			else if (keyframe_interval > 0)
+				m_dump = std::unique_ptr<GSDumpBase>(new GSDumpIndexed(m_snapshot, m_crc, fd, m_regs, keyframe_interval));
 			else
 				m_dump = std::unique_ptr<GSDumpBase>(new GSDumpXz(m_snapshot, m_crc, fd, m_regs));
 
@@ -469,7 +475,20 @@ void GSRenderer::VSync(int field)
 	else if (m_dump)
 	{
 		if (m_dump->VSync(field, !m_control_key, m_regs))
+		{
 			m_dump.reset();
+		}
+		else if (m_dump->NeedsKeyframe())
+		{
+			freezeData fd = {0, nullptr};
+			Freeze(&fd, true);
+			fd.data = new char[fd.size];
+			Freeze(&fd, false);
+
+			m_dump->AddKeyframe(m_crc, fd, m_regs);
+
+			delete[] fd.data;
+		}
 	}
 
 	// capture
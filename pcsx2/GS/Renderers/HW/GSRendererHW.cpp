@@ -1874,6 +1874,8 @@ bool GSRendererHW::OI_BlitFMV(GSTextureCache::Target* _rt, GSTextureCache::Sourc
 
 		GL_INS("OI_BlitFMV");
 
+		m_tc->DetachHashCacheTexture(tex);
+
 		// The draw is done past the RT at the location of the texture. To avoid various upscaling mess
 		// We will blit the data from the top to the bottom of the texture manually.
 
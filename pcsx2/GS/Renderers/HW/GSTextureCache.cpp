@@ -51,6 +51,9 @@ GSTextureCache::GSTextureCache(GSRenderer* r)
 	if (m_crc_hack_level == CRCHackLevel::Automatic)
 		m_crc_hack_level = GSUtil::GetRecommendedCRCHackLevel(theApp.GetCurrentRendererType());
 
+	// Full mipmapping uploads the layers per source, a shared texture can't hold them
+	m_texture_hash_cache = theApp.GetConfigB("texture_hash_cache") && theApp.GetConfigI("mipmap_hw") != static_cast<int>(HWMipmapLevel::Full);
+
 	// In theory 4MB is enough but 9MB is safer for overflow (8MB
 	// isn't enough in custom resolution)
 	// Test: onimusha 3 PAL 60Hz
@@ -93,6 +96,8 @@ void GSTextureCache::RemoveAll()
 		m_dst[type].clear();
 	}
 
+	ClearHashCache();
+
 	m_palette_map.Clear();
 }
 
@@ -899,6 +904,13 @@ void GSTextureCache::InvalidateVideoMem(GSOffset* off, const GSVector4i& rect, b
 					{
 						m_src.RemoveAt(s);
 					}
+					else if (s->m_from_hash_cache)
+					{
+						// Shared with other sources, the next lookup hashes the new data
+						m_src.RemoveAt(s);
+
+						found |= b;
+					}
 					else
 					{
 						uint32* RESTRICT valid = s->m_valid;
@@ -1236,6 +1248,28 @@ void GSTextureCache::IncAge()
 
 	m_src.m_used = false;
 
+	// Unreferenced textures of the hash cache stay around a bit, games often
+	// upload the same data again once the previous copy is gone
+	for (auto i = m_hash_cache.begin(); i != m_hash_cache.end();)
+	{
+		HashCacheEntry& e = i->second;
+
+		if (e.refcount > 0)
+		{
+			e.age = 0;
+			++i;
+		}
+		else if (++e.age > 30)
+		{
+			m_renderer->m_dev->Recycle(e.texture);
+			i = m_hash_cache.erase(i);
+		}
+		else
+		{
+			++i;
+		}
+	}
+
 	// Clearing of Rendertargets causes flickering in many scene transitions.
 	// Sigh, this seems to be used to invalidate surfaces. So set a huge maxage to avoid flicker,
 	// but still invalidate surfaces. (Disgaea 2 fmv when booting the game through the BIOS)
@@ -1605,16 +1639,20 @@ GSTextureCache::Source* GSTextureCache::CreateSource(const GIFRegTEX0& TEX0, con
 	{
 		if (m_paltex && psm.pal > 0)
 		{
-			src->m_texture = m_renderer->m_dev->CreateTexture(tw, th, Get8bitFormat());
 			AttachPaletteToSource(src, psm.pal, true);
 		}
+		else if (psm.pal > 0)
+		{
+			AttachPaletteToSource(src, psm.pal, false);
+		}
+
+		if (m_texture_hash_cache)
+		{
+			AttachHashCacheTexture(src, TEX0, TEXA);
+		}
 		else
 		{
-			src->m_texture = m_renderer->m_dev->CreateTexture(tw, th);
-			if (psm.pal > 0)
-			{
-				AttachPaletteToSource(src, psm.pal, false);
-			}
+			src->m_texture = m_renderer->m_dev->CreateTexture(tw, th, src->m_palette ? Get8bitFormat() : 0);
 		}
 	}
 
@@ -1737,6 +1775,7 @@ GSTextureCache::Source::Source(GSRenderer* r, const GIFRegTEX0& TEX0, const GIFR
 	, m_p2t(NULL)
 	, m_from_target(NULL)
 	, m_from_target_TEX0(TEX0)
+	, m_from_hash_cache(NULL)
 {
 	m_TEX0 = TEX0;
 	m_TEXA = TEXA;
@@ -1774,6 +1813,14 @@ GSTextureCache::Source::Source(GSRenderer* r, const GIFRegTEX0& TEX0, const GIFR
 GSTextureCache::Source::~Source()
 {
 	_aligned_free(m_write.rect);
+
+	if (m_from_hash_cache)
+	{
+		// The texture stays in the hash cache, IncAge recycles it
+		m_from_hash_cache->refcount--;
+
+		m_texture = NULL;
+	}
 }
 
 void GSTextureCache::Source::Update(const GSVector4i& rect, int layer)
@@ -1952,10 +1999,16 @@ void GSTextureCache::Source::Flush(uint32 count, int layer)
 
 	uint8* buff = m_temp;
 
+	int bytes = 0;
+
 	for (uint32 i = 0; i < count; i++)
 	{
 		GSVector4i r = m_write.rect[i];
 
+		GSVector4i ur = r.rintersect(tr);
+
+		bytes += ur.width() * ur.height() << (m_palette ? 0 : 2);
+
 		if ((r > tr).mask() & 0xff00)
 		{
 			(mem.*rtx)(off, r, buff, pitch, m_TEXA);
@@ -1988,6 +2041,8 @@ void GSTextureCache::Source::Flush(uint32 count, int layer)
 	}
 
 	m_write.count -= count;
+
+	m_renderer->m_perfmon.Put(GSPerfMon::TextureUpload, bytes);
 }
 
 bool GSTextureCache::Source::ClutMatch(PaletteKey palette_key)
@@ -2217,6 +2272,173 @@ void GSTextureCache::AttachPaletteToSource(Source* s, uint16 pal, bool need_gs_t
 	s->m_palette = need_gs_texture ? s->m_palette_obj->GetPaletteGSTexture() : nullptr;
 }
 
+// 64-bit hash of the texture data. Four lanes keep the multiplies independent,
+// size must be a multiple of 32 bytes.
+
+static void HashUpdate(uint64* RESTRICT h, const void* data, size_t size)
+{
+	const uint64* p = (const uint64*)data;
+
+	for (size_t i = 0; i < size / 8; i += 4)
+	{
+		for (int j = 0; j < 4; j++)
+		{
+			uint64 k = p[i + j] * 0x87c37b91114253d5ull;
+
+			k = (k << 31) | (k >> 33);
+
+			h[j] = (h[j] ^ (k * 0x4cf5ad432745937full)) * 5 + 0x52dce729;
+		}
+	}
+}
+
+static uint64 HashFinal(const uint64* h, size_t size)
+{
+	uint64 k = size;
+
+	for (int j = 0; j < 4; j++)
+	{
+		k = ((k ^ h[j]) << 27 | (k ^ h[j]) >> 37) * 0x9e3779b97f4a7c15ull;
+	}
+
+	k ^= k >> 33;
+	k *= 0xff51afd7ed558ccdull;
+	k ^= k >> 33;
+	k *= 0xc4ceb9fe1a85ec53ull;
+	k ^= k >> 33;
+
+	return k;
+}
+
+static const uint64 HashSeed[4] = {0x243f6a8885a308d3ull, 0x13198a2e03707344ull, 0xa4093822299f31d0ull, 0x082efa98ec4e6c89ull};
+
+void GSTextureCache::AttachHashCacheTexture(Source* src, const GIFRegTEX0& TEX0, const GIFRegTEXA& TEXA)
+{
+	const GSLocalMemory::psm_t& psm = GSLocalMemory::m_psm[TEX0.PSM];
+	const GSOffset* off = m_renderer->m_context->offset.tex;
+	const GSVector2i& bs = psm.bs;
+
+	int tw = 1 << TEX0.TW;
+	int th = 1 << TEX0.TH;
+
+	// The blocks are hashed in texture order, where they are in GS memory doesn't matter.
+	// Blocks out of memory are skipped like Source::Update does, their position is
+	// still part of the size.
+
+	uint64 h[4];
+
+	memcpy(h, HashSeed, sizeof(h));
+
+	size_t size = 0;
+
+	for (int y = 0; y < std::max(th, bs.y); y += bs.y)
+	{
+		uint32 base = off->block.row[y >> 3u];
+
+		for (int x = 0; x < std::max(tw, bs.x); x += bs.x, size += 256)
+		{
+			uint32 block = base + off->block.col[x >> 3u];
+
+			if (block < MAX_BLOCKS || m_wrap_gs_mem)
+			{
+				HashUpdate(h, m_renderer->m_mem.BlockPtr(block), 256);
+			}
+		}
+	}
+
+	HashCacheKey key;
+
+	key.data = HashFinal(h, size);
+	key.clut = 0;
+	key.TEXA = 0;
+	key.format = TEX0.PSM | (TEX0.TW << 6) | (TEX0.TH << 10) | ((src->m_palette ? 1 : 0) << 14);
+
+	if (psm.pal > 0 && !src->m_palette)
+	{
+		// The CPU expands the indices, the texture depends on the palette
+
+		const uint32* clut = m_renderer->m_mem.m_clut;
+
+		memcpy(h, HashSeed, sizeof(h));
+
+		HashUpdate(h, clut, psm.pal * sizeof(clut[0]));
+
+		key.clut = HashFinal(h, psm.pal * sizeof(clut[0]));
+	}
+	else if (psm.pal == 0 && psm.fmt > 0)
+	{
+		key.TEXA = TEXA.u64;
+	}
+
+	auto i = m_hash_cache.find(key);
+
+	if (i != m_hash_cache.end())
+	{
+		HashCacheEntry* e = &i->second;
+
+		e->refcount++;
+
+		src->m_texture = e->texture;
+		src->m_from_hash_cache = e;
+		src->m_complete = true;
+
+		m_renderer->m_perfmon.Put(GSPerfMon::TextureHashHit, 1);
+
+		GL_CACHE("TC: hash cache hit (0x%x, %s) %dx%d", TEX0.TBP0, psm_str(TEX0.PSM), tw, th);
+
+		return;
+	}
+
+	m_renderer->m_perfmon.Put(GSPerfMon::TextureHashMiss, 1);
+
+	src->m_texture = m_renderer->m_dev->CreateTexture(tw, th, src->m_palette ? Get8bitFormat() : 0);
+
+	HashCacheEntry* e = &m_hash_cache[key];
+
+	e->texture = src->m_texture;
+	e->refcount = 1;
+	e->age = 0;
+
+	src->m_from_hash_cache = e;
+
+	// Other sources will use the texture as it is, it must hold everything now
+
+	src->Update(GSVector4i(0, 0, tw, th));
+}
+
+void GSTextureCache::DetachHashCacheTexture(Source* src)
+{
+	HashCacheEntry* e = src->m_from_hash_cache;
+
+	if (e == NULL)
+		return;
+
+	// Copy on write, the other sources keep the original
+
+	GSTexture* t = e->texture;
+
+	src->m_texture = m_renderer->m_dev->CreateTexture(t->GetWidth(), t->GetHeight(), t->GetFormat());
+	src->m_from_hash_cache = NULL;
+
+	m_renderer->m_dev->CopyRect(t, src->m_texture, GSVector4i(0, 0, t->GetWidth(), t->GetHeight()));
+
+	e->refcount--;
+}
+
+void GSTextureCache::ClearHashCache()
+{
+	// Called once the sources are gone, nothing references the textures anymore
+
+	for (auto& i : m_hash_cache)
+	{
+		ASSERT(i.second.refcount == 0);
+
+		m_renderer->m_dev->Recycle(i.second.texture);
+	}
+
+	m_hash_cache.clear();
+}
+
 // GSTextureCache::Palette
 
 GSTextureCache::Palette::Palette(const GSRenderer* renderer, uint16 pal, bool need_gs_texture)
@@ -97,6 +97,36 @@ public:
 		bool operator()(const PaletteKey& lhs, const PaletteKey& rhs) const;
 	};
 
+	// Identifies the uploaded content of a source rather than where it lives in
+	// GS memory, so identical data at other addresses can reuse the GSTexture.
+	struct HashCacheKey
+	{
+		uint64 data; // texture blocks
+		uint64 clut; // palette expanded by the CPU, else 0
+		uint64 TEXA; // alpha expansion done by the CPU, else 0
+		uint32 format; // PSM TW TH and whether the texture keeps the indices
+
+		bool operator==(const HashCacheKey& key) const
+		{
+			return data == key.data && clut == key.clut && TEXA == key.TEXA && format == key.format;
+		}
+	};
+
+	struct HashCacheKeyHash
+	{
+		std::size_t operator()(const HashCacheKey& key) const
+		{
+			return (std::size_t)(key.data ^ key.clut ^ key.TEXA ^ key.format);
+		}
+	};
+
+	struct HashCacheEntry
+	{
+		GSTexture* texture;
+		uint32 refcount; // sources using the texture
+		int age; // frames without any source
+	};
+
 	class Source : public Surface
 	{
 		struct
@@ -126,6 +156,8 @@ public:
 		// Keep a GSTextureCache::SourceMap::m_map iterator to allow fast erase
 		std::array<uint16, MAX_PAGES> m_erase_it;
 		uint32* m_pages_as_bit;
+		// The texture belongs to the hash cache, it is shared and never partially updated
+		HashCacheEntry* m_from_hash_cache;
 
 	public:
 		Source(GSRenderer* r, const GIFRegTEX0& TEX0, const GIFRegTEXA& TEXA, uint8* temp, bool dummy_container = false);
@@ -224,6 +256,11 @@ protected:
 	static bool m_wrap_gs_mem;
 	uint8 m_texture_inside_rt_cache_size = 255;
 	std::vector<TexInsideRtCacheEntry> m_texture_inside_rt_cache;
+	bool m_texture_hash_cache;
+	std::unordered_map<HashCacheKey, HashCacheEntry, HashCacheKeyHash> m_hash_cache;
+
+	void AttachHashCacheTexture(Source* src, const GIFRegTEX0& TEX0, const GIFRegTEXA& TEXA);
+	void ClearHashCache();
 
 	virtual Source* CreateSource(const GIFRegTEX0& TEX0, const GIFRegTEXA& TEXA, Target* t = NULL, bool half_right = false, int x_offset = 0, int y_offset = 0);
 	virtual Target* CreateTarget(const GIFRegTEX0& TEX0, int w, int h, int type);
@@ -266,4 +303,7 @@ public:
 	void PrintMemoryUsage();
 
 	void AttachPaletteToSource(Source* s, uint16 pal, bool need_gs_texture);
+
+	// Gives the source its own copy before something draws into it
+	void DetachHashCacheTexture(Source* src);
 };
@@ -0,0 +1,48 @@
+/*  PCSX2 - PS2 Emulator for PCs
+ *  Copyright (C) 2002-2021 PCSX2 Dev Team
+ *
+ *  PCSX2 is free software: you can redistribute it and/or modify it under the terms
+ *  of the GNU Lesser General Public License as published by the Free Software Found-
+ *  ation, either version 3 of the License, or (at your option) any later version.
+ *
+ *  PCSX2 is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ *  without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ *  PURPOSE.  See the GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along with PCSX2.
+ *  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include "GS/Renderers/HW/GSRendererHW.h"
+
+class GSTextureCacheNull final : public GSTextureCache
+{
+protected:
+	int Get8bitFormat() { return 0; }
+
+public:
+	GSTextureCacheNull(GSRenderer* r)
+		: GSTextureCache(r)
+	{
+	}
+
+	void Read(Target* t, const GSVector4i& r) {}
+	void Read(Source* t, const GSVector4i& r) {}
+};
+
+// Hardware renderer on the null device. The texture cache and the draw
+// preparation run as usual but nothing is drawn, the headless replay uses it
+// to measure them without a GPU.
+class GSRendererHWNull final : public GSRendererHW
+{
+protected:
+	void DrawPrims(GSTexture* rt, GSTexture* ds, GSTextureCache::Source* tex) final {}
+
+public:
+	GSRendererHWNull()
+		: GSRendererHW(new GSTextureCacheNull(this))
+	{
+	}
+};
@@ -23,6 +23,9 @@ std::unique_ptr<GSScanlineConstantData> g_const(new GSScanlineConstantData());
 GSDrawScanline::GSDrawScanline()
 	: m_sp_map("GSSetupPrim", &m_local)
 	, m_ds_map("GSDrawScanline", &m_local)
+	, m_de_warm(false)
+	, m_cold(0)
+	, m_warm(0)
 {
 	memset(&m_local, 0, sizeof(m_local));
 
@@ -68,6 +71,7 @@ void GSDrawScanline::BeginDraw(const GSRasterizerData* data)
 		sel.edge = 1;
 
 		m_de = m_ds_map[sel];
+		m_de_warm = m_ds_map.IsWarm();
 	}
 	else
 	{
@@ -101,6 +105,11 @@ void GSDrawScanline::BeginDraw(const GSRasterizerData* data)
 	sel.notest = m_global.sel.notest;
 
 	m_sp = m_sp_map[sel];
+
+	if (m_ds_map.IsWarm() && m_sp_map.IsWarm() && (m_de == NULL || m_de_warm))
+		m_warm++;
+	else
+		m_cold++;
 }
 
 void GSDrawScanline::EndDraw(uint64 frame, uint64 ticks, int actual, int total)
@@ -108,6 +117,35 @@ void GSDrawScanline::EndDraw(uint64 frame, uint64 ticks, int actual, int total)
 	m_ds_map.UpdateStats(frame, ticks, actual, total);
 }
 
+void GSDrawScanline::Prepare(const GSScanlineKeys& keys, void* vm, const std::atomic<bool>& cancel)
+{
+	// The x86 functions embed the local memory address. It never changes, so BeginDraw
+	// copies the same value over it.
+	m_global.vm = vm;
+
+	for (auto i = keys.sp.begin(); i != keys.sp.end() && !cancel; i++)
+	{
+		m_sp_map.Prepare(*i);
+	}
+
+	for (auto i = keys.ds.begin(); i != keys.ds.end() && !cancel; i++)
+	{
+		m_ds_map.Prepare(*i);
+	}
+}
+
+void GSDrawScanline::GetKeys(GSScanlineKeys& keys)
+{
+	m_sp_map.GetKeys(keys.sp);
+	m_ds_map.GetKeys(keys.ds);
+
+	keys.cold += m_cold;
+	keys.warm += m_warm;
+
+	m_cold = 0;
+	m_warm = 0;
+}
+
 #ifndef ENABLE_JIT_RASTERIZER
 
 void GSDrawScanline::SetupPrim(const GSVertexSW* vertex, const uint32* index, const GSVertexSW& dscan)
@@ -37,6 +37,10 @@ protected:
 	GSCodeGeneratorFunctionMap<GSSetupPrimCodeGenerator, uint64, SetupPrimPtr> m_sp_map;
 	GSCodeGeneratorFunctionMap<GSDrawScanlineCodeGenerator, uint64, DrawScanlinePtr> m_ds_map;
 
+	bool m_de_warm;
+	uint64 m_cold; // draws since GetKeys, see GSScanlineKeys
+	uint64 m_warm;
+
 	template <class T, bool masked>
 	void DrawRectT(const int* RESTRICT row, const int* RESTRICT col, const GSVector4i& r, uint32 c, uint32 m);
 
@@ -84,4 +88,7 @@ public:
 	{
 		m_ds_map.PrintStats();
 	}
+
+	void Prepare(const GSScanlineKeys& keys, void* vm, const std::atomic<bool>& cancel);
+	void GetKeys(GSScanlineKeys& keys);
 };
@@ -34,11 +34,13 @@ static int compute_best_thread_height(int threads)
 		return 4;
 }
 
-GSRasterizer::GSRasterizer(IDrawScanline* ds, int id, int threads, GSPerfMon* perfmon)
+GSRasterizer::GSRasterizer(IDrawScanline* ds, int id, int threads, GSPerfMon* perfmon, bool tiled)
 	: m_perfmon(perfmon)
 	, m_ds(ds)
 	, m_id(id)
 	, m_threads(threads)
+	, m_worker_pixels(0)
+	, m_stolen(0)
 {
 	memset(&m_pixels, 0, sizeof(m_pixels));
 
@@ -49,6 +51,7 @@ GSRasterizer::GSRasterizer(IDrawScanline* ds, int id, int threads, GSPerfMon* pe
 
 	int rows = (2048 >> m_thread_height) + 16;
 	m_scanline = (uint8*)_aligned_malloc(rows, 64);
+	m_lines = m_scanline;
 
 	int row = 0;
 
@@ -56,7 +59,8 @@ GSRasterizer::GSRasterizer(IDrawScanline* ds, int id, int threads, GSPerfMon* pe
 	{
 		for (int i = 0; i < threads; i++, row++)
 		{
-			m_scanline[row] = i == id ? 1 : 0;
+			// in tile mode the list hands out work already clipped to the worker's tiles
+			m_scanline[row] = i == id || tiled ? 1 : 0;
 		}
 	}
 }
@@ -75,7 +79,7 @@ bool GSRasterizer::IsOneOfMyScanlines(int top) const
 {
 	ASSERT(top >= 0 && top < 2048);
 
-	return m_scanline[top >> m_thread_height] != 0;
+	return m_lines[top >> m_thread_height] != 0;
 }
 
 bool GSRasterizer::IsOneOfMyScanlines(int top, int bottom) const
@@ -87,7 +91,7 @@ bool GSRasterizer::IsOneOfMyScanlines(int top, int bottom) const
 
 	while (top < bottom)
 	{
-		if (m_scanline[top++])
+		if (m_lines[top++])
 		{
 			return true;
 		}
@@ -100,9 +104,9 @@ int GSRasterizer::FindMyNextScanline(int top) const
 {
 	int i = top >> m_thread_height;
 
-	if (m_scanline[i] == 0)
+	if (m_lines[i] == 0)
 	{
-		while (m_scanline[++i] == 0)
+		while (m_lines[++i] == 0)
 			;
 
 		top = i << m_thread_height;
@@ -128,33 +132,145 @@ int GSRasterizer::GetPixels(bool reset)
 	return pixels;
 }
 
+uint64 GSRasterizer::GetWorkerPixels(bool reset)
+{
+	return reset ? m_worker_pixels.exchange(0) : m_worker_pixels.load();
+}
+
+void GSRasterizer::GetWorkerPixels(std::vector<uint64>& pixels, bool reset)
+{
+	pixels.assign(1, GetWorkerPixels(reset));
+}
+
 void GSRasterizer::Draw(GSRasterizerData* data)
 {
 	GSPerfMonAutoTimer pmat(m_perfmon, GSPerfMon::WorkerDraw0 + m_id);
 
-	if (data->vertex != NULL && data->vertex_count == 0 || data->index != NULL && data->index_count == 0)
+	if ((data->vertex != NULL && data->vertex_count == 0) || (data->index != NULL && data->index_count == 0))
 		return;
 
 	m_pixels.actual = 0;
 	m_pixels.total = 0;
 
-	data->start = __rdtsc();
+	uint64 start = __rdtsc();
+
+	data->Begin(start);
+
+	data->WaitSource();
+
+	m_ds->BeginDraw(data);
+
+	DrawPrims(data, data->scissor, data->index, data->index_count);
+
+#if _M_SSE >= 0x501
+	_mm256_zeroupper();
+#endif
+
+	data->pixels += m_pixels.actual;
+
+	uint64 ticks = __rdtsc() - start;
+
+	m_pixels.sum += m_pixels.actual;
+	m_worker_pixels += m_pixels.actual;
+
+	m_ds->EndDraw(data->frame, ticks, m_pixels.actual, m_pixels.total);
+}
+
+void GSRasterizer::Draw(GSRasterizerTileData* data)
+{
+	GSPerfMonAutoTimer pmat(m_perfmon, GSPerfMon::WorkerDraw0 + m_id);
+
+	m_pixels.actual = 0;
+	m_pixels.total = 0;
+
+	uint64 start = __rdtsc();
+
+	// the scanline setup and the stats live in the parent, the other workers use it too
+	data->parent->Begin(start);
+
+	data->parent->WaitSource();
+
+	m_ds->BeginDraw(data->parent.get());
+
+	for (const GSRasterizerTileData::Tile& tile : data->tiles)
+	{
+		DrawPrims(data, tile.scissor, &data->indices[tile.index_offset], tile.index_count);
+	}
+
+#if _M_SSE >= 0x501
+	_mm256_zeroupper();
+#endif
+
+	data->parent->pixels += m_pixels.actual;
+
+	uint64 ticks = __rdtsc() - start;
+
+	m_pixels.sum += m_pixels.actual;
+	m_worker_pixels += m_pixels.actual;
+
+	m_ds->EndDraw(data->frame, ticks, m_pixels.actual, m_pixels.total);
+}
+
+int GSRasterizer::Draw(GSRasterizerData* data, GSRasterizerWork* work)
+{
+	GSPerfMonAutoTimer pmat(m_perfmon, GSPerfMon::WorkerDraw0 + m_id);
+
+	m_pixels.actual = 0;
+	m_pixels.total = 0;
+
+	uint64 start = __rdtsc();
+
+	data->Begin(start);
+
+	data->WaitSource();
 
 	m_ds->BeginDraw(data);
 
+	GSRasterizerWork::Part part;
+
+	int parts = 0;
+
+	while (work->Claim(part))
+	{
+		m_lines = part.scanline;
+
+		DrawPrims(data, part.scissor, part.index, part.index_count);
+
+		parts++;
+	}
+
+	m_lines = m_scanline;
+
+#if _M_SSE >= 0x501
+	_mm256_zeroupper();
+#endif
+
+	data->pixels += m_pixels.actual;
+
+	uint64 ticks = __rdtsc() - start;
+
+	m_pixels.sum += m_pixels.actual;
+	m_worker_pixels += m_pixels.actual;
+
+	m_ds->EndDraw(data->frame, ticks, m_pixels.actual, m_pixels.total);
+
+	return parts;
+}
+
+void GSRasterizer::DrawPrims(const GSRasterizerData* data, const GSVector4i& scissor, const uint32* index, int index_count)
+{
 	const GSVertexSW* vertex = data->vertex;
 	const GSVertexSW* vertex_end = data->vertex + data->vertex_count;
 
-	const uint32* index = data->index;
-	const uint32* index_end = data->index + data->index_count;
+	const uint32* index_end = index + index_count;
 
 	uint32 tmp_index[] = {0, 1, 2};
 
-	bool scissor_test = !data->bbox.eq(data->bbox.rintersect(data->scissor));
+	bool scissor_test = !data->bbox.eq(data->bbox.rintersect(scissor));
 
-	m_scissor = data->scissor;
-	m_fscissor_x = GSVector4(data->scissor).xzxz();
-	m_fscissor_y = GSVector4(data->scissor).ywyw();
+	m_scissor = scissor;
+	m_fscissor_x = GSVector4(scissor).xzxz();
+	m_fscissor_y = GSVector4(scissor).ywyw();
 
 	switch (data->primclass)
 	{
@@ -162,11 +278,11 @@ void GSRasterizer::Draw(GSRasterizerData* data)
 
 			if (scissor_test)
 			{
-				DrawPoint<true>(vertex, data->vertex_count, index, data->index_count);
+				DrawPoint<true>(vertex, data->vertex_count, index, index_count);
 			}
 			else
 			{
-				DrawPoint<false>(vertex, data->vertex_count, index, data->index_count);
+				DrawPoint<false>(vertex, data->vertex_count, index, index_count);
 			}
 
 			break;
@@ -237,18 +353,6 @@ void GSRasterizer::Draw(GSRasterizerData* data)
 		default:
 			__assume(0);
 	}
-
-#if _M_SSE >= 0x501
-	_mm256_zeroupper();
-#endif
-
-	data->pixels = m_pixels.actual;
-
-	uint64 ticks = __rdtsc() - data->start;
-
-	m_pixels.sum += m_pixels.actual;
-
-	m_ds->EndDraw(data->frame, ticks, m_pixels.actual, m_pixels.total);
 }
 
 template <bool scissor_test>
@@ -1166,8 +1270,11 @@ void GSRasterizer::DrawEdge(int pixels, int left, int top, const GSVertexSW& sca
 
 //
 
-GSRasterizerList::GSRasterizerList(int threads, GSPerfMon* perfmon)
+GSRasterizerList::GSRasterizerList(int threads, GSPerfMon* perfmon, bool tiled, bool steal)
 	: m_perfmon(perfmon)
+	, m_tiled(tiled)
+	, m_steal(steal && threads > 1)
+	, m_stolen(0)
 {
 	m_thread_height = compute_best_thread_height(threads);
 
@@ -1183,15 +1290,35 @@ GSRasterizerList::GSRasterizerList(int threads, GSPerfMon* perfmon)
 			m_scanline[row] = (uint8)i;
 		}
 	}
+
+	// diagonal interleave, neighbours in both directions belong to different workers
+
+	for (int y = 0; y < TileCount; y++)
+	{
+		for (int x = 0; x < TileCount; x++)
+		{
+			m_tile_owner[y * TileCount + x] = (uint8)((x + y) % threads);
+		}
+	}
 }
 
 GSRasterizerList::~GSRasterizerList()
 {
+	// a worker still drawing might wake the others while they are being destroyed
+	Sync();
+
 	_aligned_free(m_scanline);
 }
 
 void GSRasterizerList::Queue(const std::shared_ptr<GSRasterizerData>& data)
 {
+	if (m_tiled)
+	{
+		QueueTiles(data);
+
+		return;
+	}
+
 	GSVector4i r = data->bbox.rintersect(data->scissor);
 
 	ASSERT(r.top >= 0 && r.top < 2048 && r.bottom >= 0 && r.bottom < 2048);
@@ -1205,6 +1332,283 @@ void GSRasterizerList::Queue(const std::shared_ptr<GSRasterizerData>& data)
 	}
 }
 
+void GSRasterizerList::QueueTiles(const std::shared_ptr<GSRasterizerData>& data)
+{
+	if ((data->vertex != NULL && data->vertex_count == 0) || (data->index != NULL && data->index_count == 0))
+		return;
+
+	GSVector4i r = data->bbox.rintersect(data->scissor);
+
+	if (r.rempty())
+		return;
+
+	ASSERT(r.top >= 0 && r.top < 2048 && r.bottom >= 0 && r.bottom < 2048);
+
+	// tiles touched by the draw
+
+	GSVector4i tr = GSVector4i(r.left, r.top, r.right + TileSize - 1, r.bottom + TileSize - 1).sra32(TileShift);
+
+	tr = tr.min_i32(GSVector4i(TileCount));
+
+	// bin the primitives, by their bounding box grown by a pixel for the anti-aliased edges
+
+	static const int vertices_per_prim[] = {1, 2, 3, 2};
+
+	int n = vertices_per_prim[data->primclass];
+	int count = data->index != NULL ? data->index_count : data->vertex_count;
+
+	uint32 prim[3];
+
+	for (int i = 0; i < count; i += n)
+	{
+		for (int j = 0; j < n; j++)
+		{
+			prim[j] = data->index != NULL ? data->index[i + j] : (uint32)(i + j);
+		}
+
+		GSVector4 pmin = data->vertex[prim[0]].p;
+		GSVector4 pmax = pmin;
+
+		for (int j = 1; j < n; j++)
+		{
+			pmin = pmin.min(data->vertex[prim[j]].p);
+			pmax = pmax.max(data->vertex[prim[j]].p);
+		}
+
+		GSVector4i pr = GSVector4i(pmin.xyxy(pmax).floor()) + GSVector4i(-1, -1, 2, 2);
+
+		pr = GSVector4i(pr.left, pr.top, pr.right + TileSize - 1, pr.bottom + TileSize - 1).sra32(TileShift).rintersect(tr);
+
+		for (int y = pr.top; y < pr.bottom; y++)
+		{
+			for (int x = pr.left; x < pr.right; x++)
+			{
+				std::vector<uint32>& bin = m_bins[y * TileCount + x];
+
+				bin.insert(bin.end(), prim, prim + n);
+			}
+		}
+	}
+
+	// hand each worker its tiles in one go
+
+	std::vector<std::shared_ptr<GSRasterizerTileData>> work(m_workers.size());
+
+	for (int y = tr.top; y < tr.bottom; y++)
+	{
+		for (int x = tr.left; x < tr.right; x++)
+		{
+			std::vector<uint32>& bin = m_bins[y * TileCount + x];
+
+			if (bin.empty())
+				continue;
+
+			std::shared_ptr<GSRasterizerTileData>& td = work[m_tile_owner[y * TileCount + x]];
+
+			if (!td)
+				td = std::make_shared<GSRasterizerTileData>(data);
+
+			GSRasterizerTileData::Tile tile;
+
+			tile.scissor = GSVector4i(x, y, x + 1, y + 1).sll32(TileShift).rintersect(data->scissor);
+			tile.index_offset = (int)td->indices.size();
+			tile.index_count = (int)bin.size();
+
+			td->tiles.push_back(tile);
+			td->indices.insert(td->indices.end(), bin.begin(), bin.end());
+
+			bin.clear();
+		}
+	}
+
+	for (size_t i = 0; i < work.size(); i++)
+	{
+		if (work[i])
+		{
+			m_workers[i]->Push(work[i]);
+		}
+	}
+}
+
+bool GSRasterizerList::Split(int id, GSRasterizerData* data)
+{
+	GSRasterizerWork* work = m_work[id].get();
+
+	const uint8* scanline = m_r[id]->GetScanlines();
+
+	if (m_tiled)
+	{
+		// every tile is a part, they are already binned
+
+		GSRasterizerTileData* td = static_cast<GSRasterizerTileData*>(data);
+
+		if (td->tiles.size() < 2)
+			return false;
+
+		for (const GSRasterizerTileData::Tile& tile : td->tiles)
+		{
+			GSRasterizerWork::Part part;
+
+			part.scissor = tile.scissor;
+			part.scanline = scanline;
+			part.index = &td->indices[tile.index_offset];
+			part.index_count = tile.index_count;
+
+			work->Add(part);
+		}
+
+		return true;
+	}
+
+	if ((data->vertex != NULL && data->vertex_count == 0) || (data->index != NULL && data->index_count == 0))
+		return false;
+
+	GSVector4i r = data->bbox.rintersect(data->scissor);
+
+	if (r.rempty())
+		return false;
+
+	// count the lines of the draw that are ours
+
+	int lines = 0;
+
+	for (int y = r.top; y < r.bottom;)
+	{
+		int next = std::min<int>(((y >> m_thread_height) + 1) << m_thread_height, r.bottom);
+
+		if (scanline[y >> m_thread_height])
+		{
+			lines += next - y;
+		}
+
+		y = next;
+	}
+
+	int n = std::min<int>(lines * r.width() / StealPixels, m_workers.size());
+
+	if (n < 2)
+		return false;
+
+	// cut them in n parts of about the same height, a part's scissor may also cover the
+	// lines of other workers in between, the owner's scanline table skips those
+
+	int height = (lines + n - 1) / n;
+	int top = r.top;
+	int count = 0;
+
+	GSRasterizerWork::Part part;
+
+	part.scanline = scanline;
+	part.index = data->index;
+	part.index_count = data->index_count;
+
+	for (int y = r.top; y < r.bottom;)
+	{
+		int next = std::min<int>(((y >> m_thread_height) + 1) << m_thread_height, r.bottom);
+
+		if (scanline[y >> m_thread_height])
+		{
+			if (count + next - y >= height)
+			{
+				next = y + height - count;
+
+				part.scissor = GSVector4i(r.left, top, r.right, next);
+
+				work->Add(part);
+
+				top = next;
+				count = 0;
+			}
+			else
+			{
+				count += next - y;
+			}
+		}
+
+		y = next;
+	}
+
+	if (count > 0)
+	{
+		part.scissor = GSVector4i(r.left, top, r.right, r.bottom);
+
+		work->Add(part);
+	}
+
+	if (work->GetCount() < 2)
+	{
+		work->Clear();
+
+		return false;
+	}
+
+	return true;
+}
+
+void GSRasterizerList::Draw(int id, std::shared_ptr<GSRasterizerData>& item)
+{
+	GSRasterizer* r = m_r[id].get();
+
+	if (!Split(id, item.get()))
+	{
+		if (m_tiled)
+		{
+			r->Draw(static_cast<GSRasterizerTileData*>(item.get()));
+		}
+		else
+		{
+			r->Draw(item.get());
+		}
+
+		return;
+	}
+
+	// the scanline setup of a tiled draw lives in the parent
+
+	GSRasterizerData* data = m_tiled ? static_cast<GSRasterizerTileData*>(item.get())->parent.get() : item.get();
+
+	GSRasterizerWork* work = m_work[id].get();
+
+	work->Publish(data);
+
+	for (size_t i = 0; i < m_workers.size(); i++)
+	{
+		if (i != (size_t)id && m_workers[i]->IsEmpty())
+		{
+			m_workers[i]->Wake();
+		}
+	}
+
+	r->Draw(data, work);
+
+	// the next draw may overlap the parts the helpers are still drawing
+
+	work->Retract();
+}
+
+bool GSRasterizerList::Steal(int id)
+{
+	// look for work starting with the next worker, so the helpers spread out
+
+	for (size_t i = 1; i < m_work.size(); i++)
+	{
+		GSRasterizerWork* work = m_work[(id + i) % m_work.size()].get();
+
+		GSRasterizerData* data = work->Join();
+
+		if (data != NULL)
+		{
+			m_r[id]->AddStolen(m_r[id]->Draw(data, work));
+
+			work->Leave();
+
+			return true;
+		}
+	}
+
+	return false;
+}
+
 void GSRasterizerList::Sync()
 {
 	if (!IsSynced())
@@ -1216,6 +1620,23 @@ void GSRasterizerList::Sync()
 
 		m_perfmon->Put(GSPerfMon::SyncPoint, 1);
 	}
+
+	if (m_steal)
+	{
+		uint64 stolen = 0;
+
+		for (size_t i = 0; i < m_r.size(); i++)
+		{
+			stolen += m_r[i]->GetStolen();
+		}
+
+		if (stolen > m_stolen)
+		{
+			m_perfmon->Put(GSPerfMon::Steal, (double)(stolen - m_stolen));
+
+			m_stolen = stolen;
+		}
+	}
 }
 
 bool GSRasterizerList::IsSynced() const
@@ -1242,3 +1663,58 @@ int GSRasterizerList::GetPixels(bool reset)
 
 	return pixels;
 }
+
+void GSRasterizerList::GetWorkerPixels(std::vector<uint64>& pixels, bool reset)
+{
+	pixels.resize(m_r.size());
+
+	for (size_t i = 0; i < m_r.size(); i++)
+	{
+		pixels[i] = m_r[i]->GetWorkerPixels(reset);
+	}
+}
+
+void GSRasterizerList::PrintStats()
+{
+	std::vector<uint64> pixels;
+
+	GetWorkerPixels(pixels, false);
+
+	uint64 total = 0;
+
+	for (uint64 p : pixels)
+	{
+		total += p;
+	}
+
+	printf("GS: %s rasterizer, %d workers%s\n", m_tiled ? "tiled" : "scanline", (int)pixels.size(), m_steal ? ", work stealing" : "");
+
+	for (size_t i = 0; i < pixels.size(); i++)
+	{
+		// the draw timer also runs while helping others, the rest of the time the worker was idle
+
+		int busy = (int)i < GSPerfMon::WorkerDrawCount ? m_perfmon->CPU(GSPerfMon::WorkerDraw0 + i, false) : 0;
+
+		printf("  worker %d: %llu pixels (%.1f%%), %d%% busy, %d%% idle, %llu parts stolen\n",
+			(int)i, (unsigned long long)pixels[i], total > 0 ? pixels[i] * 100.0 / total : 0.0,
+			busy, 100 - busy, (unsigned long long)m_r[i]->GetStolen());
+	}
+}
+
+void GSRasterizerList::Prepare(const GSScanlineKeys& keys, void* vm, const std::atomic<bool>& cancel)
+{
+	// each worker has its own copy of the functions, they address its local data
+
+	for (size_t i = 0; i < m_r.size() && !cancel; i++)
+	{
+		m_r[i]->Prepare(keys, vm, cancel);
+	}
+}
+
+void GSRasterizerList::GetKeys(GSScanlineKeys& keys)
+{
+	for (size_t i = 0; i < m_r.size(); i++)
+	{
+		m_r[i]->GetKeys(keys);
+	}
+}
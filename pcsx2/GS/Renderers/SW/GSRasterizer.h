@@ -36,8 +36,8 @@ public:
 	uint32* index;
 	int index_count;
 	uint64 frame;
-	uint64 start;
-	int pixels;
+	std::atomic<uint64> start; // when the first worker started on it
+	std::atomic<int> pixels; // drawn by all the workers
 	int counter;
 
 	GSRasterizerData()
@@ -61,6 +61,149 @@ public:
 		if (buff != NULL)
 			_aligned_free(buff);
 	}
+
+	// Called by every worker before drawing, finishes the work the draw depends on which
+	// may run on any thread, like decoding its textures.
+	virtual void WaitSource() {}
+
+	void Begin(uint64 t)
+	{
+		uint64 none = 0;
+		start.compare_exchange_strong(none, t);
+	}
+};
+
+// A worker's share of a draw in tile binning mode: the tiles it owns which the draw
+// touches, each with the primitives overlapping it. Shares the vertices of the parent.
+class alignas(32) GSRasterizerTileData : public GSRasterizerData
+{
+public:
+	struct Tile
+	{
+		GSVector4i scissor;
+		int index_offset;
+		int index_count;
+	};
+
+	std::shared_ptr<GSRasterizerData> parent;
+	std::vector<Tile> tiles;
+	std::vector<uint32> indices;
+
+	GSRasterizerTileData(const std::shared_ptr<GSRasterizerData>& parent)
+		: parent(parent)
+	{
+		scissor = parent->scissor;
+		bbox = parent->bbox;
+		primclass = parent->primclass;
+		vertex = parent->vertex;
+		vertex_count = parent->vertex_count;
+		frame = parent->frame;
+	}
+};
+
+// The parts of a draw that a worker has not started yet, which idle workers can take from
+// it. Parts are claimed front to back by the owner and helpers alike, the owner retracts
+// the draw when it runs out and waits for the helpers to finish theirs.
+class GSRasterizerWork
+{
+public:
+	struct Part
+	{
+		GSVector4i scissor;
+		const uint8* scanline; // the owner's scanline table, the helper draws its lines
+		const uint32* index;
+		int index_count;
+	};
+
+protected:
+	std::mutex m_lock;
+	std::condition_variable m_left;
+	GSRasterizerData* m_data;
+	std::vector<Part> m_parts;
+	size_t m_next;
+	int m_helpers;
+
+public:
+	GSRasterizerWork()
+		: m_data(NULL)
+		, m_next(0)
+		, m_helpers(0)
+	{
+	}
+
+	// owner, between Retract() and Publish()
+
+	void Add(const Part& part) { m_parts.push_back(part); }
+	size_t GetCount() const { return m_parts.size(); }
+	void Clear() { m_parts.clear(); }
+
+	void Publish(GSRasterizerData* data)
+	{
+		std::lock_guard<std::mutex> l(m_lock);
+
+		m_data = data;
+		m_next = 0;
+	}
+
+	void Retract()
+	{
+		std::unique_lock<std::mutex> l(m_lock);
+
+		m_data = NULL;
+
+		while (m_helpers > 0)
+			m_left.wait(l);
+
+		m_parts.clear();
+	}
+
+	// helpers, the draw stays valid until Leave()
+
+	GSRasterizerData* Join()
+	{
+		std::lock_guard<std::mutex> l(m_lock);
+
+		if (m_data == NULL || m_next >= m_parts.size())
+			return NULL;
+
+		m_helpers++;
+
+		return m_data;
+	}
+
+	void Leave()
+	{
+		{
+			std::lock_guard<std::mutex> l(m_lock);
+
+			m_helpers--;
+		}
+
+		m_left.notify_one();
+	}
+
+	// both
+
+	bool Claim(Part& part)
+	{
+		std::lock_guard<std::mutex> l(m_lock);
+
+		if (m_data == NULL || m_next >= m_parts.size())
+			return false;
+
+		part = m_parts[m_next++];
+
+		return true;
+	}
+};
+
+// Selector keys of the jit functions, saved per game so the next run can compile them
+// before the first draw needs them.
+struct GSScanlineKeys
+{
+	std::set<uint64> sp, ds;
+	uint64 cold = 0; // draws with a function compiled when a draw needed it
+	uint64 warm = 0; // draws whose functions were all compiled ahead of time
 };
 
 class IDrawScanline : public GSAlignedClass<32>
@@ -107,6 +250,11 @@ public:
 
 	virtual void PrintStats() = 0;
 
+	// Prepare may run on any thread, GetKeys only while this one isn't drawing.
+	// vm is the local memory the draws will use, some functions embed its address.
+	virtual void Prepare(const GSScanlineKeys& keys, void* vm, const std::atomic<bool>& cancel) = 0;
+	virtual void GetKeys(GSScanlineKeys& keys) = 0;
+
 	__forceinline bool HasEdge() const { return m_de != NULL; }
 	__forceinline bool IsSolidRect() const { return m_dr != NULL; }
 };
@@ -120,7 +268,10 @@ public:
 	virtual void Sync() = 0;
 	virtual bool IsSynced() const = 0;
 	virtual int GetPixels(bool reset = true) = 0;
+	virtual void GetWorkerPixels(std::vector<uint64>& pixels, bool reset = false) = 0;
 	virtual void PrintStats() = 0;
+	virtual void Prepare(const GSScanlineKeys& keys, void* vm, const std::atomic<bool>& cancel) = 0;
+	virtual void GetKeys(GSScanlineKeys& keys) = 0;
 };
 
 class alignas(32) GSRasterizer : public IRasterizer
@@ -132,11 +283,14 @@ protected:
 	int m_threads;
 	int m_thread_height;
 	uint8* m_scanline;
+	const uint8* m_lines; // m_scanline, or the owner's while helping with a part of its draw
 	GSVector4i m_scissor;
 	GSVector4 m_fscissor_x;
 	GSVector4 m_fscissor_y;
 	struct { GSVertexSW* buff; int count; } m_edge;
 	struct { int sum, actual, total; } m_pixels;
+	std::atomic<uint64> m_worker_pixels; // not reset by Sync, for comparing workers
+	std::atomic<uint64> m_stolen; // parts drawn for other workers
 
 	typedef void (GSRasterizer::*DrawPrimPtr)(const GSVertexSW* v, int count);
 
@@ -145,6 +299,7 @@ protected:
 	void DrawLine(const GSVertexSW* vertex, const uint32* index);
 	void DrawTriangle(const GSVertexSW* vertex, const uint32* index);
 	void DrawSprite(const GSVertexSW* vertex, const uint32* index);
+	void DrawPrims(const GSRasterizerData* data, const GSVector4i& scissor, const uint32* index, int index_count);
 
 #if _M_SSE >= 0x501
 	__forceinline void DrawTriangleSection(int top, int bottom, GSVertexSW2& edge, const GSVertexSW2& dedge, const GSVertexSW2& dscan, const GSVector4& p0);
@@ -161,7 +316,7 @@ protected:
 	__forceinline void DrawEdge(int pixels, int left, int top, const GSVertexSW& scan);
 
 public:
-	GSRasterizer(IDrawScanline* ds, int id, int threads, GSPerfMon* perfmon);
+	GSRasterizer(IDrawScanline* ds, int id, int threads, GSPerfMon* perfmon, bool tiled = false);
 	virtual ~GSRasterizer();
 
 	__forceinline bool IsOneOfMyScanlines(int top) const;
@@ -169,6 +324,13 @@ public:
 	__forceinline int FindMyNextScanline(int top) const;
 
 	void Draw(GSRasterizerData* data);
+	void Draw(GSRasterizerTileData* data);
+	int Draw(GSRasterizerData* data, GSRasterizerWork* work);
+
+	const uint8* GetScanlines() const { return m_scanline; }
+	uint64 GetWorkerPixels(bool reset);
+	uint64 GetStolen() const { return m_stolen; }
+	void AddStolen(int parts) { m_stolen += parts; }
 
 	// IRasterizer
 
@@ -176,7 +338,10 @@ public:
 	void Sync() {}
 	bool IsSynced() const { return true; }
 	int GetPixels(bool reset);
+	void GetWorkerPixels(std::vector<uint64>& pixels, bool reset);
 	void PrintStats() { m_ds->PrintStats(); }
+	void Prepare(const GSScanlineKeys& keys, void* vm, const std::atomic<bool>& cancel) { m_ds->Prepare(keys, vm, cancel); }
+	void GetKeys(GSScanlineKeys& keys) { m_ds->GetKeys(keys); }
 };
 
 class GSRasterizerList : public IRasterizer
@@ -184,14 +349,35 @@ class GSRasterizerList : public IRasterizer
 protected:
 	using GSWorker = GSJobQueue<std::shared_ptr<GSRasterizerData>, 65536>;
 
+	// Tile binning mode: the screen is cut in fixed tiles, each owned by one worker, so
+	// a tile's frame and z buffer stay in that worker's caches from draw to draw.
+	static const int TileShift = 6; // 64x64
+	static const int TileSize = 1 << TileShift;
+	static const int TileCount = 2048 >> TileShift;
+
+	// Work stealing: a worker splits a draw of at least two parts of this many pixels in
+	// up to one part per worker, so the idle workers can help with it.
+	static const int StealPixels = 8192;
+
 	GSPerfMon* m_perfmon;
 	// Worker threads depend on the rasterizers, so don't change the order.
 	std::vector<std::unique_ptr<GSRasterizer>> m_r;
+	std::vector<std::unique_ptr<GSRasterizerWork>> m_work;
 	std::vector<std::unique_ptr<GSWorker>> m_workers;
 	uint8* m_scanline;
 	int m_thread_height;
+	bool m_tiled;
+	bool m_steal;
+	uint64 m_stolen; // parts already reported to the perfmon
+	uint8 m_tile_owner[TileCount * TileCount];
+	std::vector<uint32> m_bins[TileCount * TileCount];
 
-	GSRasterizerList(int threads, GSPerfMon* perfmon);
+	GSRasterizerList(int threads, GSPerfMon* perfmon, bool tiled, bool steal);
+
+	void QueueTiles(const std::shared_ptr<GSRasterizerData>& data);
+	bool Split(int id, GSRasterizerData* data);
+	void Draw(int id, std::shared_ptr<GSRasterizerData>& item);
+	bool Steal(int id);
 
 public:
 	virtual ~GSRasterizerList();
@@ -206,14 +392,37 @@ public:
 			return new GSRasterizer(new DS(), 0, 1, perfmon);
 		}
 
-		GSRasterizerList* rl = new GSRasterizerList(threads, perfmon);
+		bool tiled = theApp.GetConfigB("extrathreads_tiled");
+		bool steal = theApp.GetConfigB("extrathreads_steal");
+
+		GSRasterizerList* rl = new GSRasterizerList(threads, perfmon, tiled, steal);
+
+		for (int i = 0; i < threads; i++)
+		{
+			rl->m_r.push_back(std::unique_ptr<GSRasterizer>(new GSRasterizer(new DS(), i, threads, perfmon, tiled)));
+			rl->m_work.push_back(std::unique_ptr<GSRasterizerWork>(new GSRasterizerWork()));
+		}
 
 		for (int i = 0; i < threads; i++)
 		{
-			rl->m_r.push_back(std::unique_ptr<GSRasterizer>(new GSRasterizer(new DS(), i, threads, perfmon)));
-			auto& r = *rl->m_r[i];
-			rl->m_workers.push_back(std::unique_ptr<GSWorker>(new GSWorker(
-				[&r](std::shared_ptr<GSRasterizerData>& item) { r.Draw(item.get()); })));
+			if (steal)
+			{
+				rl->m_workers.push_back(std::unique_ptr<GSWorker>(new GSWorker(
+					[rl, i](std::shared_ptr<GSRasterizerData>& item) { rl->Draw(i, item); },
+					[rl, i]() { return rl->Steal(i); })));
+			}
+			else if (tiled)
+			{
+				auto& r = *rl->m_r[i];
+				rl->m_workers.push_back(std::unique_ptr<GSWorker>(new GSWorker(
+					[&r](std::shared_ptr<GSRasterizerData>& item) { r.Draw(static_cast<GSRasterizerTileData*>(item.get())); })));
+			}
+			else
+			{
+				auto& r = *rl->m_r[i];
+				rl->m_workers.push_back(std::unique_ptr<GSWorker>(new GSWorker(
+					[&r](std::shared_ptr<GSRasterizerData>& item) { r.Draw(item.get()); })));
+			}
 		}
 
 		return rl;
@@ -225,5 +434,8 @@ public:
 	void Sync();
 	bool IsSynced() const;
 	int GetPixels(bool reset);
-	void PrintStats() {}
+	void GetWorkerPixels(std::vector<uint64>& pixels, bool reset);
+	void PrintStats();
+	void Prepare(const GSScanlineKeys& keys, void* vm, const std::atomic<bool>& cancel);
+	void GetKeys(GSScanlineKeys& keys);
 };
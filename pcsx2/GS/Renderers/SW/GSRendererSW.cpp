@@ -27,6 +27,9 @@ CONSTINIT const GSVector8 GSRendererSW::m_pos_scale2 = GSVector8::cxpr(1.0f / 16
 
 GSRendererSW::GSRendererSW(int threads)
 	: m_fzb(NULL)
+	, m_pages_waiting(false)
+	, m_keys_crc(0)
+	, m_warmup_cancel(false)
 {
 	m_nativeres = true; // ignore ini, sw is always native
 
@@ -47,6 +50,8 @@ GSRendererSW::GSRendererSW(int threads)
 		m_tex_pages[i] = 0;
 	}
 
+	memset(m_sync_stats, 0, sizeof(m_sync_stats));
+
 	#define InitCVB2(P, Q) \
 		m_cvb[P][0][0][Q] = &GSRendererSW::ConvertVertexBuffer<P, 0, 0, Q>; \
 		m_cvb[P][0][1][Q] = &GSRendererSW::ConvertVertexBuffer<P, 0, 1, Q>; \
@@ -75,6 +80,11 @@ GSRendererSW::GSRendererSW(int threads)
 
 GSRendererSW::~GSRendererSW()
 {
+	StopWarmup();
+	SaveKeys();
+
+	PrintSyncStats();
+
 	delete m_tc;
 
 	for (size_t i = 0; i < countof(m_texture); i++)
@@ -87,6 +97,96 @@ GSRendererSW::~GSRendererSW()
 	_aligned_free(m_output);
 }
 
+void GSRendererSW::SetGameCRC(uint32 crc, int options)
+{
+	GSRenderer::SetGameCRC(crc, options);
+
+	if (crc == m_keys_crc || GLLoader::in_replayer || !theApp.GetConfigB("jit_warmup_sw"))
+		return;
+
+	StopWarmup();
+	SaveKeys();
+	LoadKeys(crc);
+
+	if (!m_keys.sp.empty() || !m_keys.ds.empty())
+	{
+		m_warmup_cancel = false;
+		m_warmup = std::thread([this]() { m_rl->Prepare(m_keys, m_mem.m_vm8, m_warmup_cancel); });
+	}
+}
+
+void GSRendererSW::LoadKeys(uint32 crc)
+{
+	m_keys = GSScanlineKeys();
+	m_keys_crc = crc;
+
+	if (crc == 0)
+		return;
+
+	FILE* fp = fopen(theApp.GetCachePath(format("%08X.jit", crc)).c_str(), "r");
+
+	if (fp == NULL)
+		return;
+
+	int version = 0;
+
+	if (fscanf(fp, "version %d", &version) == 1 && version == GSScanlineSelector::Version)
+	{
+		char type[4];
+		unsigned long long key;
+
+		while (fscanf(fp, "%3s %llx", type, &key) == 2)
+		{
+			if (strcmp(type, "sp") == 0)
+				m_keys.sp.insert(key);
+			else if (strcmp(type, "ds") == 0)
+				m_keys.ds.insert(key);
+		}
+	}
+
+	fclose(fp);
+}
+
+void GSRendererSW::SaveKeys()
+{
+	if (m_keys_crc == 0)
+		return;
+
+	Sync(9);
+
+	size_t loaded = m_keys.sp.size() + m_keys.ds.size();
+
+	m_rl->GetKeys(m_keys);
+
+	printf("GS: jit warm-up for %08X, %zu keys loaded, %zu saved, %llu draws used a function compiled on demand, %llu only warmed-up ones\n",
+		m_keys_crc, loaded, m_keys.sp.size() + m_keys.ds.size(),
+		(unsigned long long)m_keys.cold, (unsigned long long)m_keys.warm);
+
+	FILE* fp = fopen(theApp.GetCachePath(format("%08X.jit", m_keys_crc)).c_str(), "w");
+
+	if (fp == NULL)
+		return;
+
+	fprintf(fp, "version %d\n", (int)GSScanlineSelector::Version);
+
+	for (uint64 key : m_keys.sp)
+		fprintf(fp, "sp %016llx\n", (unsigned long long)key);
+
+	for (uint64 key : m_keys.ds)
+		fprintf(fp, "ds %016llx\n", (unsigned long long)key);
+
+	fclose(fp);
+}
+
+void GSRendererSW::StopWarmup()
+{
+	if (m_warmup.joinable())
+	{
+		m_warmup_cancel = true;
+		m_warmup.join();
+	}
+}
+
 void GSRendererSW::Reset()
 {
 	Sync(-1);
@@ -424,17 +524,11 @@ void GSRendererSW::Draw()
 
 	// check if there is an overlap between this and previous targets
 
-	if (CheckTargetPages(fb_pages, zb_pages, r))
-	{
-		sd->m_syncpoint = SharedData::SyncTarget;
-	}
+	CheckTargetPages(fb_pages, zb_pages, r);
 
 	// check if the texture is not part of a target currently in use
 
-	if (CheckSourcePages(sd))
-	{
-		sd->m_syncpoint = SharedData::SyncSource;
-	}
+	CheckSourcePages(sd);
 
 	// addref source and target pages
 
@@ -546,20 +640,11 @@ void GSRendererSW::Queue(std::shared_ptr<GSRasterizerData>& item)
 {
 	SharedData* sd = (SharedData*)item.get();
 
-	if (sd->m_syncpoint == SharedData::SyncSource)
-	{
-		Sync(4);
-	}
-
-	// update previously invalidated parts
+	// collect the previously invalidated parts, the workers decode them before drawing,
+	// Draw has already waited for the draws writing them
 
 	sd->UpdateSource();
 
-	if (sd->m_syncpoint == SharedData::SyncTarget)
-	{
-		Sync(5);
-	}
-
 	if (LOG)
 	{
 		GSScanlineGlobalData& gd = ((SharedData*)item.get())->global;
@@ -599,6 +684,11 @@ void GSRendererSW::Sync(int reason)
 
 	uint64 t = __rdtsc();
 
+	if (!m_rl->IsSynced())
+	{
+		m_sync_stats[reason + 1].syncs++;
+	}
+
 	m_rl->Sync();
 
 	if (0) if (LOG)
@@ -633,32 +723,105 @@ void GSRendererSW::Sync(int reason)
 	m_perfmon.Put(GSPerfMon::Fillrate, pixels);
 }
 
-void GSRendererSW::InvalidateVideoMem(const GIFRegBITBLTBUF& BITBLTBUF, const GSVector4i& r)
+bool GSRendererSW::WaitPages(const uint32* pages, bool tex, int reason)
 {
+	if (pages == NULL || m_rl->IsSynced())
+		return false;
+
+	auto busy = [&]() -> bool
+	{
+		for (const uint32* p = pages; *p != GSOffset::EOP; p++)
+		{
+			if (m_fzb_pages[*p] || (tex && m_tex_pages[*p]))
+			{
+				return true;
+			}
+		}
+
+		return false;
+	};
+
+	if (!busy())
+		return false;
+
+	GSPerfMonAutoTimer pmat(&m_perfmon, GSPerfMon::Sync);
+
+	uint64 t = __rdtsc();
+
+	// the draws drop their pages when the last worker is done with them, see ReleasePages
+
+	m_pages_waiting = true;
+
+	{
+		std::unique_lock<std::mutex> l(m_pages_lock);
+
+		while (busy())
+		{
+			m_pages_released.wait(l);
+		}
+	}
+
+	m_pages_waiting = false;
+
+	t = __rdtsc() - t;
+
+	m_sync_stats[reason + 1].waits++;
+
+	m_perfmon.Put(GSPerfMon::PageWait, 1);
+
 	if (LOG)
 	{
-		fprintf(s_fp, "w %05x %u %u, %d %d %d %d\n", BITBLTBUF.DBP, BITBLTBUF.DBW, BITBLTBUF.DPSM, r.x, r.y, r.z, r.w);
+		fprintf(s_fp, "wait n=%d r=%d t=%llu\n", s_n, reason, t);
 		fflush(s_fp);
 	}
 
-	GSOffset* off = m_mem.GetOffset(BITBLTBUF.DBP, BITBLTBUF.DBW, BITBLTBUF.DPSM);
+	return true;
+}
 
-	off->GetPages(r, m_tmp_pages);
+void GSRendererSW::PrintSyncStats()
+{
+	static const char* names[countof(m_sync_stats)] = {
+		"reset", "vsync", "output", "dump", "dump", "texture in use", "target overlap", "local memory write", "local memory read", "clut read", "jit keys"};
 
-	// check if the changing pages either used as a texture or a target
+	uint64 syncs = 0;
+	uint64 waits = 0;
 
-	if (!m_rl->IsSynced())
+	for (size_t i = 0; i < countof(m_sync_stats); i++)
 	{
-		for (uint32* RESTRICT p = m_tmp_pages; *p != GSOffset::EOP; p++)
-		{
-			if (m_fzb_pages[*p] | m_tex_pages[*p])
-			{
-				Sync(6);
+		syncs += m_sync_stats[i].syncs;
+		waits += m_sync_stats[i].waits;
+	}
 
-				break;
-			}
+	if (syncs + waits == 0)
+		return;
+
+	printf("GS: %llu full syncs, %llu page waits\n", (unsigned long long)syncs, (unsigned long long)waits);
+
+	for (size_t i = 0; i < countof(m_sync_stats); i++)
+	{
+		if (m_sync_stats[i].syncs + m_sync_stats[i].waits > 0)
+		{
+			printf("  %d %s: %llu full syncs, %llu page waits\n", (int)i - 1, names[i],
+				(unsigned long long)m_sync_stats[i].syncs, (unsigned long long)m_sync_stats[i].waits);
 		}
 	}
+}
+
+void GSRendererSW::InvalidateVideoMem(const GIFRegBITBLTBUF& BITBLTBUF, const GSVector4i& r)
+{
+	if (LOG)
+	{
+		fprintf(s_fp, "w %05x %u %u, %d %d %d %d\n", BITBLTBUF.DBP, BITBLTBUF.DBW, BITBLTBUF.DPSM, r.x, r.y, r.z, r.w);
+		fflush(s_fp);
+	}
+
+	GSOffset* off = m_mem.GetOffset(BITBLTBUF.DBP, BITBLTBUF.DBW, BITBLTBUF.DPSM);
+
+	off->GetPages(r, m_tmp_pages);
+
+	// wait for the draws using the changing pages either as a texture or a target
+
+	WaitPages(m_tmp_pages, true, 6);
 
 	m_tc->InvalidatePages(m_tmp_pages, off->psm); // if texture update runs on a thread and Sync(5) happens then this must come later
 }
@@ -677,15 +840,9 @@ void GSRendererSW::InvalidateLocalMem(const GIFRegBITBLTBUF& BITBLTBUF, const GS
 
 		off->GetPages(r, m_tmp_pages);
 
-		for (uint32* RESTRICT p = m_tmp_pages; *p != GSOffset::EOP; p++)
-		{
-			if (m_fzb_pages[*p])
-			{
-				Sync(7);
+		// wait for the draws writing the pages being read
 
-				break;
-			}
-		}
+		WaitPages(m_tmp_pages, false, clut ? 8 : 7);
 	}
 }
 
@@ -735,6 +892,15 @@ void GSRendererSW::ReleasePages(const uint32* pages, const int type)
 				break;
 		}
 	}
+
+	if (m_pages_waiting)
+	{
+		{
+			std::lock_guard<std::mutex> l(m_pages_lock);
+		}
+
+		m_pages_released.notify_one();
+	}
 }
 
 bool GSRendererSW::CheckTargetPages(const uint32* fb_pages, const uint32* zb_pages, const GSVector4i& r)
@@ -911,6 +1077,14 @@ bool GSRendererSW::CheckTargetPages(const uint32* fb_pages, const uint32* zb_pag
 		}
 	}
 
+	if (res)
+	{
+		// only the draws using the same pages have to finish, the others keep running
+
+		WaitPages(fb_pages, true, 5);
+		WaitPages(zb_pages, true, 5);
+	}
+
 	if (!fb && fb_pages != NULL) delete[] fb_pages;
 	if (!zb && zb_pages != NULL) delete[] zb_pages;
 
@@ -919,6 +1093,8 @@ bool GSRendererSW::CheckTargetPages(const uint32* fb_pages, const uint32* zb_pag
 
 bool GSRendererSW::CheckSourcePages(SharedData* sd)
 {
+	bool res = false;
+
 	if (!m_rl->IsSynced())
 	{
 		for (size_t i = 0; sd->m_tex[i].t != NULL; i++)
@@ -927,19 +1103,15 @@ bool GSRendererSW::CheckSourcePages(SharedData* sd)
 
 			uint32* pages = m_tmp_pages; // sd->m_tex[i].t->m_pages.n;
 
-			for (const uint32* p = pages; *p != GSOffset::EOP; p++)
-			{
-				// TODO: 8H 4HL 4HH texture at the same place as the render target (24 bit, or 32-bit where the alpha channel is masked, Valkyrie Profile 2)
+			// TODO: 8H 4HL 4HH texture at the same place as the render target (24 bit, or 32-bit where the alpha channel is masked, Valkyrie Profile 2)
 
-				if (m_fzb_pages[*p]) // currently being drawn to? => sync
-				{
-					return true;
-				}
-			}
+			// currently being drawn to? => wait for those draws
+
+			res |= WaitPages(pages, false, 4);
 		}
 	}
 
-	return false;
+	return res;
 }
 
 #include "GSTextureSW.h"
@@ -1428,7 +1600,6 @@ GSRendererSW::SharedData::SharedData(GSRendererSW* parent)
 	, m_fpsm(0)
 	, m_zpsm(0)
 	, m_using_pages(false)
-	, m_syncpoint(SyncNone)
 {
 	m_tex[0].t = NULL;
 
@@ -1440,6 +1611,10 @@ GSRendererSW::SharedData::SharedData(GSRendererSW* parent)
 
 GSRendererSW::SharedData::~SharedData()
 {
+	// a draw without pixels for any worker still has to leave its textures decoded
+
+	WaitSource();
+
 	ReleasePages();
 
 	if (global.clut)
@@ -1451,7 +1626,7 @@ GSRendererSW::SharedData::~SharedData()
 	{
 		fprintf(s_fp, "[%d] done t=%lld p=%d | %d %d %d | %08x_%08x\n",
 			counter,
-			__rdtsc() - start, pixels,
+			__rdtsc() - start.load(), pixels.load(),
 			primclass, vertex_count, index_count,
 			global.sel.hi, global.sel.lo);
 		fflush(s_fp);
@@ -1535,11 +1710,19 @@ void GSRendererSW::SharedData::SetSource(GSTextureCacheSW::Texture* t, const GSV
 	m_tex[level + 1].t = NULL;
 }
 
+void GSRendererSW::SharedData::WaitSource()
+{
+	for (const auto& d : m_decode)
+	{
+		d->Run();
+	}
+}
+
 void GSRendererSW::SharedData::UpdateSource()
 {
 	for (size_t i = 0; m_tex[i].t != NULL; i++)
 	{
-		if (m_tex[i].t->Update(m_tex[i].r))
+		if (m_tex[i].t->Update(m_tex[i].r, m_decode))
 		{
 			global.tex[i] = m_tex[i].t->m_buff;
 		}
@@ -1555,6 +1738,8 @@ void GSRendererSW::SharedData::UpdateSource()
 
 	if (m_parent->s_dump)
 	{
+		WaitSource();
+
 		uint64 frame = m_parent->m_perfmon.GetFrame();
 
 		std::string s;
@@ -41,12 +41,7 @@ class GSRendererSW : public GSRenderer
 		int m_zpsm;
 		bool m_using_pages;
 		TextureLevel m_tex[7 + 1]; // NULL terminated
-		enum
-		{
-			SyncNone,
-			SyncSource,
-			SyncTarget
-		} m_syncpoint;
+		std::vector<std::shared_ptr<GSTextureCacheSW::Decode>> m_decode;
 
 	public:
 		SharedData(GSRendererSW* parent);
@@ -57,6 +52,7 @@ class GSRendererSW : public GSRenderer
 
 		void SetSource(GSTextureCacheSW::Texture* t, const GSVector4i& r, int level);
 		void UpdateSource();
+		void WaitSource();
 	};
 
 	typedef void (GSRendererSW::*ConvertVertexBufferPtr)(GSVertexSW* RESTRICT dst, const GSVertex* RESTRICT src, size_t count);
@@ -78,6 +74,28 @@ protected:
 	std::atomic<uint16> m_tex_pages[512];
 	uint32 m_tmp_pages[512 + 1];
 
+	// Page waits: instead of a full Sync, wait for the draws in flight using the pages only.
+	std::mutex m_pages_lock;
+	std::condition_variable m_pages_released;
+	std::atomic<bool> m_pages_waiting;
+
+	struct
+	{
+		uint64 syncs; // full barriers
+		uint64 waits; // page waits that blocked
+	} m_sync_stats[11]; // by reason + 1
+
+	// Jit warm-up: the selector keys used by a game are saved on exit and compiled on a
+	// background thread when it starts again, instead of during its first draws.
+	GSScanlineKeys m_keys;
+	uint32 m_keys_crc;
+	std::thread m_warmup;
+	std::atomic<bool> m_warmup_cancel;
+
+	void LoadKeys(uint32 crc);
+	void SaveKeys();
+	void StopWarmup();
+
 	void Reset();
 	void VSync(int field);
 	void ResetDevice();
@@ -87,6 +105,8 @@ protected:
 	void Draw();
 	void Queue(std::shared_ptr<GSRasterizerData>& item);
 	void Sync(int reason);
+	bool WaitPages(const uint32* pages, bool tex, int reason);
+	void PrintSyncStats();
 	void InvalidateVideoMem(const GIFRegBITBLTBUF& BITBLTBUF, const GSVector4i& r);
 	void InvalidateLocalMem(const GIFRegBITBLTBUF& BITBLTBUF, const GSVector4i& r, bool clut = false);
 
@@ -101,4 +121,6 @@ protected:
 public:
 	GSRendererSW(int threads);
 	virtual ~GSRendererSW();
+
+	void SetGameCRC(uint32 crc, int options);
 };
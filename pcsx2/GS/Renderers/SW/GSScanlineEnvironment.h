@@ -87,6 +87,8 @@ union GSScanlineSelector
 
 	uint64 key;
 
+	enum { Version = 1 }; // bump when the layout changes, the saved jit keys are dropped
+
 	GSScanlineSelector() = default;
 	GSScanlineSelector(uint64 k)
 		: key(k)
@@ -184,10 +184,16 @@ GSTextureCacheSW::Texture::~Texture()
 	}
 }
 
-bool GSTextureCacheSW::Texture::Update(const GSVector4i& rect)
+bool GSTextureCacheSW::Texture::Update(const GSVector4i& rect, std::vector<std::shared_ptr<Decode>>& decode)
 {
+	// the draw also waits for the decodes of earlier draws still running
+
+	m_decode.erase(std::remove_if(m_decode.begin(), m_decode.end(), [](const std::shared_ptr<Decode>& d) { return d->IsDone(); }), m_decode.end());
+
 	if (m_complete)
 	{
+		decode.insert(decode.end(), m_decode.begin(), m_decode.end());
+
 		return true;
 	}
 
@@ -221,20 +227,18 @@ bool GSTextureCacheSW::Texture::Update(const GSVector4i& rect)
 		}
 	}
 
-	GSLocalMemory& mem = m_state->m_mem;
-
 	const GSOffset* RESTRICT off = m_offset;
 
 	uint32 blocks = 0;
 
-	GSLocalMemory::readTextureBlock rtxbP = psm.rtxbP;
-
 	uint32 pitch = (1 << m_tw) << shift;
 
 	uint8* dst = (uint8*)m_buff + pitch * r.top;
 
 	int block_pitch = pitch * bs.y;
 
+	std::shared_ptr<Decode> d; // created with the first block that needs decoding
+
 	r = r.srl32(3);
 
 	bs.x >>= 3;
@@ -259,7 +263,10 @@ bool GSTextureCacheSW::Texture::Update(const GSVector4i& rect)
 				{
 					m_valid[row] |= col;
 
-					(mem.*rtxbP)(block, &dst[x << shift], pitch, m_TEXA);
+					if (!d)
+						d = std::make_shared<Decode>(m_state->m_mem, psm.rtxbP, m_buff, pitch, m_TEXA);
+
+					d->Add(block, &dst[x << shift]);
 
 					blocks++;
 				}
@@ -283,7 +290,10 @@ bool GSTextureCacheSW::Texture::Update(const GSVector4i& rect)
 				{
 					m_valid[row] |= col;
 
-					(mem.*rtxbP)(block, &dst[x << shift], pitch, m_TEXA);
+					if (!d)
+						d = std::make_shared<Decode>(m_state->m_mem, psm.rtxbP, m_buff, pitch, m_TEXA);
+
+					d->Add(block, &dst[x << shift]);
 
 					blocks++;
 				}
@@ -291,14 +301,84 @@ bool GSTextureCacheSW::Texture::Update(const GSVector4i& rect)
 		}
 	}
 
-	if (blocks > 0)
+	decode.insert(decode.end(), m_decode.begin(), m_decode.end());
+
+	if (blocks == 0)
 	{
-		m_state->m_perfmon.Put(GSPerfMon::Unswizzle, bs.x * bs.y * blocks << shift);
+		return true;
 	}
 
+	d->Close();
+
+	m_decode.push_back(d);
+	decode.push_back(d);
+
+	m_state->m_perfmon.Put(GSPerfMon::Unswizzle, bs.x * bs.y * blocks << shift);
+
 	return true;
 }
 
+GSTextureCacheSW::Decode::Decode(GSLocalMemory& mem, GSLocalMemory::readTextureBlock rtxbP, void* buff, int pitch, const GIFRegTEXA& TEXA)
+	: m_mem(mem)
+	, m_rtxbP(rtxbP)
+	, m_buff((uint8*)buff)
+	, m_pitch(pitch)
+	, m_TEXA(TEXA)
+	, m_next(0)
+	, m_done(0)
+{
+	m_jobs.push_back(0);
+}
+
+void GSTextureCacheSW::Decode::Close()
+{
+	// group the blocks by page, a page is decoded by a single job
+
+	std::sort(m_blocks.begin(), m_blocks.end(), [](const Block& a, const Block& b) { return a.block < b.block; });
+
+	m_jobs.clear();
+
+	for (size_t i = 0; i < m_blocks.size(); i++)
+	{
+		if (i == 0 || (m_blocks[i].block >> 5) != (m_blocks[i - 1].block >> 5))
+		{
+			m_jobs.push_back((uint32)i);
+		}
+	}
+
+	m_jobs.push_back((uint32)m_blocks.size());
+}
+
+void GSTextureCacheSW::Decode::Run()
+{
+	uint32 count = (uint32)m_jobs.size() - 1;
+
+	for (uint32 i = m_next++; i < count; i = m_next++)
+	{
+		for (uint32 j = m_jobs[i]; j < m_jobs[i + 1]; j++)
+		{
+			(m_mem.*m_rtxbP)(m_blocks[j].block, m_buff + m_blocks[j].offset, m_pitch, m_TEXA);
+		}
+
+		if (++m_done == count)
+		{
+			{
+				std::lock_guard<std::mutex> wait_guard(m_wait_lock);
+			}
+			m_finished.notify_all();
+		}
+	}
+
+	// the other pages are being decoded by the workers which claimed them
+
+	if (m_done == count)
+		return;
+
+	std::unique_lock<std::mutex> l(m_wait_lock);
+	while (m_done < count)
+		m_finished.wait(l);
+}
+
 #include "GSTextureSW.h"
 
 bool GSTextureCacheSW::Texture::Save(const std::string& fn, bool dds) const
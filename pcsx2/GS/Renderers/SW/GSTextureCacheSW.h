@@ -21,6 +21,38 @@
 class GSTextureCacheSW
 {
 public:
+	// The blocks a texture update marked valid, decoded later by the rasterizer workers
+	// drawing with the texture. A job is one page, they are claimed by whoever waits.
+	class Decode
+	{
+		struct Block
+		{
+			uint32 block;
+			uint32 offset; // in the texture buffer
+		};
+
+		GSLocalMemory& m_mem;
+		GSLocalMemory::readTextureBlock m_rtxbP;
+		uint8* m_buff;
+		int m_pitch;
+		GIFRegTEXA m_TEXA;
+		std::vector<Block> m_blocks;
+		std::vector<uint32> m_jobs; // first block of each page, and the end
+		std::atomic<uint32> m_next;
+		std::atomic<uint32> m_done;
+		std::mutex m_wait_lock;
+		std::condition_variable m_finished;
+
+	public:
+		Decode(GSLocalMemory& mem, GSLocalMemory::readTextureBlock rtxbP, void* buff, int pitch, const GIFRegTEXA& TEXA);
+
+		void Add(uint32 block, const uint8* dst) { m_blocks.push_back({block, (uint32)(dst - m_buff)}); }
+		void Close();
+		bool IsDone() const { return m_done == m_jobs.size() - 1; }
+
+		void Run();
+	};
+
 	class Texture
 	{
 	public:
@@ -38,6 +70,7 @@ public:
 		std::array<uint16, MAX_PAGES> m_erase_it;
 		struct { uint32 bm[16]; const uint32* n; } m_pages;
 		const uint32* RESTRICT m_sharedbits;
+		std::vector<std::shared_ptr<Decode>> m_decode; // not done yet when last checked
 
 		// m_valid
 		// fast mode: each uint32 bits map to the 32 blocks of that page
@@ -46,7 +79,7 @@ public:
 		Texture(GSState* state, uint32 tw0, const GIFRegTEX0& TEX0, const GIFRegTEXA& TEXA);
 		virtual ~Texture();
 
-		bool Update(const GSVector4i& r);
+		bool Update(const GSVector4i& r, std::vector<std::shared_ptr<Decode>>& decode);
 		bool Save(const std::string& fn, bool dds = false) const;
 	};
 
@@ -176,8 +176,9 @@ struct Gif_Path_MTVU
 	GS_Packet fakePacket;
 	// Set a size based on MTGS but keep a factor 2 to avoid too waste to much
 	// memory overhead. Note the struct is instantied 3 times (for each gif
-	// path)
-	ringbuffer_base<GS_Packet, RingBufferSize / 2> gsPackQueue;
+	// path). Sized from the default ring, a larger configured ring only makes
+	// the (rare) push spin more often.
+	ringbuffer_base<GS_Packet, (1 << RingBufferSizeFactorDefault) / 2> gsPackQueue;
 	Gif_Path_MTVU() { Reset(); }
 	void Reset()
 	{
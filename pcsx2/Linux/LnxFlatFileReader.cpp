@@ -15,12 +15,23 @@
 
 #include "PrecompiledHeader.h"
 #include "AsyncFileReader.h"
+#include "LnxIoUring.h"
+#include "CDVD/IsoFileFormats.h"
+
+// Reads larger than the uring pool fall back to libaio, keep the whole read window in it
+static_assert(IoUringReader::QueueDepth * IoUringReader::BufferSize - IoUringReader::Alignment >= InputIsoFile::MaxReadSize,
+	"io_uring buffers can't hold the largest ISO read window");
 
 FlatFileReader::FlatFileReader(bool shareWrite) : shareWrite(shareWrite)
 {
 	m_blocksize = 2048;
 	m_fd = -1;
 	m_aio_context = 0;
+	m_uring = nullptr;
+	m_uring_pending = false;
+	m_uring_dst = nullptr;
+	m_uring_offset = 0;
+	m_uring_size = 0;
 }
 
 FlatFileReader::~FlatFileReader(void)
@@ -36,8 +47,21 @@ bool FlatFileReader::Open(const wxString& fileName)
 	if (err) return false;
 
     m_fd = wxOpen(fileName, O_RDONLY, 0);
+	if (m_fd == -1)
+		return false;
 
-	return (m_fd != -1);
+	m_uring = new IoUringReader();
+	if (m_uring->Open(fileName.ToUTF8(), EmuConfig.CdvdDirectIO))
+	{
+		DevCon.WriteLn(L"FlatFileReader: using io_uring%s", m_uring->IsDirect() ? L" (O_DIRECT)" : L"");
+	}
+	else
+	{
+		delete m_uring;
+		m_uring = nullptr;
+	}
+
+	return true;
 }
 
 int FlatFileReader::ReadSync(void* pBuffer, uint sector, uint count)
@@ -53,6 +77,16 @@ void FlatFileReader::BeginRead(void* pBuffer, uint sector, uint count)
 
 	u32 bytesToRead = count * m_blocksize;
 
+	// Falls through to libaio for oversized reads, or if the ring gave up.
+	if (m_uring && bytesToRead <= m_uring->GetMaxReadSize() && m_uring->Submit(pBuffer, offset, bytesToRead))
+	{
+		m_uring_pending = true;
+		m_uring_dst = pBuffer;
+		m_uring_offset = offset;
+		m_uring_size = bytesToRead;
+		return;
+	}
+
 	struct iocb iocb;
 	struct iocb* iocbs = &iocb;
 
@@ -62,6 +96,18 @@ void FlatFileReader::BeginRead(void* pBuffer, uint sector, uint count)
 
 int FlatFileReader::FinishRead(void)
 {
+	if (m_uring_pending)
+	{
+		m_uring_pending = false;
+		int ret = m_uring->Complete();
+		if (ret >= 0)
+			return ret;
+
+		// The ring failed the read, that's no reason to fail the emulated drive
+		ssize_t got = pread(m_fd, m_uring_dst, m_uring_size, m_uring_offset);
+		return got < 0 ? -1 : (int)got;
+	}
+
 	int min_nr = 1;
 	int max_nr = 1;
 	struct io_event events[max_nr];
@@ -76,6 +122,12 @@ int FlatFileReader::FinishRead(void)
 
 void FlatFileReader::CancelRead(void)
 {
+	if (m_uring_pending)
+	{
+		m_uring->Cancel();
+		m_uring_pending = false;
+	}
+
 	// Will be done when m_aio_context context is destroyed
 	// Note: io_cancel exists but need the iocb structure as parameter
 	// int io_cancel(aio_context_t ctx_id, struct iocb *iocb,
@@ -84,6 +136,9 @@ void FlatFileReader::CancelRead(void)
 
 void FlatFileReader::Close(void)
 {
+	delete m_uring;
+	m_uring = nullptr;
+	m_uring_pending = false;
 
 	if (m_fd != -1) close(m_fd);
 
@@ -0,0 +1,397 @@
+/*  PCSX2 - PS2 Emulator for PCs
+ *  Copyright (C) 2002-2021  PCSX2 Dev Team
+ *
+ *  PCSX2 is free software: you can redistribute it and/or modify it under the terms
+ *  of the GNU Lesser General Public License as published by the Free Software Found-
+ *  ation, either version 3 of the License, or (at your option) any later version.
+ *
+ *  PCSX2 is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ *  without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ *  PURPOSE.  See the GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along with PCSX2.
+ *  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "PrecompiledHeader.h"
+#include "LnxIoUring.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+#if defined(__has_include)
+#if __has_include(<linux/io_uring.h>)
+#define HAS_IO_URING
+#include <linux/io_uring.h>
+#endif
+#endif
+
+#ifdef HAS_IO_URING
+
+// Older C libraries don't have the numbers yet, they're the same on every arch but alpha.
+#ifndef __NR_io_uring_setup
+#define __NR_io_uring_setup 425
+#endif
+#ifndef __NR_io_uring_enter
+#define __NR_io_uring_enter 426
+#endif
+#ifndef __NR_io_uring_register
+#define __NR_io_uring_register 427
+#endif
+
+IoUringReader::IoUringReader()
+	: m_ring_fd(-1)
+	, m_direct_fd(-1)
+	, m_fd(-1)
+	, m_sq_ring(nullptr)
+	, m_cq_ring(nullptr)
+	, m_sq_ring_size(0)
+	, m_cq_ring_size(0)
+	, m_sqes(nullptr)
+	, m_sqes_size(0)
+	, m_buffers(nullptr)
+	, m_registered(false)
+	, m_pending(0)
+	, m_submitted(0)
+	, m_dst(nullptr)
+	, m_offset(0)
+	, m_size(0)
+{
+}
+
+IoUringReader::~IoUringReader()
+{
+	Close();
+}
+
+bool IoUringReader::Open(const char* filename, bool direct)
+{
+	Close();
+
+	m_fd = open(filename, O_RDONLY | O_CLOEXEC);
+	if (m_fd == -1)
+		return false;
+
+	// Only when asked for. Not every file system takes O_DIRECT (tmpfs doesn't), the
+	// page cache will do then.
+	if (direct)
+		m_direct_fd = open(filename, O_RDONLY | O_CLOEXEC | O_DIRECT);
+
+	if (!MapRings())
+	{
+		Close();
+		return false;
+	}
+
+	m_buffers = (u8*)mmap(nullptr, QueueDepth * BufferSize, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	if (m_buffers == MAP_FAILED)
+	{
+		m_buffers = nullptr;
+		Close();
+		return false;
+	}
+
+	// Registering pins the buffers, which can exceed RLIMIT_MEMLOCK on older kernels.
+	// Plain reads to the same buffers work too, just with a bit more overhead.
+	struct iovec iovecs[QueueDepth];
+	for (u32 i = 0; i < QueueDepth; i++)
+	{
+		iovecs[i].iov_base = m_buffers + i * BufferSize;
+		iovecs[i].iov_len = BufferSize;
+	}
+	m_registered = syscall(__NR_io_uring_register, m_ring_fd, IORING_REGISTER_BUFFERS, iovecs, QueueDepth) == 0;
+
+	return true;
+}
+
+bool IoUringReader::MapRings()
+{
+	struct io_uring_params params;
+	memset(&params, 0, sizeof(params));
+
+	m_ring_fd = syscall(__NR_io_uring_setup, QueueDepth, &params);
+	if (m_ring_fd < 0)
+	{
+		m_ring_fd = -1;
+		return false;
+	}
+
+	m_sq_ring_size = params.sq_off.array + params.sq_entries * sizeof(u32);
+	m_cq_ring_size = params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe);
+	const bool single = (params.features & IORING_FEAT_SINGLE_MMAP) != 0;
+	if (single)
+		m_sq_ring_size = m_cq_ring_size = std::max(m_sq_ring_size, m_cq_ring_size);
+
+	m_sq_ring = mmap(nullptr, m_sq_ring_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, m_ring_fd, IORING_OFF_SQ_RING);
+	if (m_sq_ring == MAP_FAILED)
+	{
+		m_sq_ring = nullptr;
+		return false;
+	}
+
+	if (single)
+	{
+		m_cq_ring = m_sq_ring;
+	}
+	else
+	{
+		m_cq_ring = mmap(nullptr, m_cq_ring_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, m_ring_fd, IORING_OFF_CQ_RING);
+		if (m_cq_ring == MAP_FAILED)
+		{
+			m_cq_ring = nullptr;
+			return false;
+		}
+	}
+
+	m_sqes_size = params.sq_entries * sizeof(struct io_uring_sqe);
+	m_sqes = (io_uring_sqe*)mmap(nullptr, m_sqes_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, m_ring_fd, IORING_OFF_SQES);
+	if (m_sqes == MAP_FAILED)
+	{
+		m_sqes = nullptr;
+		return false;
+	}
+
+	u8* sq = (u8*)m_sq_ring;
+	m_sq_head = (u32*)(sq + params.sq_off.head);
+	m_sq_tail = (u32*)(sq + params.sq_off.tail);
+	m_sq_mask = (u32*)(sq + params.sq_off.ring_mask);
+	m_sq_array = (u32*)(sq + params.sq_off.array);
+
+	u8* cq = (u8*)m_cq_ring;
+	m_cq_head = (u32*)(cq + params.cq_off.head);
+	m_cq_tail = (u32*)(cq + params.cq_off.tail);
+	m_cq_mask = (u32*)(cq + params.cq_off.ring_mask);
+	m_cqes = (io_uring_cqe*)(cq + params.cq_off.cqes);
+
+	return true;
+}
+
+void IoUringReader::Close()
+{
+	// Closing the ring cancels whatever is still in flight.
+	if (m_sqes)
+		munmap(m_sqes, m_sqes_size);
+	if (m_cq_ring && m_cq_ring != m_sq_ring)
+		munmap(m_cq_ring, m_cq_ring_size);
+	if (m_sq_ring)
+		munmap(m_sq_ring, m_sq_ring_size);
+	m_sqes = nullptr;
+	m_cq_ring = m_sq_ring = nullptr;
+
+	if (m_ring_fd != -1)
+		close(m_ring_fd);
+	if (m_direct_fd != -1)
+		close(m_direct_fd);
+	if (m_fd != -1)
+		close(m_fd);
+	m_ring_fd = m_direct_fd = m_fd = -1;
+
+	if (m_buffers)
+		munmap(m_buffers, QueueDepth * BufferSize);
+	m_buffers = nullptr;
+	m_registered = false;
+
+	m_pending = m_submitted = 0;
+}
+
+bool IoUringReader::Enter(u32 submit, u32 wait)
+{
+	while (true)
+	{
+		int ret = syscall(__NR_io_uring_enter, m_ring_fd, submit, wait, wait ? IORING_ENTER_GETEVENTS : 0, nullptr, 0);
+		if (ret >= 0)
+		{
+			if ((u32)ret >= submit)
+				return true;
+			submit -= ret;
+		}
+		else if (errno != EINTR && errno != EAGAIN)
+		{
+			return false;
+		}
+	}
+}
+
+bool IoUringReader::Submit(void* dst, u64 offset, u32 size)
+{
+	if (!IsOpen() || m_submitted || size == 0 || size > GetMaxReadSize())
+		return false;
+
+	// The aligned range around the request, split over the buffers.
+	const u64 start = offset & ~(u64)(Alignment - 1);
+	const u64 end = (offset + size + Alignment - 1) & ~(u64)(Alignment - 1);
+	const u32 mask = *m_sq_mask;
+	u32 tail = *m_sq_tail;
+	u32 count = 0;
+
+	for (u64 pos = start; pos < end; pos += BufferSize, count++)
+	{
+		Slot& slot = m_slots[count];
+		slot.offset = pos;
+		slot.size = (u32)std::min<u64>(BufferSize, end - pos);
+		slot.result = 0;
+
+		const u32 index = tail & mask;
+		io_uring_sqe* sqe = &m_sqes[index];
+		memset(sqe, 0, sizeof(*sqe));
+		sqe->opcode = m_registered ? IORING_OP_READ_FIXED : IORING_OP_READV;
+		sqe->fd = IsDirect() ? m_direct_fd : m_fd;
+		sqe->off = pos;
+		sqe->user_data = count;
+		if (m_registered)
+		{
+			sqe->addr = (u64)(uptr)(m_buffers + count * BufferSize);
+			sqe->len = slot.size;
+			sqe->buf_index = count;
+		}
+		else
+		{
+			m_iovecs[count].iov_base = m_buffers + count * BufferSize;
+			m_iovecs[count].iov_len = slot.size;
+			sqe->addr = (u64)(uptr)&m_iovecs[count];
+			sqe->len = 1;
+		}
+		m_sq_array[index] = index;
+		tail++;
+	}
+
+	__atomic_store_n(m_sq_tail, tail, __ATOMIC_RELEASE);
+
+	m_pending = m_submitted = count;
+	m_dst = (u8*)dst;
+	m_offset = offset;
+	m_size = size;
+
+	if (!Enter(count, 0))
+	{
+		// Something is wrong with the ring, let the caller use its usual path from now on.
+		Close();
+		return false;
+	}
+	return true;
+}
+
+// Finishes a slot with plain reads, after a short read or an error (like O_DIRECT
+// being refused by the file system after all).
+int IoUringReader::ReadFallback(u32 slot, u32 done)
+{
+	Slot& s = m_slots[slot];
+	u8* buffer = m_buffers + slot * BufferSize;
+
+	while (done < s.size)
+	{
+		ssize_t ret = pread(m_fd, buffer + done, s.size - done, s.offset + done);
+		if (ret < 0)
+		{
+			if (errno == EINTR)
+				continue;
+			return done ? (int)done : -1;
+		}
+		if (ret == 0)
+			break; // EOF
+		done += ret;
+	}
+	return done;
+}
+
+bool IoUringReader::Reap()
+{
+	while (m_pending)
+	{
+		u32 head = *m_cq_head;
+		const u32 tail = __atomic_load_n(m_cq_tail, __ATOMIC_ACQUIRE);
+
+		if (head == tail)
+		{
+			if (!Enter(0, 1))
+				break;
+			continue;
+		}
+
+		const u32 mask = *m_cq_mask;
+		for (; head != tail; head++)
+		{
+			const io_uring_cqe& cqe = m_cqes[head & mask];
+			if (cqe.user_data < m_submitted)
+			{
+				m_slots[cqe.user_data].result = cqe.res;
+				m_pending--;
+			}
+		}
+		__atomic_store_n(m_cq_head, head, __ATOMIC_RELEASE);
+	}
+
+	if (m_pending)
+	{
+		// Lost track of the ring, the buffers can't be trusted anymore.
+		Close();
+		return false;
+	}
+	return true;
+}
+
+void IoUringReader::Cancel()
+{
+	// The reads are short, waiting for them is simpler than IORING_OP_ASYNC_CANCEL.
+	if (m_submitted && Reap())
+		m_submitted = 0;
+}
+
+int IoUringReader::Complete()
+{
+	if (!m_submitted || !Reap())
+		return -1;
+
+	int total = 0;
+	for (u32 i = 0; i < m_submitted; i++)
+	{
+		const Slot& slot = m_slots[i];
+		int got = slot.result;
+		if (got < (int)slot.size)
+			got = ReadFallback(i, std::max(got, 0));
+		if (got < 0)
+		{
+			m_submitted = 0;
+			return total ? total : -1;
+		}
+
+		// The part of the slot which is in the request
+		const u64 from = std::max(slot.offset, m_offset);
+		const u64 to = std::min(slot.offset + got, m_offset + m_size);
+		if (to > from)
+		{
+			memcpy(m_dst + (from - m_offset), m_buffers + i * BufferSize + (from - slot.offset), to - from);
+			total += to - from;
+		}
+
+		if (got < (int)slot.size)
+			break; // EOF
+	}
+
+	m_submitted = 0;
+	return total;
+}
+
+#else
+
+// No io_uring headers at build time: always fall back.
+IoUringReader::IoUringReader()
+	: m_ring_fd(-1)
+	, m_direct_fd(-1)
+	, m_fd(-1)
+{
+}
+IoUringReader::~IoUringReader() {}
+bool IoUringReader::Open(const char* filename, bool direct) { return false; }
+void IoUringReader::Close() {}
+bool IoUringReader::Submit(void* dst, u64 offset, u32 size) { return false; }
+void IoUringReader::Cancel() {}
+int IoUringReader::Complete() { return -1; }
+
+#endif
@@ -0,0 +1,108 @@
+/*  PCSX2 - PS2 Emulator for PCs
+ *  Copyright (C) 2002-2021  PCSX2 Dev Team
+ *
+ *  PCSX2 is free software: you can redistribute it and/or modify it under the terms
+ *  of the GNU Lesser General Public License as published by the Free Software Found-
+ *  ation, either version 3 of the License, or (at your option) any later version.
+ *
+ *  PCSX2 is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ *  without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ *  PURPOSE.  See the GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along with PCSX2.
+ *  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include "Pcsx2Types.h"
+#include <sys/uio.h>
+
+struct io_uring_sqe;
+struct io_uring_cqe;
+
+// --------------------------------------------------------------------------------------
+//  IoUringReader
+// --------------------------------------------------------------------------------------
+// Reads a file through io_uring, with raw system calls so there's no dependency on
+// liburing. There is a single read in flight at a time; it is split into up to
+// QueueDepth pieces over a fixed pool of registered, page aligned buffers, and the
+// pieces are submitted together. The aligned buffers also allow O_DIRECT on request,
+// bypassing the page cache (off by default, the cache helps repeated reads).
+//
+// Open() fails when io_uring isn't available (old kernel, or blocked by seccomp), in
+// which case the caller is expected to keep using its usual path.
+//
+class IoUringReader
+{
+public:
+	static const u32 QueueDepth = 16;
+	static const u32 BufferSize = 128 * 1024;
+	static const u32 Alignment = 4096;
+
+	IoUringReader();
+	~IoUringReader();
+
+	bool Open(const char* filename, bool direct);
+	void Close();
+
+	bool IsOpen() const { return m_ring_fd != -1; }
+	bool IsDirect() const { return m_direct_fd != -1; }
+
+	// Largest read Submit() accepts, whatever its alignment.
+	u32 GetMaxReadSize() const { return QueueDepth * BufferSize - Alignment; }
+
+	// Queues the read of [offset, offset + size) to dst. One read at a time.
+	bool Submit(void* dst, u64 offset, u32 size);
+	// Waits for the submitted read, returns the number of bytes read, or -1.
+	int Complete();
+	// Waits for the submitted read without touching dst.
+	void Cancel();
+
+private:
+	bool MapRings();
+	bool Enter(u32 submit, u32 wait);
+	bool Reap();
+	int ReadFallback(u32 slot, u32 done);
+
+	int m_ring_fd;
+	int m_direct_fd;
+	int m_fd;
+
+	// Ring mappings
+	void* m_sq_ring;
+	void* m_cq_ring;
+	size_t m_sq_ring_size;
+	size_t m_cq_ring_size;
+	io_uring_sqe* m_sqes;
+	size_t m_sqes_size;
+
+	u32* m_sq_head;
+	u32* m_sq_tail;
+	u32* m_sq_mask;
+	u32* m_sq_array;
+	u32* m_cq_head;
+	u32* m_cq_tail;
+	u32* m_cq_mask;
+	io_uring_cqe* m_cqes;
+
+	// Registered buffers, QueueDepth * BufferSize
+	u8* m_buffers;
+	bool m_registered;
+	// Only used when the buffers couldn't be registered
+	struct iovec m_iovecs[QueueDepth];
+
+	// The read in flight
+	struct Slot
+	{
+		u64 offset;
+		u32 size;
+		int result;
+	};
+	Slot m_slots[QueueDepth];
+	u32 m_pending;
+	u32 m_submitted;
+	u8* m_dst;
+	u64 m_offset;
+	u32 m_size;
+};
@@ -30,6 +30,9 @@
 #else
 #include "PAD/Linux/PAD.h"
 #endif
+#ifdef __linux__
+#include <sys/mman.h>
+#endif
 
 
 // Uncomment this to enable profiling of the GS RingBufferCopy function.
@@ -51,9 +54,113 @@ using namespace Threading;
 // =====================================================================================================
 
 __aligned(32) MTGS_BufferedData RingBuffer;
+uint RingBufferSize = 1 << RingBufferSizeFactorDefault;
+uint RingBufferMask = RingBufferSize - 1;
 extern bool renderswitch;
 std::atomic_bool init_gspanel = true;
 
+// Set when the ring came from mmap rather than _aligned_malloc
+static bool s_RingBufferMapped = false;
+
+// Allocates the ring when the MTGS starts, sized from the GS options.  On Linux it is aligned
+// to and advised for transparent huge pages: both threads sweep through the whole ring, which
+// a few 2MB pages cover instead of thousands of 4KB TLB entries.
+static void AllocRingBuffer()
+{
+	if (RingBuffer.m_Ring)
+		return;
+
+	const uint factor = std::min(std::max((uint)EmuConfig.GS.MTGSRingSizeFactor, RingBufferSizeFactorMin), RingBufferSizeFactorMax);
+	RingBufferSize = 1u << factor;
+	RingBufferMask = RingBufferSize - 1;
+	const size_t bytes = RingBufferSize * sizeof(u128);
+
+#ifdef __linux__
+	const size_t hugePage = 2 * _1mb;
+	const size_t mapped = bytes + hugePage;
+	u8* base = (u8*)mmap(NULL, mapped, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	if (base != MAP_FAILED)
+	{
+		u8* ring = (u8*)(((uptr)base + hugePage - 1) & ~(uptr)(hugePage - 1));
+		if (ring != base)
+			munmap(base, ring - base);
+		if (ring + bytes != base + mapped)
+			munmap(ring + bytes, (base + mapped) - (ring + bytes));
+		if (madvise(ring, bytes, MADV_HUGEPAGE) != 0)
+			DevCon.Warning("MTGS: Transparent huge pages are unavailable for the ring buffer.");
+		RingBuffer.m_Ring = (u128*)ring;
+		s_RingBufferMapped = true;
+	}
+#endif
+	if (!RingBuffer.m_Ring)
+		RingBuffer.m_Ring = (u128*)_aligned_malloc(bytes, 64);
+	if (!RingBuffer.m_Ring)
+		throw Exception::OutOfMemory(L"MTGS ring buffer")
+			.SetDiagMsg(pxsFmt(L"%u bytes", (uint)bytes));
+
+	DevCon.WriteLn("MTGS: Ring buffer is %u KB.", (uint)(bytes / _1kb));
+}
+
+static void FreeRingBuffer()
+{
+	if (!RingBuffer.m_Ring)
+		return;
+
+#ifdef __linux__
+	if (s_RingBufferMapped)
+		munmap(RingBuffer.m_Ring, RingBufferSize * sizeof(u128));
+	else
+#endif
+		_aligned_free(RingBuffer.m_Ring);
+
+	RingBuffer.m_Ring = NULL;
+	s_RingBufferMapped = false;
+}
+
+// How long each side polls the ring before falling back to a semaphore sleep.  The other
+// side usually catches up within a few microseconds, which is far cheaper than a kernel
+// round trip on both threads.
+static const uint MTGS_EESpinMicroseconds = 50;
+static const uint MTGS_GSSpinMicroseconds = 20;
+
+// Largest GS packet command built by merging back to back packets, so a held back command
+// doesn't keep a busy MTGS waiting for too long.
+static const uint MTGS_MaxCoalescedBytes = _64kb;
+
+static __fi u64 MicrosecondsToTicks(uint us)
+{
+	return GetTickFrequency() * us / 1000000;
+}
+
+// Polls cond for up to 'ticks' CPU ticks; returns true if it became true.
+template <typename Cond>
+static __fi bool SpinUntil(u64 ticks, Cond cond)
+{
+	const u64 end = GetCPUTicks() + ticks;
+	do
+	{
+		if (cond())
+			return true;
+		SpinWait();
+	} while (GetCPUTicks() < end);
+	return cond();
+}
+
+static __fi uint RingFreeRoom(uint writepos, uint readpos)
+{
+	return (writepos < readpos) ? readpos - writepos : RingBufferSize - (writepos - readpos);
+}
+
+// Adds the time elapsed since startTicks to a log2 microsecond histogram (see MTGS_Stats).
+static void RecordWaitTime(std::atomic<u64>* hist, u64 startTicks)
+{
+	const u64 us = (GetCPUTicks() - startTicks) * 1000000 / GetTickFrequency();
+	uint bucket = 0;
+	while (bucket < MTGS_Stats::TimeBuckets - 1 && (us >> bucket) != 0)
+		bucket++;
+	hist[bucket].fetch_add(1, std::memory_order_relaxed);
+}
+
 
 #ifdef RINGBUF_DEBUG_STACK
 #include <list>
@@ -109,13 +216,17 @@ protected:
 
 void SysMtgsThread::OnStart()
 {
+	AllocRingBuffer();
+
 	m_Opened = false;
 
 	m_ReadPos = 0;
 	m_WritePos = 0;
+	m_CachedReadPos = 0;
 	m_RingBufferIsBusy = false;
 	m_packet_size = 0;
 	m_packet_writepos = 0;
+	m_PendingGSPacket = false;
 
 	m_QueuedFrameCount = 0;
 	m_VsyncSignalListener = false;
@@ -124,6 +235,8 @@ void SysMtgsThread::OnStart()
 
 	m_CopyDataTally = 0;
 
+	ResetStats();
+
 	_parent::OnStart();
 }
 
@@ -143,6 +256,7 @@ void SysMtgsThread::OnResumeReady()
 
 void SysMtgsThread::ResetGS()
 {
+	FlushGSPacket();
 	pxAssertDev(!IsOpen() || (m_ReadPos == m_WritePos), "Must close or terminate the GS thread prior to gsReset.");
 
 	// MTGS Reset process:
@@ -151,6 +265,7 @@ void SysMtgsThread::ResetGS()
 	//  * clear the path and byRegs structs (used by GIFtagDummy)
 
 	m_ReadPos = m_WritePos.load();
+	m_CachedReadPos = m_ReadPos.load();
 	m_QueuedFrameCount = 0;
 	m_VsyncSignalListener = 0;
 
@@ -191,6 +306,9 @@ void SysMtgsThread::PostVsyncStart()
 	if (m_CopyDataTally != 0)
 		SetEvent();
 
+	const uint occupancy = (m_WritePos.load(std::memory_order_relaxed) - m_ReadPos.load(std::memory_order_relaxed)) & RingBufferMask;
+	m_StatOccupancy[occupancy / (RingBufferSize / MTGS_Stats::OccupancyBuckets)].fetch_add(1, std::memory_order_relaxed);
+
 	// If the MTGS is allowed to queue a lot of frames in advance, it creates input lag.
 	// Use the Queued FrameCount to stall the EE if another vsync (or two) are already queued
 	// in the ringbuffer.  The queue limit is disabled when both FrameLimiting and Vsync are
@@ -310,6 +428,7 @@ void SysMtgsThread::ExecuteTaskInThread()
 #endif
 
 	RingBufferLock busy(*this);
+	const u64 spinTicks = MicrosecondsToTicks(MTGS_GSSpinMicroseconds);
 
 	while (true)
 	{
@@ -319,15 +438,35 @@ void SysMtgsThread::ExecuteTaskInThread()
 		// is very optimized (only 1 instruction test in most cases), so no point in trying
 		// to avoid it.
 
-		m_sem_event.WaitWithoutYield();
+		// Poll for a new packet before sleeping.  If one shows up, the EE's SetEvent posts are
+		// drained: each one left on the semaphore would cost an empty pass, spin included.
+		// Only this thread waits on it, so a positive count never blocks.
+		const u64 idleStart = GetCPUTicks();
+		if (SpinUntil(spinTicks, [&] { return m_WritePos.load(std::memory_order_relaxed) != m_ReadPos.load(std::memory_order_relaxed); }))
+		{
+			while (m_sem_event.Count() > 0)
+				m_sem_event.WaitWithoutYield();
+		}
+		else
+			m_sem_event.WaitWithoutYield();
+		RecordWaitTime(m_StatGSIdle, idleStart);
 		StateCheckInThread();
 		busy.Acquire();
 
 		// note: m_ReadPos is intentionally not volatile, because it should only
 		// ever be modified by this thread.
-		while (m_ReadPos.load(std::memory_order_relaxed) != m_WritePos.load(std::memory_order_acquire))
+		// m_WritePos (the EE's cache line) is only reloaded once everything it
+		// published before has been processed.
+		unsigned int local_WritePos = m_WritePos.load(std::memory_order_acquire);
+		while (true)
 		{
 			const unsigned int local_ReadPos = m_ReadPos.load(std::memory_order_relaxed);
+			if (local_ReadPos == local_WritePos)
+			{
+				local_WritePos = m_WritePos.load(std::memory_order_acquire);
+				if (local_ReadPos == local_WritePos)
+					break;
+			}
 
 			pxAssert(local_ReadPos < RingBufferSize);
 
@@ -597,6 +736,8 @@ void SysMtgsThread::CloseGS()
 	if (!m_Opened || GSDump::isRunning)
 		return;
 	m_Opened = false;
+	LogStats();
+	ResetStats();
 	GSclose();
 	if (init_gspanel)
 		sApp.CloseGsPanel();
@@ -619,6 +760,8 @@ void SysMtgsThread::OnResumeInThread(bool isSuspended)
 void SysMtgsThread::OnCleanupInThread()
 {
 	CloseGS();
+	// Nothing reads or writes the ring once the thread is gone, the next start allocates it again
+	FreeRingBuffer();
 	_parent::OnCleanupInThread();
 }
 
@@ -635,6 +778,10 @@ void SysMtgsThread::WaitGS(bool syncRegs, bool weakWait, bool isMTVU)
 	if (!pxAssertDev(IsOpen(), "MTGS Warning!  WaitGS issued on a closed thread."))
 		return;
 
+	// The MTVU thread can't publish the EE's pending packet, and never waits on it either
+	if (!isMTVU)
+		FlushGSPacket();
+
 	Gif_Path& path = gifUnit.gifPath[GIF_PATH_1];
 	u32 startP1Packs = weakWait ? path.GetPendingGSPackets() : 0;
 
@@ -643,27 +790,40 @@ void SysMtgsThread::WaitGS(bool syncRegs, bool weakWait, bool isMTVU)
 
 	if (isMTVU || m_ReadPos.load(std::memory_order_relaxed) != m_WritePos.load(std::memory_order_relaxed))
 	{
-		SetEvent();
+		const u64 waitStart = GetCPUTicks();
+		SetEvent(isMTVU);
 		RethrowException();
-		for (;;)
+
+		// A full sync usually finishes quickly, so poll before blocking on the busy mutex.
+		if (!isMTVU && !weakWait && SpinUntil(MicrosecondsToTicks(MTGS_EESpinMicroseconds),
+				[&] { return m_ReadPos.load(std::memory_order_acquire) == m_WritePos.load(std::memory_order_relaxed); }))
 		{
-			if (weakWait)
-				m_mtx_RingBufferBusy2.Wait();
-			else
-				m_mtx_RingBufferBusy.Wait();
-			RethrowException();
-			if (!isMTVU && m_ReadPos.load(std::memory_order_relaxed) == m_WritePos.load(std::memory_order_relaxed))
-				break;
-			u32 curP1Packs = weakWait ? path.GetPendingGSPackets() : 0;
-			if (weakWait && ((startP1Packs - curP1Packs) || !curP1Packs))
-				break;
-			// On weakWait we will stop waiting on the MTGS thread if the
-			// MTGS thread has processed a vu1 xgkick packet, or is pending on
-			// its final vu1 xgkick packet (!curP1Packs)...
-			// Note: m_WritePos doesn't seem to have proper atomic write
-			// code, so reading it from the MTVU thread might be dangerous;
-			// hence it has been avoided...
+			m_StatEESpinWaits.fetch_add(1, std::memory_order_relaxed);
 		}
+		else
+		{
+			m_StatEESleepWaits.fetch_add(1, std::memory_order_relaxed);
+			for (;;)
+			{
+				if (weakWait)
+					m_mtx_RingBufferBusy2.Wait();
+				else
+					m_mtx_RingBufferBusy.Wait();
+				RethrowException();
+				if (!isMTVU && m_ReadPos.load(std::memory_order_relaxed) == m_WritePos.load(std::memory_order_relaxed))
+					break;
+				u32 curP1Packs = weakWait ? path.GetPendingGSPackets() : 0;
+				if (weakWait && ((startP1Packs - curP1Packs) || !curP1Packs))
+					break;
+				// On weakWait we will stop waiting on the MTGS thread if the
+				// MTGS thread has processed a vu1 xgkick packet, or is pending on
+				// its final vu1 xgkick packet (!curP1Packs)...
+				// Note: m_WritePos doesn't seem to have proper atomic write
+				// code, so reading it from the MTVU thread might be dangerous;
+				// hence it has been avoided...
+			}
+		}
+		RecordWaitTime(m_StatEEWait, waitStart);
 	}
 
 	if (syncRegs)
@@ -676,8 +836,12 @@ void SysMtgsThread::WaitGS(bool syncRegs, bool weakWait, bool isMTVU)
 
 // Sets the gsEvent flag and releases a timeslice.
 // For use in loops that wait on the GS thread to do certain things.
-void SysMtgsThread::SetEvent()
+// The held GS packet is published first, unless called from the MTVU thread.
+void SysMtgsThread::SetEvent(bool isMTVU)
 {
+	if (!isMTVU)
+		FlushGSPacket();
+
 	if (!m_RingBufferIsBusy.load(std::memory_order_relaxed))
 		m_sem_event.Post();
 
@@ -736,16 +900,35 @@ void SysMtgsThread::GenericStall(uint size)
 	// But if not then we need to make sure the readpos is outside the scope of
 	// the block about to be written (writepos + size)
 
-	uint readpos = m_ReadPos.load(std::memory_order_acquire);
-	uint freeroom;
+	// The MTGS only ever moves m_ReadPos towards writepos, so a stale copy can only
+	// underestimate the free room.  Most packets fit in what was free the last time
+	// we looked, and then the MTGS cache line isn't touched at all.
+	if (RingFreeRoom(writepos, m_CachedReadPos) > size)
+		return;
 
-	if (writepos < readpos)
-		freeroom = readpos - writepos;
-	else
-		freeroom = RingBufferSize - (writepos - readpos);
+	uint readpos = m_ReadPos.load(std::memory_order_acquire);
+	uint freeroom = RingFreeRoom(writepos, readpos);
+	m_CachedReadPos = readpos;
 
 	if (freeroom <= size)
 	{
+		const u64 waitStart = GetCPUTicks();
+
+		// The MTGS frees a packet's worth of room within microseconds most of the time,
+		// so poll for a bit before putting the EE to sleep.
+		SetEvent();
+		if (SpinUntil(MicrosecondsToTicks(MTGS_EESpinMicroseconds), [&] {
+				readpos = m_ReadPos.load(std::memory_order_acquire);
+				return RingFreeRoom(writepos, readpos) > size;
+			}))
+		{
+			m_StatEESpinWaits.fetch_add(1, std::memory_order_relaxed);
+			m_CachedReadPos = readpos;
+			RecordWaitTime(m_StatEEWait, waitStart);
+			return;
+		}
+		freeroom = RingFreeRoom(writepos, readpos);
+
 		// writepos will overlap readpos if we commit the data, so we need to wait until
 		// readpos is out past the end of the future write pos, or until it wraps around
 		// (in which case writepos will be >= readpos).
@@ -766,6 +949,7 @@ void SysMtgsThread::GenericStall(uint size)
 		{
 			pxAssertDev(m_SignalRingEnable == 0, "MTGS Thread Synchronization Error");
 			m_SignalRingPosition.store(somedone, std::memory_order_release);
+			m_StatEESleepWaits.fetch_add(1, std::memory_order_relaxed);
 
 			//Console.WriteLn( Color_Blue, "(EEcore Sleep) PrepDataPacker \tringpos=0x%06x, writepos=0x%06x, signalpos=0x%06x", readpos, writepos, m_SignalRingPosition );
 
@@ -777,12 +961,7 @@ void SysMtgsThread::GenericStall(uint size)
 				readpos = m_ReadPos.load(std::memory_order_acquire);
 				//Console.WriteLn( Color_Blue, "(EEcore Awake) Report!\tringpos=0x%06x", readpos );
 
-				if (writepos < readpos)
-					freeroom = readpos - writepos;
-				else
-					freeroom = RingBufferSize - (writepos - readpos);
-
-				if (freeroom > size)
+				if (RingFreeRoom(writepos, readpos) > size)
 					break;
 			}
 
@@ -791,26 +970,27 @@ void SysMtgsThread::GenericStall(uint size)
 		else
 		{
 			//Console.WriteLn( Color_StrongGray, "(EEcore Spin) PrepDataPacket!" );
+			m_StatEESpinWaits.fetch_add(1, std::memory_order_relaxed);
 			SetEvent();
 			while (true)
 			{
 				SpinWait();
 				readpos = m_ReadPos.load(std::memory_order_acquire);
 
-				if (writepos < readpos)
-					freeroom = readpos - writepos;
-				else
-					freeroom = RingBufferSize - (writepos - readpos);
-
-				if (freeroom > size)
+				if (RingFreeRoom(writepos, readpos) > size)
 					break;
 			}
 		}
+
+		m_CachedReadPos = readpos;
+		RecordWaitTime(m_StatEEWait, waitStart);
 	}
 }
 
 void SysMtgsThread::PrepDataPacket(MTGS_RingCommand cmd, u32 size)
 {
+	FlushGSPacket();
+
 	m_packet_size = size;
 	++size; // takes into account our RingCommand QWC.
 	GenericStall(size);
@@ -850,10 +1030,20 @@ __fi void SysMtgsThread::_FinishSimplePacket()
 		++m_CopyDataTally;
 }
 
+// Publishes the GS packet command held back for coalescing, if any.
+__fi void SysMtgsThread::FlushGSPacket()
+{
+	if (!m_PendingGSPacket)
+		return;
+	m_PendingGSPacket = false;
+	_FinishSimplePacket();
+}
+
 void SysMtgsThread::SendSimplePacket(MTGS_RingCommand type, int data0, int data1, int data2)
 {
 	//ScopedLock locker( m_PacketLocker );
 
+	FlushGSPacket();
 	GenericStall(1);
 	PacketTagType& tag = (PacketTagType&)RingBuffer[m_WritePos.load(std::memory_order_relaxed)];
 
@@ -867,7 +1057,39 @@ void SysMtgsThread::SendSimplePacket(MTGS_RingCommand type, int data0, int data1
 
 void SysMtgsThread::SendSimpleGSPacket(MTGS_RingCommand type, u32 offset, u32 size, GIF_PATH path)
 {
-	SendSimplePacket(type, (int)offset, (int)size, (int)path);
+	m_StatGSPackets.fetch_add(1, std::memory_order_relaxed);
+	m_StatGSPacketBytes.fetch_add(size, std::memory_order_relaxed);
+
+	if (type != GS_RINGTYPE_GSPACKET || EmuConfig.GS.SynchronousMTGS)
+	{
+		SendSimplePacket(type, (int)offset, (int)size, (int)path);
+		m_StatGSSubmissions.fetch_add(1, std::memory_order_relaxed);
+	}
+	else
+	{
+		// Consecutive packets of a path usually sit back to back in its buffer, so the
+		// command is held back and grown until something else needs the ring or the
+		// MTGS gets kicked; the GS then gets one transfer instead of many small ones.
+		// Blank packets (offset ~0u) only carry a read amount and merge with each other.
+		PacketTagType& tag = (PacketTagType&)RingBuffer[m_WritePos.load(std::memory_order_relaxed)];
+		const bool contiguous = m_PendingGSPacket && (tag.data[2] == (u32)path) && (tag.data[1] + size <= MTGS_MaxCoalescedBytes) &&
+			((offset == ~0u) ? (tag.data[0] == ~0u) : (tag.data[0] != ~0u && tag.data[0] + tag.data[1] == offset));
+
+		if (contiguous)
+			tag.data[1] += size;
+		else
+		{
+			FlushGSPacket();
+			GenericStall(1);
+			PacketTagType& newTag = (PacketTagType&)RingBuffer[m_WritePos.load(std::memory_order_relaxed)];
+			newTag.command = type;
+			newTag.data[0] = offset;
+			newTag.data[1] = size;
+			newTag.data[2] = path;
+			m_PendingGSPacket = true;
+			m_StatGSSubmissions.fetch_add(1, std::memory_order_relaxed);
+		}
+	}
 
 	if (!EmuConfig.GS.SynchronousMTGS)
 	{
@@ -884,6 +1106,7 @@ void SysMtgsThread::SendPointerPacket(MTGS_RingCommand type, u32 data0, void* da
 {
 	//ScopedLock locker( m_PacketLocker );
 
+	FlushGSPacket();
 	GenericStall(1);
 	PacketTagType& tag = (PacketTagType&)RingBuffer[m_WritePos.load(std::memory_order_relaxed)];
 
@@ -894,6 +1117,82 @@ void SysMtgsThread::SendPointerPacket(MTGS_RingCommand type, u32 data0, void* da
 	_FinishSimplePacket();
 }
 
+MTGS_Stats SysMtgsThread::GetStats() const
+{
+	MTGS_Stats stats;
+	for (uint i = 0; i < MTGS_Stats::TimeBuckets; i++)
+	{
+		stats.eeWait[i] = m_StatEEWait[i].load(std::memory_order_relaxed);
+		stats.gsIdle[i] = m_StatGSIdle[i].load(std::memory_order_relaxed);
+	}
+	for (uint i = 0; i < MTGS_Stats::OccupancyBuckets; i++)
+		stats.occupancy[i] = m_StatOccupancy[i].load(std::memory_order_relaxed);
+	stats.eeSpinWaits = m_StatEESpinWaits.load(std::memory_order_relaxed);
+	stats.eeSleepWaits = m_StatEESleepWaits.load(std::memory_order_relaxed);
+	stats.gsPackets = m_StatGSPackets.load(std::memory_order_relaxed);
+	stats.gsPacketBytes = m_StatGSPacketBytes.load(std::memory_order_relaxed);
+	stats.gsSubmissions = m_StatGSSubmissions.load(std::memory_order_relaxed);
+	stats.ticks = GetCPUTicks() - m_StatStartTicks.load(std::memory_order_relaxed);
+	return stats;
+}
+
+void SysMtgsThread::ResetStats()
+{
+	for (auto& bucket : m_StatEEWait)
+		bucket.store(0, std::memory_order_relaxed);
+	for (auto& bucket : m_StatGSIdle)
+		bucket.store(0, std::memory_order_relaxed);
+	for (auto& bucket : m_StatOccupancy)
+		bucket.store(0, std::memory_order_relaxed);
+	m_StatEESpinWaits.store(0, std::memory_order_relaxed);
+	m_StatEESleepWaits.store(0, std::memory_order_relaxed);
+	m_StatStartTicks.store(GetCPUTicks(), std::memory_order_relaxed);
+	m_StatGSPackets.store(0, std::memory_order_relaxed);
+	m_StatGSPacketBytes.store(0, std::memory_order_relaxed);
+	m_StatGSSubmissions.store(0, std::memory_order_relaxed);
+}
+
+static void LogTimeHistogram(const char* name, const u64* hist)
+{
+	std::string line;
+	for (uint i = 0; i < MTGS_Stats::TimeBuckets; i++)
+	{
+		if (!hist[i])
+			continue;
+		char bucket[48];
+		if (i == MTGS_Stats::TimeBuckets - 1)
+			snprintf(bucket, sizeof(bucket), " >=%uus:%llu", 1u << (i - 1), (unsigned long long)hist[i]);
+		else
+			snprintf(bucket, sizeof(bucket), " <%uus:%llu", 1u << i, (unsigned long long)hist[i]);
+		line += bucket;
+	}
+	Console.WriteLn("MTGS: %s%s", name, line.empty() ? " none" : line.c_str());
+}
+
+void SysMtgsThread::LogStats() const
+{
+	const MTGS_Stats stats = GetStats();
+
+	Console.WriteLn("MTGS: EE stalls: %llu spun, %llu slept",
+		(unsigned long long)stats.eeSpinWaits, (unsigned long long)stats.eeSleepWaits);
+	LogTimeHistogram("EE wait", stats.eeWait);
+	LogTimeHistogram("GS idle", stats.gsIdle);
+
+	std::string line;
+	for (uint i = 0; i < MTGS_Stats::OccupancyBuckets; i++)
+	{
+		char bucket[32];
+		snprintf(bucket, sizeof(bucket), " %llu", (unsigned long long)stats.occupancy[i]);
+		line += bucket;
+	}
+	Console.WriteLn("MTGS: Ring occupancy at vsync (1/%u steps):%s", MTGS_Stats::OccupancyBuckets, line.c_str());
+
+	const double seconds = (double)stats.ticks / (double)GetTickFrequency();
+	Console.WriteLn("MTGS: %llu GS packets [%.0f/s] [mean=%.0f bytes] in %llu ring commands",
+		(unsigned long long)stats.gsPackets, seconds > 0 ? stats.gsPackets / seconds : 0.0,
+		stats.gsPackets ? (double)stats.gsPacketBytes / stats.gsPackets : 0.0, (unsigned long long)stats.gsSubmissions);
+}
+
 void SysMtgsThread::SendGameCRC(u32 crc)
 {
 	SendSimplePacket(GS_RINGTYPE_CRC, crc, 0, 0);
@@ -103,12 +103,22 @@ void VU_Thread::Reset()
 {
 	ScopedLock lock(mtxBusy);
 
+	if (stats.ringStalls || stats.batches)
+	{
+		DevCon.WriteLn("MTVU: %llu ring stalls [%llu yields], %llu VU waits, %llu batches [%llu packets]",
+			(unsigned long long)stats.ringStalls, (unsigned long long)stats.ringStallYields, (unsigned long long)stats.vuWaits,
+			(unsigned long long)stats.batches, (unsigned long long)stats.batchedPackets);
+		ResetStats();
+	}
+
 	vuCycleIdx = 0;
 	isBusy = false;
 	m_ato_write_pos = 0;
 	m_write_pos = 0;
 	m_ato_read_pos = 0;
 	m_read_pos = 0;
+	m_cached_read_pos = 0;
+	m_batch = 0;
 	memzero(vif);
 	memzero(vifRegs);
 	for (size_t i = 0; i < 4; ++i)
@@ -199,9 +209,18 @@ void VU_Thread::ExecuteRingBuffer()
 // Should only be called by ReserveSpace()
 __ri void VU_Thread::WaitOnSize(s32 size)
 {
+	// The VU thread can't move its read pos past our write pos, so a stale copy of it
+	// never over-reports free space.  Only look at the shared one when the cached one
+	// doesn't leave enough room.
+	const s32 cached = m_cached_read_pos;
+	if ((cached <= m_write_pos) || (cached > m_write_pos + size + _4kb))
+		return;
+
+	bool stalled = false;
 	for (;;)
 	{
 		s32 readPos = GetReadPos();
+		m_cached_read_pos = readPos;
 		if (readPos <= m_write_pos)
 			break; // MTVU is reading in back of write_pos
 		// FIXME greg: there is a bug somewhere in the queue pointer
@@ -212,6 +231,15 @@ __ri void VU_Thread::WaitOnSize(s32 size)
 		if (readPos > m_write_pos + size + _4kb)
 			break; // Enough free front space
 		{          // Let MTVU run to free up buffer space
+			if (!stalled)
+			{
+				stalled = true;
+				stats.ringStalls++;
+				// A batch has to hand over what it wrote so far, or we'd wait forever
+				if (IsUncommitted())
+					CommitWritePos();
+			}
+			stats.ringStallYields++;
 			KickStart();
 			// Locking might trigger a full flush of the ring buffer. Yield
 			// will be more aggressive, and only flush the minimal size.
@@ -237,6 +265,8 @@ void VU_Thread::ReserveSpace(s32 size)
 		// Reset local write pointer/position
 		m_write_pos = 0;
 		CommitWritePos();
+		// A read pos seen before the wrap says nothing about the new lap
+		m_cached_read_pos = GetReadPos();
 	}
 
 	WaitOnSize(size);
@@ -276,6 +306,23 @@ __fi void VU_Thread::CommitReadPos()
 	m_ato_read_pos.store(m_read_pos, std::memory_order_release);
 }
 
+// Finishes a packet: committed right away, or with the rest of the batch
+__fi void VU_Thread::CommitPacket()
+{
+	if (m_batch)
+	{
+		stats.batchedPackets++;
+		return;
+	}
+	CommitWritePos();
+	KickStart();
+}
+
+__fi bool VU_Thread::IsUncommitted()
+{
+	return m_write_pos != m_ato_write_pos.load(std::memory_order_relaxed);
+}
+
 __fi u32 VU_Thread::Read()
 {
 	u32 ret = buffer[m_read_pos];
@@ -405,9 +452,37 @@ bool VU_Thread::IsDone()
 	return GetReadPos() == GetWritePos();
 }
 
+void VU_Thread::BeginBatch()
+{
+	m_batch++;
+}
+
+void VU_Thread::EndBatch()
+{
+	pxAssert(m_batch > 0);
+	if (--m_batch)
+		return;
+
+	if (IsUncommitted())
+	{
+		stats.batches++;
+		CommitWritePos();
+		KickStart();
+	}
+}
+
+void VU_Thread::ResetStats()
+{
+	memzero(stats);
+}
+
 void VU_Thread::WaitVU()
 {
 	MTVU_LOG("MTVU - WaitVU!");
+	if (IsUncommitted())
+		CommitWritePos();
+	if (!IsDone())
+		stats.vuWaits++;
 	for (;;)
 	{
 		if (IsDone())
@@ -448,8 +523,7 @@ void VU_Thread::VifUnpack(vifStruct& _vif, VIFregisters& _vifRegs, u8* data, u32
 	WriteRegs(&_vifRegs);
 	Write(size);
 	Write(data, size);
-	CommitWritePos();
-	KickStart();
+	CommitPacket();
 }
 
 void VU_Thread::WriteMicroMem(u32 vu_micro_addr, void* data, u32 size)
@@ -460,8 +534,7 @@ void VU_Thread::WriteMicroMem(u32 vu_micro_addr, void* data, u32 size)
 	Write(vu_micro_addr);
 	Write(size);
 	Write(data, size);
-	CommitWritePos();
-	KickStart();
+	CommitPacket();
 }
 
 void VU_Thread::WriteDataMem(u32 vu_data_addr, void* data, u32 size)
@@ -472,8 +545,7 @@ void VU_Thread::WriteDataMem(u32 vu_data_addr, void* data, u32 size)
 	Write(vu_data_addr);
 	Write(size);
 	Write(data, size);
-	CommitWritePos();
-	KickStart();
+	CommitPacket();
 }
 
 void VU_Thread::WriteCol(vifStruct& _vif)
@@ -482,8 +554,7 @@ void VU_Thread::WriteCol(vifStruct& _vif)
 	ReserveSpace(1 + size_u32(sizeof(_vif.MaskCol)));
 	Write(MTVU_VIF_WRITE_COL);
 	Write(&_vif.MaskCol, sizeof(_vif.MaskCol));
-	CommitWritePos();
-	KickStart();
+	CommitPacket();
 }
 
 void VU_Thread::WriteRow(vifStruct& _vif)
@@ -492,6 +563,5 @@ void VU_Thread::WriteRow(vifStruct& _vif)
 	ReserveSpace(1 + size_u32(sizeof(_vif.MaskRow)));
 	Write(MTVU_VIF_WRITE_ROW);
 	Write(&_vif.MaskRow, sizeof(_vif.MaskRow));
-	CommitWritePos();
-	KickStart();
+	CommitPacket();
 }
@@ -26,6 +26,8 @@
 // - This class should only be accessed from the EE thread...
 // - buffer_size must be power of 2
 // - ring-buffer has no complete pending packets when read_pos==write_pos
+// - Between BeginBatch() and EndBatch() packets are committed once, at the end (or
+//   whenever the ring has to be waited on).
 class VU_Thread : public pxThread {
 	static const s32 buffer_size = (_1mb * 16) / sizeof(s32);
 
@@ -36,6 +38,8 @@ class VU_Thread : public pxThread {
 	__aligned(64) std::atomic<int> m_ato_write_pos;    // Only modified by EE thread
 	__aligned(64) int  m_read_pos; // temporary read pos (local to the VU thread)
 	int  m_write_pos; // temporary write pos (local to the EE thread)
+	int  m_cached_read_pos; // last m_ato_read_pos seen by the EE thread
+	int  m_batch;     // BeginBatch() nesting depth
 	Mutex     mtxBusy;
 	Semaphore semaEvent;
 	BaseVUmicroCPU*& vuCPU;
@@ -58,6 +62,16 @@ public:
 	std::atomic<u64> gsLabel; // Used for GS Label command
 	std::atomic<u64> gsSignal; // Used for GS Signal command
 
+	// EE side ring counters (only updated by the EE thread)
+	struct Stats {
+		u64 ringStalls;      // ReserveSpace() calls that had to wait for the VU thread
+		u64 ringStallYields; // Yields spent in those waits
+		u64 vuWaits;         // WaitVU() calls that found work pending
+		u64 batches;         // Batches that wrote anything
+		u64 batchedPackets;  // Packets whose commit was folded into a batch commit
+	};
+	Stats stats;
+
 	VU_Thread(BaseVUmicroCPU*& _vuCPU, VURegs& _vuRegs);
 	virtual ~VU_Thread();
 
@@ -74,6 +88,12 @@ public:
 
 	void Get_GSChanges();
 
+	// Groups the packets of one VIF1 DMA chunk into a single commit
+	void BeginBatch();
+	void EndBatch();
+
+	void ResetStats();
+
 	void ExecuteVU(u32 vu_addr, u32 vif_top, u32 vif_itop);
 
 	void VifUnpack(vifStruct& _vif, VIFregisters& _vifRegs, u8* data, u32 size);
@@ -104,6 +124,8 @@ private:
 
 	void CommitWritePos();
 	void CommitReadPos();
+	void CommitPacket();
+	bool IsUncommitted();
 
 	u32 Read();
 	void Read(void* dest, u32 size);
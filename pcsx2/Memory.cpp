@@ -890,6 +890,14 @@ eeMemoryReserve::~eeMemoryReserve()
 // is 4096 (4k), which is why you'll see a lot of 0xfff's, >><< 12's, and 0x1000's in the
 // code below.
 //
+// Sub-page tracking:
+// Each page also tracks which 128 byte sub-blocks hold code that was compiled while the
+// page was write protected.  A write fault clears the blocks of those sub-blocks only,
+// and the fault counters tell how much code each fault threw away.
+//
+
+static const uint ProtSubBlockShift = 7;
+static const uint ProtSubBlocks = __pagesize >> ProtSubBlockShift;
 
 struct vtlb_PageProtectionInfo
 {
@@ -900,10 +908,16 @@ struct vtlb_PageProtectionInfo
 	// changes) will be re-assigned the next time the page is accessed.
 	u32 ReverseRamMap;
 
+	// One bit per sub-block holding code that relies on the write protection.
+	u32 CodeMask;
+
 	vtlb_ProtectionMode Mode;
 };
 
+static_assert(ProtSubBlocks <= 32, "vtlb_PageProtectionInfo::CodeMask is too small for the sub-block size");
+
 static __aligned16 vtlb_PageProtectionInfo m_PageProtectInfo[Ps2MemSize::MainRam >> 12];
+static vtlb_ProtectionStats m_ProtectionStats;
 
 
 // returns:
@@ -928,10 +942,13 @@ vtlb_ProtectionMode mmap_GetRamPageInfo( u32 paddr )
 }
 
 // paddr - physically mapped PS2 address
-void mmap_MarkCountedRamPage( u32 paddr )
+// size  - bytes of code at paddr that rely on the protection (0 if none), must not cross
+//         the page
+void mmap_MarkCountedRamPage( u32 paddr, u32 size )
 {
 	pxAssert( eeMem );
-	
+
+	const u32 inpage = paddr & 0xfff;
 	paddr &= ~0xfff;
 
 	uptr ptr = (uptr)PSM( paddr );
@@ -942,6 +959,15 @@ void mmap_MarkCountedRamPage( u32 paddr )
 
 	m_PageProtectInfo[rampage].ReverseRamMap = paddr;
 
+	if( size )
+	{
+		pxAssert( inpage + size <= __pagesize );
+		const uint first = inpage >> ProtSubBlockShift;
+		const uint last  = (inpage + size - 1) >> ProtSubBlockShift;
+		for( uint sub = first; sub <= last; ++sub )
+			m_PageProtectInfo[rampage].CodeMask |= 1u << sub;
+	}
+
 	if( m_PageProtectInfo[rampage].Mode == ProtMode_Write )
 		return;		// skip town if we're already protected.
 
@@ -955,22 +981,42 @@ void mmap_MarkCountedRamPage( u32 paddr )
 }
 
 // offset - offset of address relative to psM.
-// All recompiled blocks belonging to the page are cleared, and any new blocks recompiled
-// from code residing in this page will use manual protection.
+// Recompiled blocks of the page that relied on its write protection are cleared, and any
+// new blocks recompiled from code residing in this page will use manual protection.
 static __fi void mmap_ClearCpuBlock( uint offset )
 {
 	pxAssert( eeMem );
 
 	int rampage = offset >> 12;
+	vtlb_PageProtectionInfo& info = m_PageProtectInfo[rampage];
 
 	// Assertion: This function should never be run on a block that's already under
 	// manual protection.  Indicates a logic error in the recompiler or protection code.
-	pxAssertMsg( m_PageProtectInfo[rampage].Mode != ProtMode_Manual,
+	pxAssertMsg( info.Mode != ProtMode_Manual,
 		"Attempted to clear a block that is already under manual protection." );
 
 	HostSys::MemProtect( &eeMem->Main[rampage<<12], __pagesize, PageAccess_ReadWrite() );
-	m_PageProtectInfo[rampage].Mode = ProtMode_Manual;
-	Cpu->Clear( m_PageProtectInfo[rampage].ReverseRamMap, 0x400 );
+	info.Mode = ProtMode_Manual;
+
+	// Writes to the page aren't seen anymore from here on, so every block of it has to go,
+	// wherever the write landed.  Clear them in runs of adjacent sub-blocks.
+	const u32 mask = info.CodeMask;
+	info.CodeMask = 0;
+	m_ProtectionStats.Faults++;
+
+	uint sub = 0, cleared = 0;
+	while( sub < ProtSubBlocks )
+	{
+		if( !(mask & (1u << sub)) ) { sub++; continue; }
+
+		uint end = sub + 1;
+		while( end < ProtSubBlocks && (mask & (1u << end)) ) end++;
+
+		Cpu->Clear( info.ReverseRamMap + (sub << ProtSubBlockShift), (end - sub) << (ProtSubBlockShift - 2) );
+		cleared += end - sub;
+		sub = end;
+	}
+	m_ProtectionStats.SubBlocksCleared += cleared;
 }
 
 void mmap_PageFaultHandler::OnPageFaultEvent( const PageFaultInfo& info, bool& handled )
@@ -993,5 +1039,11 @@ void mmap_ResetBlockTracking()
 {
 	//DbgCon.WriteLn( "vtlb/mmap: Block Tracking reset..." );
 	memzero( m_PageProtectInfo );
+	memzero( m_ProtectionStats );
 	if (eeMem) HostSys::MemProtect( eeMem->Main, Ps2MemSize::MainRam, PageAccess_ReadWrite() );
 }
+
+const vtlb_ProtectionStats& mmap_GetProtectionStats()
+{
+	return m_ProtectionStats;
+}
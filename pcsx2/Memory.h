@@ -124,9 +124,18 @@ enum vtlb_ProtectionMode
 	ProtMode_NotRequired	// page doesn't require any protection
 };
 
+// Write faults taken on protected code pages, and how much recompiled code they cost.
+// Reset along with the block tracking.
+struct vtlb_ProtectionStats
+{
+	u64 Faults;				// write faults on protected pages
+	u64 SubBlocksCleared;	// sub-blocks holding code cleared by those faults
+};
+
 extern vtlb_ProtectionMode mmap_GetRamPageInfo( u32 paddr );
-extern void mmap_MarkCountedRamPage( u32 paddr );
+extern void mmap_MarkCountedRamPage( u32 paddr, u32 size = 0 );
 extern void mmap_ResetBlockTracking();
+extern const vtlb_ProtectionStats& mmap_GetProtectionStats();
 
 #define memRead8 vtlb_memRead<mem8_t>
 #define memRead16 vtlb_memRead<mem16_t>
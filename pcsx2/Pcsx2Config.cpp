@@ -226,6 +226,7 @@ Pcsx2Config::GSOptions::GSOptions()
 
 	SynchronousMTGS			= false;
 	VsyncQueueSize			= 2;
+	MTGSRingSizeFactor		= RingBufferSizeFactorDefault;
 
 	FramesToDraw			= 2;
 	FramesToSkip			= 2;
@@ -241,6 +242,7 @@ void Pcsx2Config::GSOptions::LoadSave( IniInterface& ini )
 
 	IniEntry( SynchronousMTGS );
 	IniEntry( VsyncQueueSize );
+	IniEntry( MTGSRingSizeFactor );
 
 	IniEntry( FrameLimitEnable );
 	IniEntry( FrameSkipEnable );
@@ -447,6 +449,7 @@ void Pcsx2Config::LoadSave( IniInterface& ini )
 	IniBitBool( CdvdVerboseReads );
 	IniBitBool( CdvdDumpBlocks );
 	IniBitBool( CdvdShareWrite );
+	IniBitBool( CdvdDirectIO );
 	IniBitBool( EnablePatches );
 	IniBitBool( EnableCheats );
 	IniBitBool( EnableIPC );
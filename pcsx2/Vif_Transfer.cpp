@@ -17,6 +17,7 @@
 #include "Common.h"
 #include "Vif_Dma.h"
 #include "newVif.h"
+#include "MTVU.h"
 
 //------------------------------------------------------------------
 // VifCode Transfer Interpreter (Vif0/Vif1)
@@ -69,7 +70,11 @@ _vifT static __fi bool vifTransfer(u32 *data, int size, bool TTE) {
 	int transferred = vifX.irqoffset.enabled ? vifX.irqoffset.value : 0;
 	
 	vifX.vifpacketsize = size;
+	// One ring commit for the whole chunk instead of one per VIF command
+	const bool mtvuBatch = idx && THREAD_VU1;
+	if (mtvuBatch) vu1Thread.BeginBatch();
 	vifTransferLoop<idx>(data);
+	if (mtvuBatch) vu1Thread.EndBatch();
 
 	transferred += size - vifX.vifpacketsize;
 
@@ -332,6 +332,12 @@ public:
 
 	wxString GameLaunchArgs;
 
+	// GS dump to replay headless with the GS benchmark instead of starting the emulator.
+	wxString GsBenchDump;
+	wxString GsBenchReport;
+	long GsBenchLoops;
+	long GsBenchThreads;
+
 	// Specifies the CDVD source type to use when AutoRunning
 	CDVD_SourceType CdvdSource;
 
@@ -349,6 +355,8 @@ public:
 		SysAutoRun = false;
 		SysAutoRunElf = false;
 		SysAutoRunIrx = false;
+		GsBenchLoops = 1;
+		GsBenchThreads = -1;
 		CdvdSource = CDVD_SourceType::NoDisc;
 	}
 };
@@ -503,7 +503,7 @@ AppConfig::AppConfig()
 		Mcd[slot].Type = MemoryCardType::MemoryCard_File;
 	}
 
-	GzipIsoIndexTemplate = L"$(f).pindex.tmp";
+	GzipIsoIndexTemplate = L"cache/$(f).pindex";
 }
 
 // ------------------------------------------------------------------------
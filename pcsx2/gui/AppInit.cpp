@@ -19,6 +19,7 @@
 #include "ConsoleLogger.h"
 #include "MSWstuff.h"
 #include "MTVU.h" // for thread cancellation on shutdown
+#include "GS.h"
 
 #include "Utilities/IniInterface.h"
 #include "DebugTools/Debug.h"
@@ -233,6 +234,11 @@ void Pcsx2App::OnInitCmdLine(wxCmdLineParser& parser)
 
 	parser.AddSwitch(wxEmptyString, L"profiling", _("update options to ease profiling (debug)"));
 
+	parser.AddOption(wxEmptyString, L"gsbench", _("replays a GS dump headless with the software renderer and exits"), wxCMD_LINE_VAL_STRING);
+	parser.AddOption(wxEmptyString, L"gsbench-loops", _("number of times --gsbench replays the dump"), wxCMD_LINE_VAL_NUMBER);
+	parser.AddOption(wxEmptyString, L"gsbench-threads", _("extra rasterizer threads for --gsbench (default: GS setting)"), wxCMD_LINE_VAL_NUMBER);
+	parser.AddOption(wxEmptyString, L"gsbench-report", _("file the --gsbench JSON report is written to (default: stdout)"), wxCMD_LINE_VAL_STRING);
+
 	parser.SetSwitchChars(L"-");
 }
 
@@ -337,6 +343,13 @@ bool Pcsx2App::OnCmdLineParsed(wxCmdLineParser& parser)
 		Startup.SysAutoRun = true;
 	}
 
+	if (parser.Found(L"gsbench", &Startup.GsBenchDump))
+	{
+		parser.Found(L"gsbench-loops", &Startup.GsBenchLoops);
+		parser.Found(L"gsbench-threads", &Startup.GsBenchThreads);
+		parser.Found(L"gsbench-report", &Startup.GsBenchReport);
+	}
+
 	return true;
 }
 
@@ -434,6 +447,16 @@ bool Pcsx2App::OnInit()
 		SysExecutorThread.Start();
 		DetectCpuAndUserMode();
 
+		// The GS benchmark only needs the settings folder for the GS configuration
+		if (!Startup.GsBenchDump.IsEmpty())
+		{
+			std::string dump(Startup.GsBenchDump.ToUTF8());
+			std::string report(Startup.GsBenchReport.ToUTF8());
+			GSReplayBenchmark(&dump[0], Startup.GsBenchLoops, Startup.GsBenchThreads, report.empty() ? nullptr : report.c_str());
+			CleanupOnExit();
+			return false;
+		}
+
 		//   Set Manual Exit Handling
 		// ----------------------------
 		// PCSX2 has a lot of event handling logistics, so we *cannot* depend on wxWidgets automatic event
@@ -36,6 +36,11 @@ struct BASEBLOCKEX
 	u16  size;	 // The size in dwords (equivalent to the number of instructions)
 	u16  x86size; // The size in byte of the translated x86 instructions
 
+	// EE only: lets a cleared block be relinked instead of recompiled when its code didn't change
+	u32  vpc;     // startpc before address translation
+	bool checked; // The block checks its own code on entry (manual protection)
+	u64  hash;    // Hash of the source code at compile time
+
 #ifdef PCSX2_DEVBUILD
 	// Could be useful to instrument the block
 	//u32 visited; // number of times called
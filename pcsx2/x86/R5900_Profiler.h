@@ -239,6 +239,12 @@ struct eeProfiler {
 	u64 memStatsFast;
 	u32 memMask;
 
+	// Block revalidation by source hash
+	u64 relinkStats[2];  // cleared blocks needed again [recompiled, relinked]
+	u64 overlapStats[2]; // older blocks overlapped by a new one [stale, still valid]
+	u64 entryHashChecks; // hashed entry checks of large manual blocks
+	u64 discards;        // manual blocks that failed their entry check
+
 	void Reset() {
 		memzero(opStats);
 		memzero(memStats);
@@ -246,6 +252,10 @@ struct eeProfiler {
 		memStatsSlow = 0;
 		memStatsFast = 0;
 		memMask = 0xF700FFF0;
+		memzero(relinkStats);
+		memzero(overlapStats);
+		entryHashChecks = 0;
+		discards = 0;
 		pxAssert(eeOpcodeName[static_cast<int>(eeOpcode::LAST)][0] == '!');
 	}
 
@@ -255,6 +265,11 @@ struct eeProfiler {
 		xADC(ptr32[&(((u32*)opStats)[op*2+1])], 0);
 	}
 
+	void Relink(bool hit)     { relinkStats[hit]++; }
+	void Overlap(bool valid)  { overlapStats[valid]++; }
+	void EntryHashCheck()     { entryHashChecks++; }
+	void Discard()            { discards++; }
+
 	double per(u64 part, u64 total) {
 		return (double) part / (double) total * 100.0;
 	}
@@ -363,6 +378,13 @@ struct eeProfiler {
 				break;
 		}
 
+		u64 relinks  = relinkStats[0]  + relinkStats[1];
+		u64 overlaps = overlapStats[0] + overlapStats[1];
+		DevCon.WriteLn("\nEE Block Revalidation:");
+		DevCon.WriteLn("  Relink  = %u [%3.4f%% hit]", (u32)relinks,  relinks  ? per(relinkStats[1],  relinks)  : 0.0);
+		DevCon.WriteLn("  Overlap = %u [%3.4f%% valid]", (u32)overlaps, overlaps ? per(overlapStats[1], overlaps) : 0.0);
+		DevCon.WriteLn("  Entry hash checks = %u, discarded manual blocks = %u", (u32)entryHashChecks, (u32)discards);
+
 	}
 
 	// Warning dirty ebx
@@ -401,6 +423,10 @@ struct eeProfiler {
 	__fi void EmitConstMem(u32 add) {}
 	__fi void EmitSlowMem() {}
 	__fi void EmitFastMem() {}
+	__fi void Relink(bool hit) {}
+	__fi void Overlap(bool valid) {}
+	__fi void EntryHashCheck() {}
+	__fi void Discard() {}
 };
 #endif
 
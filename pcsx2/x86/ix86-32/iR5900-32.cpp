@@ -43,6 +43,8 @@
 #include "Utilities/MemsetFast.inl"
 #include "Utilities/Perf.h"
 
+#include <unordered_map>
+
 
 using namespace x86Emitter;
 using namespace R5900;
@@ -73,7 +75,6 @@ eeProfiler EE::Profiler;
 static const int RECCONSTBUF_SIZE = 16384 * 2; // 64 bit consts in 32 bit units
 
 static RecompiledCodeReserve* recMem = NULL;
-static u8* recRAMCopy = NULL;
 static u8* recLutReserve_RAM = NULL;
 static const size_t recLutSize = (Ps2MemSize::MainRam + Ps2MemSize::Rom + Ps2MemSize::Rom1 + Ps2MemSize::Rom2) * wordsize / 4;
 
@@ -93,6 +94,20 @@ static u32 s_nInstCacheSize = 0;
 
 static BASEBLOCK* s_pCurBlock = NULL;
 static BASEBLOCKEX* s_pCurBlockEx = NULL;
+
+// Blocks removed by recClear, by startpc.  Their x86 code stays in recMem until the next
+// reset, so a block whose source is unchanged when it's needed again gets relinked
+// instead of recompiled.
+struct recClearedBlock
+{
+	BASEBLOCKEX block;
+	u8 firstByte; // dev builds overwrite it on removal
+};
+static std::unordered_map<u32, recClearedBlock> s_clearedBlocks;
+
+// Manual blocks of at least this many instructions check their code with a hash on entry
+// instead of a compare per instruction.
+static const u32 recHashCheckMin = 64;
 u32 s_nEndBlock = 0; // what pc the current block ends
 u32 s_branchTo;
 static bool s_nBlockFF;
@@ -516,11 +531,6 @@ static void recReserve()
 
 static void recAlloc()
 {
-	if (!recRAMCopy)
-	{
-		recRAMCopy = (u8*)_aligned_malloc(Ps2MemSize::MainRam, 4096);
-	}
-
 	if (!recRAM)
 	{
 		recLutReserve_RAM = (u8*)_aligned_malloc(recLutSize, 4096);
@@ -585,6 +595,41 @@ static void recAlloc()
 static __aligned16 u16 manual_page[Ps2MemSize::MainRam >> 12];
 static __aligned16 u8 manual_counter[Ps2MemSize::MainRam >> 12];
 
+// Recompile rate counters, logged (with the vtlb write fault counters) and reset along
+// with the recompiler.
+struct eeRecBlockStats
+{
+	u64 compiled;	// blocks recompiled
+	u64 manual;		// ... of which under manual protection
+	u64 discarded;	// manual blocks that failed their integrity check
+	u64 pageResets;	// manual pages put back under write protection
+	u64 relinked;	// cleared blocks relinked without recompiling
+	u64 startTicks;
+};
+static eeRecBlockStats s_blockStats;
+
+static void recLogBlockStats()
+{
+	const vtlb_ProtectionStats& prot = mmap_GetProtectionStats();
+
+	if (s_blockStats.compiled)
+	{
+		const double secs = (double)(GetCPUTicks() - s_blockStats.startTicks) / (double)GetTickFrequency();
+		DevCon.WriteLn("EE Rec: %llu blocks compiled (%.1f/s, %llu manual), %llu discarded, %llu page resets, %llu relinked",
+			(unsigned long long)s_blockStats.compiled, secs > 0 ? s_blockStats.compiled / secs : 0.0,
+			(unsigned long long)s_blockStats.manual, (unsigned long long)s_blockStats.discarded,
+			(unsigned long long)s_blockStats.pageResets, (unsigned long long)s_blockStats.relinked);
+	}
+	if (prot.Faults)
+	{
+		DevCon.WriteLn("EE Rec: %llu write faults, %llu sub-blocks of code cleared",
+			(unsigned long long)prot.Faults, (unsigned long long)prot.SubBlocksCleared);
+	}
+
+	memzero(s_blockStats);
+	s_blockStats.startTicks = GetCPUTicks();
+}
+
 static std::atomic<bool> eeRecIsReset(false);
 static std::atomic<bool> eeRecNeedsReset(false);
 static bool eeCpuExecuting = false;
@@ -607,7 +652,6 @@ static void recResetRaw()
 
 	recMem->Reset();
 	ClearRecLUT((BASEBLOCK*)recLutReserve_RAM, recLutSize);
-	memset(recRAMCopy, 0, Ps2MemSize::MainRam);
 
 	maxrecmem = 0;
 
@@ -617,6 +661,8 @@ static void recResetRaw()
 		memset( s_pInstCache, 0, sizeof(EEINST)*s_nInstCacheSize );
 
 	recBlocks.Reset();
+	s_clearedBlocks.clear();
+	recLogBlockStats();
 	mmap_ResetBlockTracking();
 
 	x86SetPtr(*recMem);
@@ -631,11 +677,13 @@ static void recResetRaw()
 
 static void recShutdown()
 {
+	recLogBlockStats();
+
 	safe_delete( recMem );
-	safe_aligned_free( recRAMCopy );
 	safe_aligned_free( recLutReserve_RAM );
 
 	recBlocks.Reset();
+	s_clearedBlocks.clear();
 
 	recRAM = recROM = recROM1 = recROM2 = NULL;
 
@@ -780,6 +828,52 @@ void R5900::Dynarec::OpcodeImpl::recBREAK()
 	//g_branch = 2;
 }
 
+// Hash of a block's source code (size in dwords).  Two SSE states take 8 dwords per step,
+// the remaining dwords are mixed in one at a time.
+static u64 recHashCode(const u32* code, u32 size)
+{
+	const __m128i mul = _mm_set1_epi32(0x9e3779b1);
+	__m128i h0 = _mm_set_epi32(0x85ebca6b, 0xc2b2ae35, 0x27d4eb2f, 0x165667b1);
+	__m128i h1 = _mm_xor_si128(h0, _mm_set1_epi32(size));
+
+	u32 i = 0;
+	for (; i + 8 <= size; i += 8) {
+		h0 = _mm_mullo_epi32(_mm_xor_si128(h0, _mm_loadu_si128((const __m128i*)&code[i + 0])), mul);
+		h1 = _mm_mullo_epi32(_mm_xor_si128(h1, _mm_loadu_si128((const __m128i*)&code[i + 4])), mul);
+		h0 = _mm_xor_si128(h0, _mm_srli_epi32(h0, 15));
+		h1 = _mm_xor_si128(h1, _mm_srli_epi32(h1, 15));
+	}
+
+	alignas(16) u32 lanes[8];
+	_mm_store_si128((__m128i*)&lanes[0], h0);
+	_mm_store_si128((__m128i*)&lanes[4], h1);
+
+	u64 hash = size;
+	for (u32 l = 0; l < 8; l++) {
+		hash  = (hash ^ lanes[l]) * 0xff51afd7ed558ccdull;
+		hash ^= hash >> 32;
+	}
+	for (; i < size; i++) {
+		hash  = (hash ^ code[i]) * 0xff51afd7ed558ccdull;
+		hash ^= hash >> 32;
+	}
+	return hash;
+}
+
+// Removes blocks first to last (inclusive), remembering the RAM ones (those with a hash)
+static void recRetireBlocks(int first, int last)
+{
+	for (int i = first; i <= last; i++) {
+		const BASEBLOCKEX& block = *recBlocks[i];
+		if (!block.hash)
+			continue;
+		recClearedBlock& cleared = s_clearedBlocks[block.startpc];
+		cleared.block     = block;
+		cleared.firstByte = *(u8*)block.fnptr;
+	}
+	recBlocks.Remove(first, last);
+}
+
 // Size is in dwords (4 bytes)
 void recClear(u32 addr, u32 size)
 {
@@ -807,7 +901,7 @@ void recClear(u32 addr, u32 size)
 
 		if (pblock == s_pCurBlock) {
 			if(toRemoveLast != blockidx) {
-				recBlocks.Remove((blockidx + 1), toRemoveLast);
+				recRetireBlocks((blockidx + 1), toRemoveLast);
 			}
 			toRemoveLast = --blockidx;
 			continue;
@@ -828,7 +922,7 @@ void recClear(u32 addr, u32 size)
 	}
 
 	if(toRemoveLast != blockidx) {
-		recBlocks.Remove((blockidx + 1), toRemoveLast);
+		recRetireBlocks((blockidx + 1), toRemoveLast);
 	}
 
 	upperextent = std::min(upperextent, ceiling);
@@ -1522,7 +1616,13 @@ static u32 s_recblocks[] = {0};
 void __fastcall dyna_block_discard(u32 start,u32 sz)
 {
 	eeRecPerfLog.Write( Color_StrongGray, "Clearing Manual Block @ 0x%08X  [size=%d]", start, sz*4);
+	s_blockStats.discarded++;
+	EE::Profiler.Discard();
 	recClear(start, sz);
+
+	// A block left in place would fail its check again forever
+	BASEBLOCKEX* pexblock = recBlocks.Get(start);
+	pxAssertDev(!pexblock || pexblock->startpc != start, "Discarded manual block is still linked");
 }
 
 // called when a page under manual protection has been run enough times to be a candidate
@@ -1531,11 +1631,23 @@ void __fastcall dyna_block_discard(u32 start,u32 sz)
 void __fastcall dyna_page_reset(u32 start,u32 sz)
 {
 	recClear(start & ~0xfffUL, 0x400);
+	// Recompiled, not relinked, so they drop their checks and rely on the protection
+	for (u32 addr = start & ~0xfffUL; addr < (start & ~0xfffUL) + __pagesize; addr += 4)
+		s_clearedBlocks.erase(addr);
 	manual_counter[start >> 12]++;
+	s_blockStats.pageResets++;
 	mmap_MarkCountedRamPage( start );
 }
 
-static void memory_protect_recompiled_code(u32 startpc, u32 size)
+// Entry check of large manual blocks: hash of the block's code
+static u64 __fastcall dyna_block_hash(u32 start, u32 sz)
+{
+	EE::Profiler.EntryHashCheck();
+	return recHashCode((const u32*)PSM(start), sz);
+}
+
+// Returns true if the block checks its own code on entry (manual protection)
+static bool memory_protect_recompiled_code(u32 startpc, u32 size)
 {
 	u32 inpage_ptr = HWADDR(startpc);
 	u32 inpage_sz  = size*4;
@@ -1554,25 +1666,40 @@ static void memory_protect_recompiled_code(u32 startpc, u32 size)
 
 		case ProtMode_None:
         case ProtMode_Write:
-			mmap_MarkCountedRamPage( inpage_ptr );
+			mmap_MarkCountedRamPage( inpage_ptr, inpage_sz );
 			manual_page[inpage_ptr >> 12] = 0;
 			break;
 
         case ProtMode_Manual:
-			xMOV( arg1regd, inpage_ptr );
-			xMOV( arg2regd, inpage_sz / 4 );
-			//xMOV( eax, startpc );		// uncomment this to access startpc (as eax) in dyna_block_discard
+			s_blockStats.manual++;
 
-			u32 lpc = inpage_ptr;
-			u32 stg = inpage_sz;
-
-			while(stg>0)
+			if (inpage_sz / 4 >= recHashCheckMin)
 			{
-				xCMP( ptr32[PSM(lpc)], *(u32*)PSM(lpc) );
+				// Cheaper (and much smaller) than a compare per instruction on large blocks
+				xFastCall((void*)dyna_block_hash, inpage_ptr, inpage_sz / 4);
+				xMOV64( rcx, (s64)recHashCode((const u32*)PSM(inpage_ptr), inpage_sz / 4) );
+				xCMP( rax, rcx );
+				xMOV( arg1regd, inpage_ptr );
+				xMOV( arg2regd, inpage_sz / 4 );
 				xJNE(DispatchBlockDiscard);
+			}
+			else
+			{
+				xMOV( arg1regd, inpage_ptr );
+				xMOV( arg2regd, inpage_sz / 4 );
+				//xMOV( eax, startpc );		// uncomment this to access startpc (as eax) in dyna_block_discard
+
+				u32 lpc = inpage_ptr;
+				u32 stg = inpage_sz;
 
-				stg -= 4;
-				lpc += 4;
+				while(stg>0)
+				{
+					xCMP( ptr32[PSM(lpc)], *(u32*)PSM(lpc) );
+					xJNE(DispatchBlockDiscard);
+
+					stg -= 4;
+					lpc += 4;
+				}
 			}
 
 			// Tweakpoint!  3 is a 'magic' number representing the number of times a counted block
@@ -1616,6 +1743,8 @@ static void memory_protect_recompiled_code(u32 startpc, u32 size)
 			}
             break;
 	}
+
+	return PageType == ProtMode_Manual;
 }
 
 // Skip MPEG Game-Fix
@@ -1652,6 +1781,100 @@ void doPlace0Patches()
     ApplyLoadedPatches(PPT_ONCE_ON_LOAD);
 }
 
+// Clears the blocks overlapping [startpc, endpc) whose source changed since they were
+// compiled, along with everything else in that range but s_pCurBlock(Ex).
+// Returns true if it cleared anything.
+static bool recClearStaleOverlaps(u32 startpc, u32 endpc)
+{
+	int i = recBlocks.LastIndex(HWADDR(endpc) - 4);
+	while (BASEBLOCKEX* oldBlock = recBlocks[i--]) {
+		if (oldBlock == s_pCurBlockEx)
+			continue;
+		if (oldBlock->startpc >= HWADDR(endpc))
+			continue;
+		if ((oldBlock->startpc + oldBlock->size * 4) <= HWADDR(startpc))
+			break;
+
+		const bool valid = recHashCode((const u32*)PSM(oldBlock->startpc), oldBlock->size) == oldBlock->hash;
+		EE::Profiler.Overlap(valid);
+		if (!valid) {
+			recClear(startpc, (endpc - startpc) / 4);
+			return true;
+		}
+	}
+	return false;
+}
+
+// Blocks with boot and patch hooks decided at compile time are always recompiled
+static bool recIsHookBlock(u32 hwstart)
+{
+	return hwstart == EELOAD_START
+		|| (g_eeloadMain && hwstart == HWADDR(g_eeloadMain))
+		|| (g_eeloadExec && hwstart == HWADDR(g_eeloadExec))
+		|| (g_GameLoading && hwstart == ElfEntry);
+}
+
+// Brings back a block cleared earlier if its source hasn't changed since it was compiled
+static bool recRelinkBlock(u32 startpc)
+{
+	const u32 hwstart = HWADDR(startpc);
+
+	auto it = s_clearedBlocks.find(hwstart);
+	if (it == s_clearedBlocks.end())
+		return false;
+
+	const recClearedBlock cleared = it->second;
+	s_clearedBlocks.erase(it);
+	const BASEBLOCKEX& block = cleared.block;
+
+	// The virtual pc is baked into the code
+	if (block.vpc != startpc || recIsHookBlock(hwstart))
+		return false;
+
+	bool valid = recHashCode((const u32*)PSM(hwstart), block.size) == block.hash;
+
+	// A block without its own check needs the page protection back, and a checked one
+	// would keep checking itself on a protected page
+	const vtlb_ProtectionMode PageType = mmap_GetRamPageInfo(hwstart);
+	if (!block.checked && PageType == ProtMode_Manual)
+		valid = false;
+	if (block.checked && PageType == ProtMode_Write)
+		valid = false;
+
+	EE::Profiler.Relink(valid);
+	if (!valid)
+		return false;
+
+	// recClear spares s_pCurBlock, point it at the (still empty) slot being relinked
+	s_pCurBlock   = PC_GETBLOCK(startpc);
+	s_pCurBlockEx = NULL;
+	recClearStaleOverlaps(startpc, startpc + block.size * 4);
+
+	if (!block.checked && PageType != ProtMode_NotRequired) {
+		mmap_MarkCountedRamPage(hwstart, block.size * 4);
+		manual_page[hwstart >> 12] = 0;
+	}
+
+	BASEBLOCKEX* pblockex = recBlocks.New(hwstart, block.fnptr);
+	*pblockex = block;
+	if (IsDevBuild)
+		*(u8*)block.fnptr = cleared.firstByte;
+
+	BASEBLOCK* pblock = PC_GETBLOCK(startpc);
+	pblock->SetFnptr(block.fnptr);
+	for (u32 i = 1; i < block.size; i++) {
+		if ((uptr)JITCompile == pblock[i].GetFnptr())
+			pblock[i].SetFnptr((uptr)JITCompileInBlock);
+	}
+
+	// Nothing is being compiled; the relinked block must stay clearable (see recClear)
+	s_pCurBlock   = NULL;
+	s_pCurBlockEx = NULL;
+
+	s_blockStats.relinked++;
+	return true;
+}
+
 static void __fastcall recRecompile( const u32 startpc )
 {
 	u32 i = 0;
@@ -1675,6 +1898,9 @@ static void __fastcall recRecompile( const u32 startpc )
 
 	if (eeRecNeedsReset) recResetRaw();
 
+	if (recRelinkBlock(startpc))
+		return;
+
 	xSetPtr( recPtr );
 	recPtr = xGetAlignedCallTarget();
 
@@ -2040,7 +2266,8 @@ StartRecomp:
 #endif
 
 	// Detect and handle self-modified code
-	memory_protect_recompiled_code(startpc, (s_nEndBlock-startpc) >> 2);
+	const bool checked = memory_protect_recompiled_code(startpc, (s_nEndBlock-startpc) >> 2);
+	s_blockStats.compiled++;
 
 	// Skip Recompilation if sceMpegIsEnd Pattern detected
 	bool doRecompilation = !skipMPEG_By_Pattern(startpc);
@@ -2061,29 +2288,14 @@ StartRecomp:
 	s_pCurBlockEx->size = (pc-startpc)>>2;
 
 	if (HWADDR(pc) <= Ps2MemSize::MainRam) {
-		BASEBLOCKEX *oldBlock;
-		int i;
-
-		i = recBlocks.LastIndex(HWADDR(pc) - 4);
-		while (oldBlock = recBlocks[i--]) {
-			if (oldBlock == s_pCurBlockEx)
-				continue;
-			if (oldBlock->startpc >= HWADDR(pc))
-				continue;
-			if ((oldBlock->startpc + oldBlock->size * 4) <= HWADDR(startpc))
-				break;
-
-			if (memcmp(&recRAMCopy[oldBlock->startpc / 4], PSM(oldBlock->startpc),
-			           oldBlock->size * 4))
-			{
-				recClear(startpc, (pc - startpc) / 4);
-				s_pCurBlockEx = recBlocks.Get(HWADDR(startpc));
-				pxAssert(s_pCurBlockEx->startpc == HWADDR(startpc));
-				break;
-			}
+		if (recClearStaleOverlaps(startpc, pc)) {
+			s_pCurBlockEx = recBlocks.Get(HWADDR(startpc));
+			pxAssert(s_pCurBlockEx->startpc == HWADDR(startpc));
 		}
 
-		memcpy(&recRAMCopy[HWADDR(startpc) / 4], PSM(startpc), pc - startpc);
+		s_pCurBlockEx->vpc     = startpc;
+		s_pCurBlockEx->checked = checked;
+		s_pCurBlockEx->hash    = recHashCode((const u32*)PSM(HWADDR(startpc)), s_pCurBlockEx->size);
 	}
 
 	s_pCurBlock->SetFnptr((uptr)recPtr);
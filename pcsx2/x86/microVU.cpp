@@ -103,7 +103,7 @@ void mVUreset(microVU& mVU, bool resetReserve) {
 	mVU.prog.isSame		= -1;
 	mVU.prog.cur		= NULL;
 	mVU.prog.total		=  0;
-	mVU.prog.curFrame	=  0;
+	mVU.prog.curFrame.store(0, std::memory_order_relaxed);
 
 	// Setup Dynarec Cache Limits for Each Program
 	u8* z = mVU.cache;
@@ -111,6 +111,15 @@ void mVUreset(microVU& mVU, bool resetReserve) {
 	mVU.prog.x86ptr		= z;
 	mVU.prog.x86end		= z + ((mVU.cacheSize - mVUcacheSafeZone) * _1mb);
 	//memset(mVU.prog.x86start, 0xcc, mVU.cacheSize*_1mb);
+	memzero(mVU.prog.regionRefs);
+
+	// Every chunk gets hashed on the next search
+	memzero(mVU.prog.chunkHash);
+	memset(mVU.prog.chunkDirty, 0xff, sizeof(mVU.prog.chunkDirty));
+	mVU.prog.memHash	=  0;
+
+	if (!mVU.prog.index) mVU.prog.index = new microProgramIndex();
+	else				 mVU.prog.index->clear();
 
 	for(u32 i = 0; i < (mVU.progSize / 2); i++) {
 		if(!mVU.prog.prog[i]) {
@@ -146,10 +155,20 @@ void mVUclose(microVU& mVU) {
 		}
 		safe_delete(mVU.prog.prog[i]);
 	}
+	safe_delete(mVU.prog.index);
 }
 
 // Clears Block Data in specified range
 __fi void mVUclear(mV, u32 addr, u32 size) {
+	// Mark the written chunks, the next search rehashes them
+	const u32 chunks = mVU.microMemSize / mVUhashChunk;
+	const u32 first  = (addr & (mVU.microMemSize - 1)) / mVUhashChunk;
+	const u32 count  = std::min((addr % mVUhashChunk + size + mVUhashChunk - 1) / mVUhashChunk, chunks);
+	for(u32 i = 0; i < count; i++) {
+		u32 c = (first + i) & (chunks - 1);
+		mVU.prog.chunkDirty[c / 32] |= 1u << (c & 31);
+	}
+
 	if(!mVU.prog.cleared) {
 		mVU.prog.cleared = 1;		// Next execution searches/creates a new microprogram
 		memzero(mVU.prog.lpState); // Clear pipeline state
@@ -166,7 +185,91 @@ __fi void mVUclear(mV, u32 addr, u32 size) {
 
 // Finds and Ages/Kills Programs if they haven't been used in a while.
 __ri void mVUvsyncUpdate(mV) {
-	//mVU.prog.curFrame++;
+	mVU.prog.curFrame.fetch_add(1, std::memory_order_relaxed);
+}
+
+// Marks the rec-cache regions holding [start, end) as used by prog
+__ri void mVUmarkRegions(microVU& mVU, microProgram& prog, u8* start, u8* end) {
+	if (end <= start) return;
+	const uptr regionSize = mVUcacheRegion * _1mb;
+	const u32  first = ((uptr)start   - (uptr)mVU.cache) / regionSize;
+	const u32  last  = ((uptr)end - 1 - (uptr)mVU.cache) / regionSize;
+	for (u32 i = first; i <= last; i++) {
+		if (prog.regions & (1ull << i)) continue;
+		prog.regions |= 1ull << i;
+		mVU.prog.regionRefs[i]++;
+	}
+}
+
+// Unlinks a program from the lists, quick references and index, then deletes it
+static void mVUevictProg(microVU& mVU, microProgram* prog) {
+	for (u32 i = 0; i < 64; i++) {
+		if (prog->regions & (1ull << i)) mVU.prog.regionRefs[i]--;
+	}
+	microProgramList* list = mVU.prog.prog[prog->startPC];
+	list->erase(std::find(list->begin(), list->end(), prog));
+	for (u32 i = 0; i < (mVU.progSize / 2); i++) {
+		if (mVU.prog.quick[i].prog != prog) continue;
+		mVU.prog.quick[i].block = NULL;
+		mVU.prog.quick[i].prog  = NULL;
+	}
+	for (auto it = mVU.prog.index->begin(); it != mVU.prog.index->end(); ) {
+		if (it->second == prog) it = mVU.prog.index->erase(it);
+		else ++it;
+	}
+	mVUdeleteProg(mVU, prog);
+}
+
+// Frees the least recently run programs until a run of free rec-cache regions
+// is large enough to keep recompiling in, and moves x86ptr to its start.
+// Returns false if that needs more than every program except the current one.
+__ri bool mVUevictProgs(microVU& mVU) {
+	const u32 regions = mVU.cacheSize / mVUcacheRegion;
+	const u32 wanted  = std::max(mVUcacheSafeZone + mVUcacheRegion, mVU.cacheSize / 4) / mVUcacheRegion;
+	if (wanted >= regions) return false;
+
+	int evicted = 0;
+	for (;;) {
+		u32 runStart = 0, runSize = 0;
+		for (u32 i = 0, size = 0; i < regions; i++) {
+			size = mVU.prog.regionRefs[i] ? 0 : size + 1;
+			if (size > runSize) { runStart = i + 1 - size; runSize = size; }
+		}
+		if (runSize >= wanted) {
+			mVU.prog.x86ptr = mVU.cache + runStart * mVUcacheRegion * _1mb;
+			mVU.prog.x86end = mVU.prog.x86ptr + (runSize * mVUcacheRegion - mVUcacheSafeZone) * _1mb;
+			break;
+		}
+
+		// Coldest program, ties go to the one with the least compiled ranges
+		microProgram* victim = NULL;
+		for (u32 pc = 0; pc < (mVU.progSize / 2); pc++) {
+			for (microProgram* prog : *mVU.prog.prog[pc]) {
+				if (prog == mVU.prog.cur) continue;
+				if (!victim || (prog->lastFrame < victim->lastFrame)
+				 || (prog->lastFrame == victim->lastFrame && prog->ranges->size() < victim->ranges->size()))
+					victim = prog;
+			}
+		}
+		if (!victim) return false;
+		mVUevictProg(mVU, victim);
+		evicted++;
+	}
+
+	// Surviving JR/JALR jump caches may still name an evicted program
+	for (u32 pc = 0; pc < (mVU.progSize / 2); pc++) {
+		for (microProgram* prog : *mVU.prog.prog[pc]) {
+			for (u32 i = 0; i < (mVU.progSize / 2); i++) {
+				if (prog->block[i]) prog->block[i]->clearJumpCaches();
+			}
+		}
+	}
+
+	mVU.prog.evicted += evicted;
+	Console.WriteLn(mVU.index ? Color_Orange : Color_Magenta,
+		"microVU%d: Program cache limit reached, evicted %d programs [total=%u] [full resets=%u]",
+		mVU.index, evicted, mVU.prog.evicted, mVU.prog.fullResets);
+	return true;
 }
 
 // Deletes a program
@@ -185,6 +288,7 @@ __ri microProgram* mVUcreateProg(microVU& mVU, int startPC) {
 	prog->idx     = mVU.prog.total++;
 	prog->ranges  = new std::deque<microRange>();
 	prog->startPC = startPC;
+	prog->lastFrame = mVU.prog.curFrame.load(std::memory_order_relaxed);
 	mVUcacheProg(mVU, *prog); // Cache Micro Program
 	double cacheSize = (double)((uptr)mVU.prog.x86end - (uptr)mVU.prog.x86start);
 	double cacheUsed =((double)((uptr)mVU.prog.x86ptr - (uptr)mVU.prog.x86start)) / (double)_1mb;
@@ -238,10 +342,32 @@ void mVUprintUniqueRatio(microVU& mVU) {
 	DevCon.WriteLn("%d / %d [%3.1f%%]", v.size(), total, 100.-(double)v.size()/(double)total*100.);
 }
 
+// Rehashes the micro memory chunks written since the last search
+static void mVUupdateHash(microVU& mVU) {
+	const u32 chunks = mVU.microMemSize / mVUhashChunk;
+	for(u32 i = 0; i < chunks / 32; i++) {
+		u32 dirty = mVU.prog.chunkDirty[i];
+		mVU.prog.chunkDirty[i] = 0;
+		for(u32 c = i * 32; dirty; c++, dirty >>= 1) {
+			if (!(dirty & 1)) continue;
+			const u64* data = (const u64*)(mVU.regs().Micro + c * mVUhashChunk);
+			u64 hash = (c + 1) * 0x9e3779b97f4a7c15ull;
+			for(u32 j = 0; j < mVUhashChunk / 8; j++) {
+				hash  = (hash ^ data[j]) * 0xff51afd7ed558ccdull;
+				hash ^= hash >> 32;
+			}
+			mVU.prog.memHash ^= mVU.prog.chunkHash[c] ^ hash;
+			mVU.prog.chunkHash[c] = hash;
+		}
+	}
+}
+
 // Compare Cached microProgram to mVU.regs().Micro
 __fi bool mVUcmpProg(microVU& mVU, microProgram& prog, const bool cmpWholeProg) {
+	mVU.profiler.CmpProg();
 	if (cmpWholeProg)
 	{
+		mVU.profiler.CmpBytes(mVU.microMemSize);
 		if (memcmp_mmx((u8*)prog.data, mVU.regs().Micro, mVU.microMemSize))
 			return false;
 	}
@@ -250,6 +376,7 @@ __fi bool mVUcmpProg(microVU& mVU, microProgram& prog, const bool cmpWholeProg)
 		for (const auto& range : *prog.ranges) {
 			auto cmpOffset = [&](void* x) { return (u8*)x + range.start; };
 			if ((range.start < 0) || (range.end < 0)) { DevCon.Error("microVU%d: Negative Range![%d][%d]", mVU.index, range.start, range.end); }
+			mVU.profiler.CmpBytes((range.end+8) - range.start);
 			if (memcmp_mmx(cmpOffset(prog.data), cmpOffset(mVU.regs().Micro), ((range.end+8) - range.start))) {
 				return false;
 			}
@@ -268,6 +395,28 @@ _mVUt __fi void* mVUsearchProg(u32 startPC, uptr pState) {
 	microProgramList*  list  = mVU.prog.prog [mVU.regs().start_pc/8];
 
 	if(!quick.prog) { // If null, we need to search for new program
+		const u32  pc       = mVU.regs().start_pc/8;
+		const bool useIndex = !EmuConfig.Gamefixes.ScarfaceIbit && !EmuConfig.Gamefixes.CrashTagTeamRacingIbit;
+		u64 key = 0;
+
+		// Programs that matched this exact micro memory before are tried first,
+		// the ranges compare still decides so a hash collision only costs time
+		if (useIndex) {
+			mVUupdateHash(mVU);
+			key = mVU.prog.memHash ^ ((u64)pc * 0x9e3779b97f4a7c15ull);
+			auto found = mVU.prog.index->find(key);
+			if (found != mVU.prog.index->end() && found->second->startPC == pc && mVUcmpProg(mVU, *found->second, 0)) {
+				mVU.profiler.SearchProg(true);
+				quick.block = found->second->block[startPC/8];
+				quick.prog  = found->second;
+				quick.prog->lastFrame = mVU.prog.curFrame.load(std::memory_order_relaxed);
+				list->erase(std::find(list->begin(), list->end(), quick.prog));
+				list->push_front(quick.prog);
+				return mVUentryGet(mVU, quick.block, startPC, pState);
+			}
+		}
+		mVU.profiler.SearchProg(false);
+
 		std::deque<microProgram*>::iterator it(list->begin());
 		for ( ; it != list->end(); ++it) {
 			bool b = mVUcmpProg(mVU, *it[0], 0);
@@ -291,8 +440,10 @@ _mVUt __fi void* mVUsearchProg(u32 startPC, uptr pState) {
                 }
             }
 			if (b) {
+				if (useIndex) (*mVU.prog.index)[key] = it[0];
 				quick.block = it[0]->block[startPC/8];
 				quick.prog  = it[0];
+				quick.prog->lastFrame = mVU.prog.curFrame.load(std::memory_order_relaxed);
 				list->erase(it);
 				list->push_front(quick.prog);
 				return mVUentryGet(mVU, quick.block, startPC, pState);
@@ -307,6 +458,7 @@ _mVUt __fi void* mVUsearchProg(u32 startPC, uptr pState) {
 		quick.block			= mVU.prog.cur->block[startPC/8];
 		quick.prog			= mVU.prog.cur;
 		list->push_front(mVU.prog.cur);
+		if (useIndex) (*mVU.prog.index)[key] = mVU.prog.cur;
 		//mVUprintUniqueRatio(mVU);
 		return entryPoint;
 	}
@@ -314,6 +466,7 @@ _mVUt __fi void* mVUsearchProg(u32 startPC, uptr pState) {
 	// If list.quick, then we've already found and recompiled the program ;)
 	mVU.prog.isSame = -1;
 	mVU.prog.cur = quick.prog;
+	mVU.prog.cur->lastFrame = mVU.prog.curFrame.load(std::memory_order_relaxed);
 	// Because the VU's can now run in sections and not whole programs at once
 	// we need to set the current block so it gets the right program back
 	quick.block = mVU.prog.cur->block[startPC / 8];
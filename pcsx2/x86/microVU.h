@@ -23,6 +23,7 @@ using namespace x86Emitter;
 #include <deque>
 #include <algorithm>
 #include <memory>
+#include <unordered_map>
 #include "Common.h"
 #include "VU.h"
 #include "MTVU.h"
@@ -37,6 +38,8 @@ using namespace x86Emitter;
 #include "microVU_Profiler.h"
 #include "Utilities/Perf.h"
 
+#define mProgSize (0x4000/4)
+
 struct microBlockLink {
 	microBlock		block;
 	microBlockLink*	next;
@@ -73,6 +76,16 @@ public:
 		qBlockEnd = qBlockList = NULL;
 		fBlockEnd = fBlockList = NULL;
 	};
+	void clearJumpCaches() { // Forgets cached JR/JALR targets (they may point into evicted programs)
+		for(microBlockLink* linkI = qBlockList; linkI != NULL; linkI = linkI->next) {
+			if (!linkI->block.jumpCache) continue;
+			for(u32 i = 0; i < mProgSize/2; i++) linkI->block.jumpCache[i] = microJumpCache();
+		}
+		for(microBlockLink* linkI = fBlockList; linkI != NULL; linkI = linkI->next) {
+			if (!linkI->block.jumpCache) continue;
+			for(u32 i = 0; i < mProgSize/2; i++) linkI->block.jumpCache[i] = microJumpCache();
+		}
+	}
 	microBlock* add(microBlock* pBlock) {
 		microBlock* thisBlock = search(&pBlock->pState);
 		if (!thisBlock) {
@@ -140,16 +153,20 @@ struct microRange {
 	s32 end;   // End PC   (The opcode the block ends with)
 };
 
-#define mProgSize (0x4000/4)
 struct microProgram {
 	u32				   data [mProgSize];   // Holds a copy of the VU microProgram
 	microBlockManager* block[mProgSize/2]; // Array of Block Managers
 	std::deque<microRange>* ranges;			   // The ranges of the microProgram that have already been recompiled
-	u32 startPC; // Start PC of this program
-	int idx;	 // Program index
+	u32 startPC;   // Start PC of this program
+	int idx;	   // Program index
+	u32 lastFrame; // Frame this program was last run on (for LRU eviction)
+	u64 regions;   // Bitmask of the rec-cache regions holding this program's code
 };
 
 typedef std::deque<microProgram*> microProgramList;
+typedef std::unordered_map<u64, microProgram*> microProgramIndex; // (startPC, micro memory hash) -> microProgram
+
+static const uint mVUhashChunk = 64; // Bytes of micro memory per rolling hash chunk
 
 struct microProgramQuick {
 	microBlockManager*    block; // Quick reference to valid microBlockManager for current startPC
@@ -164,17 +181,28 @@ struct microProgManager {
 	int					total;				// Total Number of valid MicroPrograms
 	int					isSame;				// Current cached microProgram is Exact Same program as mVU.regs().Micro (-1 = unknown, 0 = No, 1 = Yes)
 	int					cleared;			// Micro Program is Indeterminate so must be searched for (and if no matches are found then recompile a new one)
-	u32					curFrame;			// Frame Counter
+	std::atomic<u32>	curFrame;			// Frame Counter (bumped by the EE at vsync, read by the MTVU thread)
 	u8*					x86ptr;				// Pointer to program's recompilation code
 	u8*					x86start;			// Start of program's rec-cache
 	u8*					x86end;				// Limit of program's rec-cache
 	microRegInfo		lpState;			// Pipeline state from where program left off (useful for continuing execution)
+	microProgramIndex*	index;				// microPrograms known to match a micro memory image (verified before use)
+	u64					memHash;			// Hash of the whole micro memory (xor of the chunk hashes)
+	u64					chunkHash [mProgSize*4/mVUhashChunk];	 // Hash of each chunk of micro memory
+	u32					chunkDirty[mProgSize*4/mVUhashChunk/32]; // Chunks written since the last hash update
+	u16					regionRefs[64];		// Number of programs with code in each rec-cache region
+	u32					evicted;			// Programs evicted to make room in the rec-cache
+	u32					fullResets;			// Times the rec-cache had to be completely reset
 };
 
 static const uint mVUdispCacheSize	= __pagesize; // Dispatcher Cache Size (in bytes)
 static const uint mVUcacheSafeZone	= 3;		  // Safe-Zone for program recompilation (in megabytes)
 static const uint mVU0cacheReserve	= 64;		  // mVU0 Reserve Cache Size (in megabytes)
 static const uint mVU1cacheReserve	= 64;		  // mVU1 Reserve Cache Size (in megabytes)
+static const uint mVUcacheRegion	= 1;		  // Granularity of rec-cache eviction (in megabytes)
+
+static_assert(mVU0cacheReserve / mVUcacheRegion <= 64 && mVU1cacheReserve / mVUcacheRegion <= 64,
+	"microVU: a program's region mask only covers 64 rec-cache regions");
 
 struct microVU {
 
@@ -248,6 +276,8 @@ mVUop(mVUopL);
 // Private Functions
 extern void  mVUcacheProg (microVU& mVU, microProgram&  prog);
 extern void  mVUdeleteProg(microVU& mVU, microProgram*& prog);
+extern void  mVUmarkRegions(microVU& mVU, microProgram& prog, u8* start, u8* end);
+extern bool  mVUevictProgs(microVU& mVU);
 _mVUt extern void* mVUsearchProg(u32 startPC, uptr pState);
 extern void* __fastcall mVUexecuteVU0(u32 startPC, u32 cycles);
 extern void* __fastcall mVUexecuteVU1(u32 startPC, u32 cycles);
@@ -747,6 +747,7 @@ void* mVUcompile(microVU& mVU, u32 startPC, uptr pState)
 
 perf_and_return:
 
+	mVUmarkRegions(mVU, *mVU.prog.cur, thisPtr, x86Ptr);
 	Perf::vu.map((uptr)thisPtr, x86Ptr - thisPtr, startPC);
 
 	return thisPtr;
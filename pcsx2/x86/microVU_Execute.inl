@@ -158,8 +158,11 @@ _mVUt void mVUcleanUp() {
 	mVU.prog.x86ptr = x86Ptr;
 
 	if ((xGetPtr() < mVU.prog.x86start) || (xGetPtr() >= mVU.prog.x86end)) {
-		Console.WriteLn(vuIndex ? Color_Orange : Color_Magenta, "microVU%d: Program cache limit reached.", mVU.index);
-		mVUreset(mVU, false);
+		if (!mVUevictProgs(mVU)) {
+			mVU.prog.fullResets++;
+			Console.WriteLn(vuIndex ? Color_Orange : Color_Magenta, "microVU%d: Program cache limit reached. [full resets=%u]", mVU.index, mVU.prog.fullResets);
+			mVUreset(mVU, false);
+		}
 	}
 
 	mVU.cycles = mVU.totalCycles - mVU.cycles;
@@ -104,11 +104,18 @@ struct microProfiler {
 	u64 opStats[opLastOpcode];
 	u32 progCount;
 	int index;
+	u64 searchCount;	// microProgram searches (quick reference misses)
+	u64 searchIndexHit;	// Searches answered by the hash index
+	u64 cmpCount;		// Cached microPrograms compared to micro memory
+	u64 cmpBytes;		// Bytes those compares handed to memcmp
 	void Reset(int _index) { memzero(*this); index = _index; }
 	void EmitOp(microOpcode op) {
 		xADD(ptr32[&(((u32*)opStats)[op*2+0])], 1);
 		xADC(ptr32[&(((u32*)opStats)[op*2+1])], 0);
 	}
+	void SearchProg(bool indexHit) { searchCount++; searchIndexHit += indexHit; }
+	void CmpProg() { cmpCount++; }
+	void CmpBytes(u32 bytes) { cmpBytes += bytes; }
 	void Print() {
 		progCount++;
 		if ((progCount % progLimit) == 0) {
@@ -130,7 +137,10 @@ struct microProfiler {
 				DevCon.WriteLn("%s - [%3.4f%%][count=%u]",
 					str.c_str(), stat, (u32)count);
 			}
-			DevCon.WriteLn("Total = 0x%x%x\n\n", (u32)(u64)(total>>32),(u32)total);
+			DevCon.WriteLn("Total = 0x%x%x", (u32)(u64)(total>>32),(u32)total);
+			DevCon.WriteLn("Prog Searches = %u [Index Hits=%3.1f%%] [Compares/Search=%3.2f] [Avg Compare Bytes=%u]\n\n",
+				(u32)searchCount, searchCount ? (double)searchIndexHit / (double)searchCount * 100.0 : 0.0,
+				searchCount ? (double)cmpCount / (double)searchCount : 0.0, cmpCount ? (u32)(cmpBytes / cmpCount) : 0);
 		}
 	}
 };
@@ -138,6 +148,9 @@ struct microProfiler {
 struct microProfiler {
 	__fi void Reset(int _index) {}
 	__fi void EmitOp(microOpcode op) {}
+	__fi void SearchProg(bool indexHit) {}
+	__fi void CmpProg() {}
+	__fi void CmpBytes(u32 bytes) {}
 	__fi void Print() {}
 };
 #endif
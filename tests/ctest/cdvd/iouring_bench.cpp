@@ -0,0 +1,217 @@
+/*  PCSX2 - PS2 Emulator for PCs
+ *  Copyright (C) 2002-2021  PCSX2 Dev Team
+ *
+ *  PCSX2 is free software: you can redistribute it and/or modify it under the terms
+ *  of the GNU Lesser General Public License as published by the Free Software Found-
+ *  ation, either version 3 of the License, or (at your option) any later version.
+ *
+ *  PCSX2 is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ *  without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ *  PURPOSE.  See the GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along with PCSX2.
+ *  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+// Per sector latency of the FlatFileReader backends, on sequential and random LSN
+// patterns. The numbers are printed only, machines vary too much to check them, but
+// every read is checked against the file contents.
+
+#include <gtest/gtest.h>
+#include "LnxIoUring.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fcntl.h>
+#include <libaio.h>
+#include <random>
+#include <string>
+#include <unistd.h>
+#include <vector>
+
+static const u32 SectorSize = 2048;
+static const u32 SectorCount = 32 * 1024; // 64 MB
+static const u32 SectorsPerRead = 16; // InputIsoFile's smallest read window
+static const u32 ReadCount = 1024;
+
+// Under /var/tmp by default, tmpfs (often /tmp) has no O_DIRECT
+static std::string BenchDir;
+static std::string BenchFile;
+
+// Every 32-bit word holds its own byte offset
+static void FillSector(u32* buffer, u32 lsn)
+{
+	for (u32 i = 0; i < SectorSize / 4; i++)
+		buffer[i] = lsn * SectorSize + i * 4;
+}
+
+static bool CheckSectors(const u8* buffer, u32 lsn, u32 count)
+{
+	const u32* words = (const u32*)buffer;
+	for (u32 i = 0; i < count * SectorSize / 4; i++)
+		if (words[i] != lsn * SectorSize + i * 4)
+			return false;
+	return true;
+}
+
+class IoUringBench : public ::testing::Test
+{
+protected:
+	static void SetUpTestCase()
+	{
+		const char* tmp = getenv("TMPDIR");
+		std::string dir = std::string(tmp && *tmp ? tmp : "/var/tmp") + "/iouring_bench.XXXXXX";
+		ASSERT_NE(mkdtemp(&dir[0]), nullptr);
+		BenchDir = dir;
+		BenchFile = BenchDir + "/bench.iso";
+
+		FILE* fp = fopen(BenchFile.c_str(), "wb");
+		ASSERT_NE(fp, nullptr);
+		u32 sector[SectorSize / 4];
+		for (u32 lsn = 0; lsn < SectorCount; lsn++)
+		{
+			FillSector(sector, lsn);
+			ASSERT_EQ(fwrite(sector, SectorSize, 1, fp), 1u);
+		}
+		fflush(fp);
+		fdatasync(fileno(fp));
+		fclose(fp);
+	}
+
+	static void TearDownTestCase()
+	{
+		if (BenchDir.empty())
+			return;
+		unlink(BenchFile.c_str());
+		rmdir(BenchDir.c_str());
+		BenchDir.clear();
+	}
+
+	// Drops the file from the page cache so the buffered backends start cold too.
+	static void DropCache()
+	{
+		int fd = open(BenchFile.c_str(), O_RDONLY);
+		if (fd != -1)
+		{
+			posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED);
+			close(fd);
+		}
+	}
+
+	static std::vector<u32> Pattern(bool sequential)
+	{
+		std::vector<u32> lsns(ReadCount);
+		std::mt19937 rng(1234);
+		for (u32 i = 0; i < ReadCount; i++)
+			lsns[i] = sequential ? (i * SectorsPerRead) % (SectorCount - SectorsPerRead) : rng() % (SectorCount - SectorsPerRead);
+		return lsns;
+	}
+
+	template <typename Read>
+	static void Run(const char* name, bool sequential, Read read)
+	{
+		DropCache();
+		std::vector<u32> lsns = Pattern(sequential);
+		std::vector<u8> buffer(SectorsPerRead * SectorSize);
+		u32 bad = 0;
+
+		auto start = std::chrono::steady_clock::now();
+		for (u32 lsn : lsns)
+		{
+			memset(buffer.data(), 0, buffer.size());
+			int bytes = read(buffer.data(), (u64)lsn * SectorSize, SectorsPerRead * SectorSize);
+			if (bytes != (int)(SectorsPerRead * SectorSize) || !CheckSectors(buffer.data(), lsn, SectorsPerRead))
+				bad++;
+		}
+		auto end = std::chrono::steady_clock::now();
+
+		double us = std::chrono::duration<double, std::micro>(end - start).count();
+		printf("%-22s %-10s %8.2f us/sector\n", name, sequential ? "sequential" : "random", us / (ReadCount * SectorsPerRead));
+		EXPECT_EQ(bad, 0u) << name;
+	}
+
+	static void RunUring(bool direct, bool sequential)
+	{
+		IoUringReader reader;
+		if (!reader.Open(BenchFile.c_str(), direct))
+		{
+			printf("io_uring not available, skipped\n");
+			return;
+		}
+		const char* name = reader.IsDirect() ? "io_uring (O_DIRECT)" : "io_uring";
+		Run(name, sequential, [&](void* dst, u64 offset, u32 size) {
+			if (!reader.Submit(dst, offset, size))
+				return -1;
+			return reader.Complete();
+		});
+	}
+
+	static void RunAio(bool sequential)
+	{
+		io_context_t context = 0;
+		ASSERT_EQ(io_setup(64, &context), 0);
+		int fd = open(BenchFile.c_str(), O_RDONLY);
+		ASSERT_NE(fd, -1);
+
+		Run("libaio", sequential, [&](void* dst, u64 offset, u32 size) {
+			struct iocb iocb;
+			struct iocb* iocbs = &iocb;
+			struct io_event event;
+			io_prep_pread(&iocb, fd, dst, size, offset);
+			if (io_submit(context, 1, &iocbs) != 1 || io_getevents(context, 1, 1, &event, NULL) != 1)
+				return -1;
+			return (int)event.res;
+		});
+
+		close(fd);
+		io_destroy(context);
+	}
+};
+
+TEST_F(IoUringBench, Sequential)
+{
+	RunAio(true);
+	RunUring(false, true);
+	RunUring(true, true);
+}
+
+TEST_F(IoUringBench, Random)
+{
+	RunAio(false);
+	RunUring(false, false);
+	RunUring(true, false);
+}
+
+TEST_F(IoUringBench, UnalignedAndEndOfFile)
+{
+	IoUringReader reader;
+	if (!reader.Open(BenchFile.c_str(), true))
+		return;
+
+	std::vector<u8> buffer(reader.GetMaxReadSize());
+	const u64 fileSize = (u64)SectorCount * SectorSize;
+
+	// Largest read, starting at an odd offset
+	ASSERT_TRUE(reader.Submit(buffer.data(), 1000 * SectorSize + 100, reader.GetMaxReadSize()));
+	ASSERT_EQ(reader.Complete(), (int)reader.GetMaxReadSize());
+	u32 word;
+	memcpy(&word, &buffer[400], 4);
+	EXPECT_EQ(word, 1000 * SectorSize + 500);
+
+	// Past the end, only what's there comes back
+	ASSERT_TRUE(reader.Submit(buffer.data(), fileSize - SectorSize, 4 * SectorSize));
+	EXPECT_EQ(reader.Complete(), (int)SectorSize);
+	EXPECT_TRUE(CheckSectors(buffer.data(), SectorCount - 1, 1));
+
+	// Too big
+	EXPECT_FALSE(reader.Submit(buffer.data(), 0, reader.GetMaxReadSize() + 1));
+
+	// Cancel then read again
+	ASSERT_TRUE(reader.Submit(buffer.data(), 0, SectorSize));
+	reader.Cancel();
+	ASSERT_TRUE(reader.Submit(buffer.data(), 5 * SectorSize, SectorSize));
+	EXPECT_EQ(reader.Complete(), (int)SectorSize);
+	EXPECT_TRUE(CheckSectors(buffer.data(), 5, 1));
+}
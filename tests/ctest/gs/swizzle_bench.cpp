@@ -0,0 +1,410 @@
+/*  PCSX2 - PS2 Emulator for PCs
+ *  Copyright (C) 2002-2021  PCSX2 Dev Team
+ *
+ *  PCSX2 is free software: you can redistribute it and/or modify it under the terms
+ *  of the GNU Lesser General Public License as published by the Free Software Found-
+ *  ation, either version 3 of the License, or (at your option) any later version.
+ *
+ *  PCSX2 is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ *  without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ *  PURPOSE.  See the GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along with PCSX2.
+ *  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+// Throughput of the GSBlock swizzle (image to block) and unswizzle (block to image)
+// kernels behind GSLocalMemory's WriteImage* and ReadTexture*, for every PSM and source
+// alignment at a few image sizes. GSBlock picks its code at compile time, so this file
+// is built once per ISA level. The numbers are printed only, machines vary too much to
+// check them, but every result is compared with a scalar version using GSTables.
+
+#include "PrecompiledHeader.h"
+#include "GS/GSBlock.h"
+
+#include <gtest/gtest.h>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <random>
+
+static const int Sizes[] = {64, 256, 1024};
+static const int MaxSize = 1024;
+static const size_t BenchPixels = 16 * 1024 * 1024; // per kernel and size
+
+// 32-bit pixels at most, plus room to misalign the image
+alignas(32) static uint8 s_image[MaxSize * MaxSize * 4 + 64];
+alignas(32) static uint8 s_blocks[MaxSize * MaxSize * 4];
+alignas(32) static uint8 s_ref[MaxSize * MaxSize * 4 + 64];
+alignas(32) static uint8 s_init[MaxSize * MaxSize * 4];
+
+alignas(32) static uint32 s_pal[256];
+alignas(32) static uint64 s_pal64[256];
+static GIFRegTEXA s_TEXA;
+
+typedef void (*WriteFn)(uint8* block, const uint8* image, int pitch);
+typedef void (*ReadFn)(const uint8* block, uint8* image, int pitch);
+typedef uint32 (*ExpandFn)(uint32 c);
+
+// How a kernel maps the pixels of a block to the image
+
+struct Format
+{
+	int bw, bh; // block size in pixels
+	int block_bpp; // 32, 16, 8 or 4, the pixel in the block
+	int image_bpp; // 32, 24, 16, 8 or 4
+	uint32 mask; // bits of the block pixel written by a swizzle
+	int shift; // of the image pixel inside the block pixel
+};
+
+static const Format F32 = {8, 8, 32, 32, 0xffffffff, 0};
+static const Format F24 = {8, 8, 32, 24, 0x00ffffff, 0};
+static const Format F16 = {16, 8, 16, 16, 0xffff, 0};
+static const Format F8 = {16, 16, 8, 8, 0xff, 0};
+static const Format F4 = {32, 16, 4, 4, 0xf, 0};
+static const Format F8H = {8, 8, 32, 8, 0xff000000, 24};
+static const Format F4HL = {8, 8, 32, 4, 0x0f000000, 24};
+static const Format F4HH = {8, 8, 32, 4, 0xf0000000, 28};
+
+// the same tables GSLocalMemory addresses single pixels with
+
+static uint32 GetBlockPixel(const uint8* block, int bpp, int x, int y)
+{
+	switch (bpp)
+	{
+		case 32: return ((const uint32*)block)[columnTable32[y][x]];
+		case 16: return ((const uint16*)block)[columnTable16[y][x]];
+		case 8: return block[columnTable8[y][x]];
+		default:
+		{
+			int i = columnTable4[y][x];
+			return (block[i >> 1] >> ((i & 1) << 2)) & 0xf;
+		}
+	}
+}
+
+static void SetBlockPixel(uint8* block, int bpp, int x, int y, uint32 c)
+{
+	switch (bpp)
+	{
+		case 32: ((uint32*)block)[columnTable32[y][x]] = c; break;
+		case 16: ((uint16*)block)[columnTable16[y][x]] = (uint16)c; break;
+		case 8: block[columnTable8[y][x]] = (uint8)c; break;
+		default:
+		{
+			int i = columnTable4[y][x];
+			int shift = (i & 1) << 2;
+			block[i >> 1] = (uint8)((block[i >> 1] & (0xf0 >> shift)) | ((c & 0xf) << shift));
+			break;
+		}
+	}
+}
+
+static uint32 GetImagePixel(const uint8* image, int pitch, int bpp, int x, int y)
+{
+	const uint8* p = image + pitch * y;
+
+	switch (bpp)
+	{
+		case 32: return ((const uint32*)p)[x];
+		case 24: return p[x * 3] | (p[x * 3 + 1] << 8) | (p[x * 3 + 2] << 16);
+		case 16: return ((const uint16*)p)[x];
+		case 8: return p[x];
+		default: return (p[x >> 1] >> ((x & 1) << 2)) & 0xf;
+	}
+}
+
+static void SetImagePixel(uint8* image, int pitch, int bpp, int x, int y, uint32 c)
+{
+	uint8* p = image + pitch * y;
+
+	switch (bpp)
+	{
+		case 32: ((uint32*)p)[x] = c; break;
+		case 16: ((uint16*)p)[x] = (uint16)c; break;
+		case 8: p[x] = (uint8)c; break;
+		default:
+		{
+			int shift = (x & 1) << 2;
+			p[x >> 1] = (uint8)((p[x >> 1] & (0xf0 >> shift)) | ((c & 0xf) << shift));
+			break;
+		}
+	}
+}
+
+static void Fill(uint8* p, size_t size, uint32 seed)
+{
+	std::mt19937 rng(seed);
+
+	for (size_t i = 0; i < size; i += 4)
+	{
+		*(uint32*)&p[i] = rng();
+	}
+}
+
+static int Pitch(const Format& f, int size)
+{
+	return size * f.image_bpp / 8;
+}
+
+static void Report(const char* name, int align, int size, size_t pixels, std::chrono::steady_clock::duration t)
+{
+	double us = (double)std::chrono::duration_cast<std::chrono::microseconds>(t).count();
+
+	printf("[ _M_SSE %03x ] %-10s a%-2d %4dx%-4d %8.1f Mpix/s\n", _M_SSE, name, align, size, size, us > 0 ? pixels / us : 0.0);
+}
+
+// Swizzles a size x size image into consecutive blocks, the image starts align bytes
+// past a 32-byte boundary.
+
+static void RunWrite(const char* name, const Format& f, WriteFn fn, int align)
+{
+	for (int size : Sizes)
+	{
+		int pitch = Pitch(f, size);
+		int bx = size / f.bw;
+		int by = size / f.bh;
+		size_t block_bytes = (size_t)bx * by * 256;
+
+		uint8* image = s_image + (align == 32 ? 0 : align == 16 ? 16 : 4);
+
+		Fill(image, pitch * size, 1);
+		Fill(s_init, block_bytes, 2);
+
+		memcpy(s_blocks, s_init, block_bytes);
+
+		// the kernels only replace their own bits, passes after the first write the same
+
+		int passes = (int)std::max<size_t>(1, BenchPixels / (size * size));
+
+		auto start = std::chrono::steady_clock::now();
+
+		for (int i = 0; i < passes; i++)
+		{
+			uint8* block = s_blocks;
+
+			for (int y = 0; y < by; y++)
+			{
+				const uint8* src = image + pitch * f.bh * y;
+
+				for (int x = 0; x < bx; x++, block += 256)
+				{
+					fn(block, src + x * f.bw * f.image_bpp / 8, pitch);
+				}
+			}
+		}
+
+		Report(name, align, size, (size_t)passes * size * size, std::chrono::steady_clock::now() - start);
+
+		memcpy(s_ref, s_init, block_bytes);
+
+		for (int y = 0; y < size; y++)
+		{
+			for (int x = 0; x < size; x++)
+			{
+				uint8* block = s_ref + ((y / f.bh) * bx + x / f.bw) * 256;
+
+				uint32 c = GetBlockPixel(block, f.block_bpp, x % f.bw, y % f.bh);
+				uint32 s = GetImagePixel(image, pitch, f.image_bpp, x, y);
+
+				SetBlockPixel(block, f.block_bpp, x % f.bw, y % f.bh, (c & ~f.mask) | ((s << f.shift) & f.mask));
+			}
+		}
+
+		ASSERT_EQ(memcmp(s_blocks, s_ref, block_bytes), 0) << name << " a" << align << " " << size << "x" << size;
+	}
+}
+
+// Unswizzles consecutive blocks into a size x size image, expand turns the block pixel
+// into the image pixel, or the image has the format of the block when it is NULL.
+
+static void RunRead(const char* name, const Format& f, ReadFn fn, ExpandFn expand)
+{
+	int image_bpp = expand ? 32 : f.block_bpp;
+
+	for (int size : Sizes)
+	{
+		int pitch = size * image_bpp / 8;
+		int bx = size / f.bw;
+		int by = size / f.bh;
+		size_t block_bytes = (size_t)bx * by * 256;
+
+		Fill(s_blocks, block_bytes, 3);
+
+		memset(s_image, 0, pitch * size);
+
+		int passes = (int)std::max<size_t>(1, BenchPixels / (size * size));
+
+		auto start = std::chrono::steady_clock::now();
+
+		for (int i = 0; i < passes; i++)
+		{
+			const uint8* block = s_blocks;
+
+			for (int y = 0; y < by; y++)
+			{
+				uint8* dst = s_image + pitch * f.bh * y;
+
+				for (int x = 0; x < bx; x++, block += 256)
+				{
+					fn(block, dst + x * f.bw * image_bpp / 8, pitch);
+				}
+			}
+		}
+
+		Report(name, 32, size, (size_t)passes * size * size, std::chrono::steady_clock::now() - start);
+
+		memset(s_ref, 0, pitch * size);
+
+		for (int y = 0; y < size; y++)
+		{
+			for (int x = 0; x < size; x++)
+			{
+				const uint8* block = s_blocks + ((y / f.bh) * bx + x / f.bw) * 256;
+
+				uint32 c = GetBlockPixel(block, f.block_bpp, x % f.bw, y % f.bh);
+
+				SetImagePixel(s_ref, pitch, image_bpp, x, y, expand ? expand(c) : c);
+			}
+		}
+
+		ASSERT_EQ(memcmp(s_image, s_ref, pitch * size), 0) << name << " " << size << "x" << size;
+	}
+}
+
+class GSBlockBench : public ::testing::Test
+{
+protected:
+	static void SetUpTestCase()
+	{
+		std::mt19937 rng(4);
+
+		for (int i = 0; i < 256; i++)
+		{
+			s_pal[i] = rng();
+		}
+
+		// two 4-bit pixels per byte, the low one first, like GSClut's 64-bit table
+
+		for (int i = 0; i < 256; i++)
+		{
+			s_pal64[i] = s_pal[i & 15] | ((uint64)s_pal[i >> 4] << 32);
+		}
+
+		s_TEXA.u64 = 0;
+		s_TEXA.TA0 = 0x40;
+		s_TEXA.TA1 = 0xc0;
+	}
+};
+
+// swizzle
+
+template <int alignment>
+static void Write32(uint8* block, const uint8* image, int pitch) { GSBlock::WriteBlock32<alignment, 0xffffffff>(block, image, pitch); }
+template <int alignment>
+static void Write32Z24(uint8* block, const uint8* image, int pitch) { GSBlock::WriteBlock32<alignment, 0x00ffffff>(block, image, pitch); }
+template <int alignment>
+static void Write16(uint8* block, const uint8* image, int pitch) { GSBlock::WriteBlock16<alignment>(block, image, pitch); }
+template <int alignment>
+static void Write8(uint8* block, const uint8* image, int pitch) { GSBlock::WriteBlock8<alignment>(block, image, pitch); }
+template <int alignment>
+static void Write4(uint8* block, const uint8* image, int pitch) { GSBlock::WriteBlock4<alignment>(block, image, pitch); }
+
+static void Write24(uint8* block, const uint8* image, int pitch) { GSBlock::UnpackAndWriteBlock24(image, pitch, block); }
+static void Write8H(uint8* block, const uint8* image, int pitch) { GSBlock::UnpackAndWriteBlock8H(image, pitch, block); }
+static void Write4HL(uint8* block, const uint8* image, int pitch) { GSBlock::UnpackAndWriteBlock4HL(image, pitch, block); }
+static void Write4HH(uint8* block, const uint8* image, int pitch) { GSBlock::UnpackAndWriteBlock4HH(image, pitch, block); }
+
+static const Format F32M24 = {8, 8, 32, 32, 0x00ffffff, 0};
+
+TEST_F(GSBlockBench, Write32)
+{
+	RunWrite("Write32", F32, Write32<0>, 0);
+	RunWrite("Write32", F32, Write32<16>, 16);
+	RunWrite("Write32", F32, Write32<32>, 32);
+}
+
+TEST_F(GSBlockBench, Write32Z24)
+{
+	RunWrite("Write32Z24", F32M24, Write32Z24<0>, 0);
+	RunWrite("Write32Z24", F32M24, Write32Z24<16>, 16);
+	RunWrite("Write32Z24", F32M24, Write32Z24<32>, 32);
+}
+
+TEST_F(GSBlockBench, Write16)
+{
+	RunWrite("Write16", F16, Write16<0>, 0);
+	RunWrite("Write16", F16, Write16<16>, 16);
+	RunWrite("Write16", F16, Write16<32>, 32);
+}
+
+TEST_F(GSBlockBench, Write8)
+{
+	RunWrite("Write8", F8, Write8<0>, 0);
+	RunWrite("Write8", F8, Write8<16>, 16);
+	RunWrite("Write8", F8, Write8<32>, 32);
+}
+
+TEST_F(GSBlockBench, Write4)
+{
+	RunWrite("Write4", F4, Write4<0>, 0);
+	RunWrite("Write4", F4, Write4<16>, 16);
+	RunWrite("Write4", F4, Write4<32>, 32);
+}
+
+TEST_F(GSBlockBench, Write24)
+{
+	RunWrite("Write24", F24, Write24, 0);
+	RunWrite("Write24", F24, Write24, 32);
+}
+
+TEST_F(GSBlockBench, WriteHighBits)
+{
+	RunWrite("Write8H", F8H, Write8H, 0);
+	RunWrite("Write8H", F8H, Write8H, 32);
+	RunWrite("Write4HL", F4HL, Write4HL, 0);
+	RunWrite("Write4HL", F4HL, Write4HL, 32);
+	RunWrite("Write4HH", F4HH, Write4HH, 0);
+	RunWrite("Write4HH", F4HH, Write4HH, 32);
+}
+
+// unswizzle, the destination is always aligned, like the texture cache buffers
+
+static void Read32(const uint8* block, uint8* image, int pitch) { GSBlock::ReadBlock32(block, image, pitch); }
+static void Read16(const uint8* block, uint8* image, int pitch) { GSBlock::ReadBlock16(block, image, pitch); }
+static void Read8(const uint8* block, uint8* image, int pitch) { GSBlock::ReadBlock8(block, image, pitch); }
+static void Read4(const uint8* block, uint8* image, int pitch) { GSBlock::ReadBlock4(block, image, pitch); }
+
+static void Read24(const uint8* block, uint8* image, int pitch) { GSBlock::ReadAndExpandBlock24<false>(block, image, pitch, s_TEXA); }
+static void Read16E(const uint8* block, uint8* image, int pitch) { GSBlock::ReadAndExpandBlock16<false>(block, image, pitch, s_TEXA); }
+static void Read8P(const uint8* block, uint8* image, int pitch) { GSBlock::ReadAndExpandBlock8_32(block, image, pitch, s_pal); }
+static void Read4P(const uint8* block, uint8* image, int pitch) { GSBlock::ReadAndExpandBlock4_32(block, image, pitch, s_pal64); }
+static void Read8H(const uint8* block, uint8* image, int pitch) { GSBlock::ReadAndExpandBlock8H_32(block, image, pitch, s_pal); }
+static void Read4HL(const uint8* block, uint8* image, int pitch) { GSBlock::ReadAndExpandBlock4HL_32(block, image, pitch, s_pal); }
+static void Read4HH(const uint8* block, uint8* image, int pitch) { GSBlock::ReadAndExpandBlock4HH_32(block, image, pitch, s_pal); }
+
+static uint32 Expand24(uint32 c) { return (c & 0x00ffffff) | (s_TEXA.TA0 << 24); }
+static uint32 Expand16(uint32 c) { return ((c & 0x001f) << 3) | ((c & 0x03e0) << 6) | ((c & 0x7c00) << 9) | ((c & 0x8000 ? s_TEXA.TA1 : s_TEXA.TA0) << 24); }
+static uint32 ExpandP(uint32 c) { return s_pal[c]; }
+static uint32 Expand8H(uint32 c) { return s_pal[c >> 24]; }
+static uint32 Expand4HL(uint32 c) { return s_pal[(c >> 24) & 0xf]; }
+static uint32 Expand4HH(uint32 c) { return s_pal[c >> 28]; }
+
+TEST_F(GSBlockBench, Read)
+{
+	RunRead("Read32", F32, Read32, NULL);
+	RunRead("Read16", F16, Read16, NULL);
+	RunRead("Read8", F8, Read8, NULL);
+	RunRead("Read4", F4, Read4, NULL);
+}
+
+TEST_F(GSBlockBench, ReadTexture)
+{
+	RunRead("Read24", F32, Read24, Expand24);
+	RunRead("Read16E", F16, Read16E, Expand16);
+	RunRead("Read8P", F8, Read8P, ExpandP);
+	RunRead("Read4P", F4, Read4P, ExpandP);
+	RunRead("Read8H", F32, Read8H, Expand8H);
+	RunRead("Read4HL", F32, Read4HL, Expand4HL);
+	RunRead("Read4HH", F32, Read4HH, Expand4HH);
+}